@@ -0,0 +1,130 @@
+#include "parser/Ast.h"
+#include "parser/AstArena.h"
+#include "parser/AstVisitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* AST walk micro-benchmark: visits an expression-heavy tree of about a million nodes with the
+   switch + dynamic_cast dispatch the passes used before AstVisitor, and with AstVisitor.
+
+   Usage: ast_bench [thousands of nodes] [runs] */
+
+using namespace minisolc;
+
+namespace {
+
+/* The per-node pattern TypeSystem and CodeGenerator used: switch on the kind, then
+   dynamic_cast to the class it names. */
+size_t walkDynamicCast(BaseAST* node) {
+	switch (node->GetASTType()) {
+	case ElementASTTypes::SourceUnit: {
+		SourceUnit* unit = dynamic_cast<SourceUnit*>(node);
+		ASSERT(unit != nullptr, "dynamic cast fails.");
+		size_t count = 1;
+		for (BaseAST* child: unit->getSubNodes())
+			count += walkDynamicCast(child);
+		return count;
+	}
+	case ElementASTTypes::ExpressionStatement: {
+		ExpressionStatement* stmt = dynamic_cast<ExpressionStatement*>(node);
+		ASSERT(stmt != nullptr, "dynamic cast fails.");
+		return 1 + walkDynamicCast(stmt->GetExpr());
+	}
+	case ElementASTTypes::BinaryOp: {
+		BinaryOp* op = dynamic_cast<BinaryOp*>(node);
+		ASSERT(op != nullptr, "dynamic cast fails.");
+		return 1 + walkDynamicCast(op->GetLeftHand()) + walkDynamicCast(op->GetRightHand());
+	}
+	case ElementASTTypes::UnaryOp: {
+		UnaryOp* op = dynamic_cast<UnaryOp*>(node);
+		ASSERT(op != nullptr, "dynamic cast fails.");
+		return 1 + walkDynamicCast(op->GetExpr());
+	}
+	case ElementASTTypes::Identifier: {
+		Identifier* id = dynamic_cast<Identifier*>(node);
+		ASSERT(id != nullptr, "dynamic cast fails.");
+		return 1;
+	}
+	case ElementASTTypes::NumberLiteral: {
+		NumberLiteral* literal = dynamic_cast<NumberLiteral*>(node);
+		ASSERT(literal != nullptr, "dynamic cast fails.");
+		return 1;
+	}
+	default:
+		return 0;
+	}
+}
+
+class CountVisitor: public AstVisitor<CountVisitor, size_t> {
+public:
+	size_t visitSourceUnit(SourceUnit* unit) {
+		size_t count = 1;
+		for (BaseAST* child: unit->getSubNodes())
+			count += visit(child);
+		return count;
+	}
+	size_t visitExpressionStatement(ExpressionStatement* stmt) { return 1 + visit(stmt->GetExpr()); }
+	size_t visitBinaryOp(BinaryOp* op) { return 1 + visit(op->GetLeftHand()) + visit(op->GetRightHand()); }
+	size_t visitUnaryOp(UnaryOp* op) { return 1 + visit(op->GetExpr()); }
+	size_t visitIdentifier(Identifier*) { return 1; }
+	size_t visitNumberLiteral(NumberLiteral*) { return 1; }
+};
+
+/* A balanced expression of the given depth, mixing every kind the walkers handle. */
+Expression* buildExpression(AstArena& arena, int depth, unsigned& seed, size_t& nodes) {
+	seed = seed * 1103515245u + 12345u;
+	++nodes;
+	if (depth == 0) {
+		if (seed & 0x10000)
+			return arena.make<Identifier>("x");
+		return arena.make<NumberLiteral>("1", Type::INTEGER);
+	}
+	if ((seed & 0x70000) == 0)
+		return arena.make<UnaryOp>(Token::Sub, buildExpression(arena, depth - 1, seed, nodes), true);
+	static const Token ops[] = {Token::Add, Token::Sub, Token::Mul, Token::LessThan};
+	Expression* lhs = buildExpression(arena, depth - 1, seed, nodes);
+	Expression* rhs = buildExpression(arena, depth - 1, seed, nodes);
+	return arena.make<BinaryOp>(lhs, ops[(seed >> 20) & 3], rhs);
+}
+
+template <typename F> double bestSeconds(size_t runs, F&& run) {
+	double best = 1e30;
+	for (size_t i = 0; i < runs; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, const char* argv[]) {
+	size_t target = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000) * 1000;
+	size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+
+	AstArena arena;
+	std::vector<BaseAST*> stmts;
+	unsigned seed = 1;
+	for (size_t nodes = 0; nodes < target; ++nodes)
+		stmts.push_back(arena.make<ExpressionStatement>(buildExpression(arena, 5, seed, nodes)));
+	SourceUnit* root = arena.make<SourceUnit>(arena.list(stmts));
+
+	size_t rttiNodes = 0, visitorNodes = 0;
+	double rtti = bestSeconds(runs, [&] { rttiNodes = walkDynamicCast(root); });
+	double visitor = bestSeconds(runs, [&] { visitorNodes = CountVisitor().visit(root); });
+	if (rttiNodes != visitorNodes) {
+		std::fprintf(stderr, "walkers disagree: %zu vs %zu nodes\n", rttiNodes, visitorNodes);
+		return 1;
+	}
+
+	std::printf("tree: %zu nodes, %.1f MiB of arena, best of %zu runs\n", visitorNodes,
+		static_cast<double>(arena.reserved()) / (1 << 20), runs);
+	std::printf("%-14s %8.2f ns/node\n", "dynamic_cast", rtti * 1e9 / rttiNodes);
+	std::printf("%-14s %8.2f ns/node\n", "AstVisitor", visitor * 1e9 / visitorNodes);
+	std::printf("speedup: %.2fx\n", rtti / visitor);
+}
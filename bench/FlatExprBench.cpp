@@ -0,0 +1,160 @@
+#include "lexer/TokenStream.h"
+#include "parser/AstVisitor.h"
+#include "parser/FlatExpr.h"
+#include "parser/Parser.h"
+#include "preprocess/Preprocess.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+/* Expression store micro-benchmark: parses a generated source with the parser's flat expression
+   store on, then finds the expressions built only from literals and operators twice, by a
+   recursive AstVisitor walk from every top-level expression and by FlatExprStore::constantMask(),
+   one forward loop over the arrays.
+
+   Usage: flat_bench [megabytes] [runs] */
+
+using namespace minisolc;
+
+namespace {
+
+const char* kSnippet = R"(function mix(int a, int b) returns (int) {
+    int c = (a + 3) * (4 - 1) + mix(b, 2 * 8) - -a;
+    c = c + (1 + 2) * 3 - b % (7 << 2);
+    values[a + 1] = !(a <= b) || 5 > 4 && c != 0;
+    return c * (10 - 2 * 3) + a++;
+}
+)";
+
+std::filesystem::path writeInput(size_t bytes) {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "minisolc_flat_bench.sol";
+	std::ofstream out(path, std::ios::binary);
+	size_t snippet = std::char_traits<char>::length(kSnippet);
+	for (size_t written = 0; written < bytes; written += snippet) {
+		out << kSnippet;
+	}
+	return path;
+}
+
+/* The same rule as constantMask(), on the tree. */
+class ConstantVisitor: public AstVisitor<ConstantVisitor, bool> {
+public:
+	size_t constants = 0;
+
+	bool visitNode(BaseAST*) { return false; }
+	bool visitBooleanLiteral(BooleanLiteral*) { return count(true); }
+	bool visitNumberLiteral(NumberLiteral*) { return count(true); }
+	bool visitStringLiteral(StringLiteral*) { return count(true); }
+	bool visitIdentifier(Identifier*) { return false; }
+	bool visitUnaryOp(UnaryOp* op) {
+		bool operand = visit(op->GetExpr());
+		return count(op->GetOp() != Token::Inc && op->GetOp() != Token::Dec && operand);
+	}
+	bool visitBinaryOp(BinaryOp* op) {
+		bool lhs = visit(op->GetLeftHand());
+		bool rhs = visit(op->GetRightHand());
+		return count(lhs && rhs);
+	}
+	bool visitAssignment(Assignment* op) {
+		visit(op->GetLeftHand());
+		visit(op->GetRightHand());
+		return false;
+	}
+	bool visitIndexAccess(IndexAccess* access) {
+		visit(access->GetArrayName());
+		visit(access->GetArrayIndex());
+		return false;
+	}
+	bool visitMemberAccess(MemberAccess* access) {
+		visit(access->GetStructVarExpr());
+		return false;
+	}
+	bool visitFunctionCall(FunctionCall* call) {
+		visit(call->GetCallee());
+		for (Expression* arg: call->GetArgs())
+			visit(arg);
+		return false;
+	}
+
+private:
+	bool count(bool constant) {
+		constants += constant;
+		return constant;
+	}
+};
+
+/* Expressions that are no other expression's operand, i.e. where a tree walk starts. */
+std::vector<Expression*> topLevelExpressions(const FlatExprStore& store) {
+	std::vector<bool> operand(store.size(), false);
+	auto mark = [&](FlatExprStore::Index i) {
+		if (i != FlatExprStore::kNone)
+			operand[i] = true;
+	};
+	for (size_t i = 0; i < store.size(); ++i) {
+		mark(store.lhs()[i]);
+		if (store.kinds()[i] != ElementASTTypes::FunctionCall) {
+			mark(store.rhs()[i]);
+			continue;
+		}
+		FlatExprStore::Index args = store.rhs()[i];
+		for (FlatExprStore::Index k = 0; k < store.args()[args]; ++k)
+			mark(store.args()[args + 1 + k]);
+	}
+	std::vector<Expression*> roots;
+	for (size_t i = 0; i < store.size(); ++i) {
+		if (!operand[i])
+			roots.push_back(store.nodes()[i]);
+	}
+	return roots;
+}
+
+template <typename F> double bestSeconds(size_t runs, F&& run) {
+	double best = 1e30;
+	for (size_t i = 0; i < runs; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, const char* argv[]) {
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+	size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+	std::filesystem::path path = writeInput(megabytes << 20);
+	Preprocess preprocess(path);
+	TokenStream stream(preprocess);
+	Parser parser(stream, true);
+	parser.parse();
+	std::filesystem::remove(path);
+	const FlatExprStore& store = *parser.GetFlatExprs();
+	std::vector<Expression*> roots = topLevelExpressions(store);
+
+	size_t treeConstants = 0, flatConstants = 0;
+	double tree = bestSeconds(runs, [&] {
+		ConstantVisitor visitor;
+		for (Expression* root: roots)
+			visitor.visit(root);
+		treeConstants = visitor.constants;
+	});
+	double flat = bestSeconds(runs, [&] {
+		std::vector<bool> mask = store.constantMask();
+		flatConstants = static_cast<size_t>(std::count(mask.begin(), mask.end(), true));
+	});
+	if (treeConstants != flatConstants) {
+		std::fprintf(stderr, "passes disagree: %zu vs %zu constant expressions\n", treeConstants, flatConstants);
+		return 1;
+	}
+
+	std::printf("%zu expressions, %zu constant, best of %zu runs\n", store.size(), flatConstants, runs);
+	std::printf("%-14s %8.2f ns/expression\n", "AstVisitor", tree * 1e9 / store.size());
+	std::printf("%-14s %8.2f ns/expression\n", "constantMask", flat * 1e9 / store.size());
+	std::printf("speedup: %.2fx\n", tree / flat);
+}
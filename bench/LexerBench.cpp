@@ -0,0 +1,435 @@
+#include "lexer/Scan.h"
+#include "lexer/Token.h"
+#include "lexer/TokenStream.h"
+#include "preprocess/Preprocess.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Lexer micro-benchmark: tokenizes a generated source with the table-driven TokenStream and
+   with the hand-written switch it replaced, and reports the throughput of each.
+
+   Usage: lexer_bench [megabytes] [runs] */
+
+using namespace minisolc;
+
+namespace {
+
+/* The switch-based tokenizer TokenStream used before the punctuator DFA, unchanged apart
+   from logging. Identifiers, numbers, strings and comments use the same helpers as
+   TokenStream, so only the operator dispatch differs. */
+class LegacyLexer {
+public:
+	LegacyLexer(const CharStream& source): m_source(source), m_striter(source.cbegin()) {
+		while (!m_done)
+			scanToken();
+	}
+
+	size_t size() const { return m_tokens.size(); }
+	bool error() const { return m_error; }
+
+private:
+	void scanToken() {
+		size_t count = m_tail;
+		while (m_tail == count) {
+			if (m_striter == m_source.cend() || m_error) {
+				m_tokStart = m_striter;
+				addToken(Token::EOS, 0);
+				m_done = true;
+				return;
+			}
+			m_tokStart = m_striter;
+			switch (*m_striter) {
+			case '=':
+				++m_striter; // advance
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::Equal, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '>') {
+					addToken(Token::DoubleArrow, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Assign, 1);
+				}
+				break;
+			case '+':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignAdd, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '+') {
+					addToken(Token::Inc, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Add, 1);
+				}
+				break;
+			case '-':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignSub, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '>') {
+					addToken(Token::RightArrow, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '-') {
+					addToken(Token::Dec, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Sub, 1);
+				}
+				break;
+			case '*':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignMul, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '*') {
+					addToken(Token::Exp, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Mul, 1);
+				}
+				break;
+			case '/':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignDiv, 2);
+					++m_striter;
+				} else if (*m_striter == '*' || *m_striter == '/') {
+					m_error = !skipAnnotation();
+				} else {
+					addToken(Token::Div, 1);
+				}
+				break;
+			case '%':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignMod, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Mod, 1);
+				}
+				break;
+			case '!':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::NotEqual, 2);
+					++m_striter;
+				} else {
+					addToken(Token::Not, 1);
+				}
+				break;
+			case '>':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '>') {
+					if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '>') {
+						if (m_striter + 2 != m_source.cend() && *(m_striter + 2) == '=') {
+							addToken(Token::AssignSar, 4);
+							m_striter += 3;
+						} else {
+							addToken(Token::SHR, 3);
+							m_striter += 2;
+						}
+					} else if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '=') {
+						addToken(Token::AssignShr, 3);
+						m_striter += 2;
+					} else {
+						addToken(Token::SAR, 2);
+						++m_striter;
+					}
+				} else if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::GreaterThanOrEqual, 2);
+					++m_striter;
+				} else {
+					addToken(Token::GreaterThan, 1);
+				}
+				break;
+			case '<':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '<') {
+					if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '=') {
+						addToken(Token::AssignShl, 3);
+						m_striter += 2;
+					} else {
+						addToken(Token::SHL, 2);
+						++m_striter;
+					}
+				} else if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::LessThanOrEqual, 2);
+					++m_striter;
+				} else {
+					addToken(Token::LessThan, 1);
+				}
+				break;
+			case '&':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '&') {
+					addToken(Token::And, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignBitAnd, 2);
+					++m_striter;
+				} else {
+					addToken(Token::BitAnd, 1);
+				}
+				break;
+			case '|':
+				++m_striter;
+				if (m_striter != m_source.cend() && *m_striter == '|') {
+					addToken(Token::Or, 2);
+					++m_striter;
+				} else if (m_striter != m_source.cend() && *m_striter == '=') {
+					addToken(Token::AssignBitOr, 2);
+					++m_striter;
+				} else {
+					addToken(Token::BitOr, 1);
+				}
+				break;
+			case '~':
+				++m_striter;
+				addToken(Token::BitNot, 1);
+				break;
+			case '?':
+				++m_striter;
+				addToken(Token::Conditional, 1);
+				break;
+			case ':':
+				++m_striter;
+				addToken(Token::Colon, 1);
+				break;
+			case '(':
+				++m_striter;
+				addToken(Token::LParen, 1);
+				break;
+			case ')':
+				++m_striter;
+				addToken(Token::RParen, 1);
+				break;
+			case '[':
+				++m_striter;
+				addToken(Token::LBrack, 1);
+				break;
+			case ']':
+				++m_striter;
+				addToken(Token::RBrack, 1);
+				break;
+			case '{':
+				++m_striter;
+				addToken(Token::LBrace, 1);
+				break;
+			case '}':
+				++m_striter;
+				addToken(Token::RBrace, 1);
+				break;
+			case ';':
+				++m_striter;
+				addToken(Token::Semicolon, 1);
+				break;
+			case ',':
+				++m_striter;
+				addToken(Token::Comma, 1);
+				break;
+			case '\0':
+				++m_striter;
+				break;
+			case '\"':
+				m_error = !tokenizeString();
+				break;
+			case '.':
+				++m_striter;
+				addToken(Token::Period, 1);
+				break;
+			default: {
+				if (isalus(*m_striter)) {
+					/* keyword or identifier */
+					tokenizeKeywordIdent();
+				} else if (isdigit(*m_striter)) {
+					/* number */
+					m_error = !tokenizeNumber();
+				} else if (isspace(*m_striter)) {
+					/* spaces */
+					skipSpace();
+				} else {
+					m_error = true;
+				}
+				break;
+			}
+			}
+		}
+	}
+
+	void tokenizeKeywordIdent() {
+		const char* begin = m_striter.ptr;
+		const char* right_bound = skipIdentifier(begin, sourceEnd());
+		std::string_view val(begin, static_cast<size_t>(right_bound - begin));
+		addToken(keywordByName(val), val.size());
+		m_striter += right_bound - begin;
+	}
+
+	bool tokenizeNumber() {
+		bool res = true;
+		bool floatFlag = false;
+
+		auto right_bound = std::find_if(m_striter, m_source.cend(), [&](const char ch) {
+			if (ch == '.') {
+				floatFlag = true;
+			}
+			return issep(ch);
+		});
+		std::string val = std::string(m_striter, right_bound);
+		if (val.size() > 1) {
+			try {
+				if (val[0] == '0') {
+					if (val[1] == 'x' || val[1] == 'X') {
+						// Hexadecimal
+						std::stoll(val, 0, 16);
+					} else {
+						// Octal
+						std::stoll(val, 0, 8);
+					}
+				} else if (!floatFlag) {
+					// Decimal
+					std::stoll(val);
+				} else {
+					// Float
+					std::stod(val);
+				}
+				/* std::stoll will throw except std::invalid_argument
+				   if no conversion could be performed; and
+				   throw std::out_of_range if the converted value would fall
+				   out of the range of the result type. */
+			} catch (...) {
+				res = false;
+			}
+		}
+		if (floatFlag)
+			addToken(Token::DoubleNumber, val.size());
+		else
+			addToken(Token::IntNumber, val.size());
+		m_striter = right_bound;
+		return res;
+	}
+
+	void skipSpace() {
+		m_striter += skipWhitespace(m_striter.ptr, sourceEnd()) - m_striter.ptr;
+	}
+
+	bool skipAnnotation() {
+		const char* right_pos;
+		const char* end = sourceEnd();
+		--m_striter;
+		if (*m_striter == '/' && *(m_striter + 1) == '/') {
+			/* single-line annotations */
+			right_pos = findByte(m_striter.ptr + 2, end, '\n');
+		} else if (*m_striter == '/' && *(m_striter + 1) == '*') {
+			/* multi-line annotations */
+			right_pos = findCommentEnd(m_striter.ptr + 2, end);
+			if (right_pos != end)
+				right_pos += 2;
+		} else {
+			return false;
+		}
+		if (right_pos != end) {
+			m_striter += right_pos - m_striter.ptr;
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+	bool tokenizeString() {
+		const char* right_quot = findByte(m_striter.ptr + 1, sourceEnd(), '\"');
+		if (right_quot == sourceEnd()) {
+			return false;
+		}
+		addToken(Token::StringLiteral, static_cast<size_t>(right_quot + 1 - m_striter.ptr));
+		m_striter += right_quot + 1 - m_striter.ptr;
+		return true;
+	}
+
+	void addToken(Token tok, size_t length) {
+		m_tokens.push_back({static_cast<uint32_t>(m_tokStart.offset()), static_cast<uint32_t>(length), tok});
+		++m_tail;
+	}
+	const char* sourceEnd() const { return m_source.data() + m_source.size(); }
+
+	const CharStream& m_source;
+	CharStream::const_iterator m_striter;
+	CharStream::const_iterator m_tokStart;
+	std::vector<TokenInfo> m_tokens;
+	size_t m_tail = 0;
+	bool m_error = false;
+	bool m_done = false;
+};
+
+/* Operator-heavy but otherwise typical source. */
+const char* kSnippet = R"(struct Point { int x; int y; };
+function mix(int a, int b) returns (int) {
+    int c = a * b + (a - b) / 3 % 7;
+    c <<= 2; c >>= 1; c += a; c -= b; c *= 2; c /= 3; c %= 5;
+    if (a >= b && c != 0 || !(a <= b)) { c = c | a & b; }
+    while (c > 0) { c = c >> 1; a++; b--; }
+    // trailing comment with some words in it
+    /* a block comment */
+    return a == b ? c : -c ** 2;
+}
+)";
+
+std::filesystem::path writeInput(size_t bytes) {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "minisolc_lexer_bench.sol";
+	std::ofstream out(path, std::ios::binary);
+	size_t snippet = std::char_traits<char>::length(kSnippet);
+	for (size_t written = 0; written < bytes; written += snippet) {
+		out << kSnippet;
+	}
+	return path;
+}
+
+template <typename F> double bestSeconds(size_t runs, F&& run) {
+	double best = 1e30;
+	for (size_t i = 0; i < runs; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+void report(const char* name, size_t tokens, double mib, double seconds) {
+	std::printf("%-8s %10zu tokens %9.1f MiB/s %8.1f Mtok/s\n", name, tokens, mib / seconds, tokens / seconds / 1e6);
+}
+
+}
+
+int main(int argc, const char* argv[]) {
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+	size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+	std::filesystem::path path = writeInput(megabytes << 20);
+	Preprocess preprocess(path);
+	double mib = static_cast<double>(preprocess.source().size()) / (1 << 20);
+
+	size_t dfaTokens = 0, legacyTokens = 0;
+	double dfa = bestSeconds(runs, [&] {
+		TokenStream tokens(preprocess);
+		dfaTokens = 1;
+		while (tokens.advance())
+			++dfaTokens;
+	});
+	double legacy = bestSeconds(runs, [&] {
+		LegacyLexer lexer(preprocess.source());
+		legacyTokens = lexer.size();
+	});
+
+	std::printf("input: %.1f MiB, best of %zu runs\n", mib, runs);
+	report("dfa", dfaTokens, mib, dfa);
+	report("switch", legacyTokens, mib, legacy);
+	std::printf("speedup: %.2fx\n", legacy / dfa);
+	std::filesystem::remove(path);
+}
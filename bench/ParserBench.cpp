@@ -0,0 +1,520 @@
+#include "common/Error.h"
+#include "lexer/TokenStream.h"
+#include "parser/AstArena.h"
+#include "parser/Parser.h"
+#include "preprocess/Preprocess.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Parser micro-benchmark: parses a generated source that is already tokenized and reports
+   the time, heap allocations and allocated bytes per token, for the parser and for a model of
+   the one before user-018, with token predicates as std::function (before user-017) and as
+   function pointers (user-017).
+
+   Usage: parser_bench [megabytes] [runs] */
+
+using namespace minisolc;
+
+namespace {
+
+size_t g_allocations = 0;
+size_t g_allocatedBytes = 0;
+
+/* Typical statements and expressions; every construct the parser accepts is in here. */
+const char* kSnippet = R"(struct Point { int x; int y; };
+int counter = 0;
+function mix(int a, int b) returns (int) {
+    int c = a * b + (a - b) / 3 % 7;
+    c += a; c -= b; c = c << 2;
+    if (a >= b && c != 0 || !(a <= b)) { c = c | a & b; } else { c = -c; }
+    while (c > 0) { c = c >> 1; a++; --b; }
+    for (int i = 0; i < 10; ++i) { counter = counter + mix(i, c); }
+    do { c = c - 1; } while (c > a);
+    struct Point p;
+    p.x = values[a] + 1;
+    return a == b;
+}
+)";
+
+std::filesystem::path writeInput(size_t bytes) {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "minisolc_parser_bench.sol";
+	std::ofstream out(path, std::ios::binary);
+	size_t snippet = std::char_traits<char>::length(kSnippet);
+	for (size_t written = 0; written < bytes; written += snippet) {
+		out << kSnippet;
+	}
+	return path;
+}
+
+/* The parser as it was before user-018, for the rules kSnippet uses: token tests take a
+   Predicate, matched values are copied into std::strings, every child list is a std::vector
+   of its own, and expressions use user-017's operator-precedence loop. Nodes are the same and
+   go into an arena as they do now. There is no error recovery; the input is well-formed. */
+template <typename Predicate> class LegacyParser {
+public:
+	explicit LegacyParser(TokenStream& source): m_source(source) {}
+
+	SourceUnit* parse() {
+		std::vector<BaseAST*> subnodes;
+		while (!match(Token::EOS)) {
+			if (peekCur(Token::Function)) {
+				subnodes.push_back(parseFunctionDefinition());
+			} else if (peekCur(isType)) {
+				subnodes.push_back(parseVariableDefinition());
+				expect(Token::Semicolon);
+			} else if (peekCur(Token::Struct)) {
+				subnodes.push_back(parseStructDefinition());
+				expect(Token::Semicolon);
+			} else {
+				subnodes.push_back(parseStatement());
+			}
+		}
+		return m_arena.make<SourceUnit>(m_arena.list(subnodes));
+	}
+
+private:
+	struct PendingOp {
+		Token tok;
+		int precedence;
+	};
+
+	static constexpr int kPrefixPrecedence = precedence(Token::Exp) + 1;
+
+	static bool isInfixOp(Token tok) {
+		return (isBinaryOp(tok) || isCompareOp(tok)) && precedence(tok) >= precedence(Token::Or);
+	}
+
+	Token curTok() const { return m_source.curTok(); }
+	void advance() { m_source.advance(); }
+	[[noreturn]] void fail() const { throw ParseError(m_source.curTokInfo(), m_source.curLoc()); }
+
+	bool peekCur(Token tok) const { return curTok() == tok; }
+	bool peekCur(Predicate func) const { return func(curTok()); }
+	bool match(Token tok) {
+		bool res = curTok() == tok;
+		if (res)
+			advance();
+		return res;
+	}
+	bool match(Predicate func) {
+		bool res = func(curTok());
+		if (res)
+			advance();
+		return res;
+	}
+	bool matchGet(Token tok, std::string& val) {
+		val = m_source.curVal();
+		return match(tok);
+	}
+	bool matchGet(Predicate func, std::string& val) {
+		val = m_source.curVal();
+		return match(func);
+	}
+	void expect(Token tok) {
+		if (!match(tok))
+			fail();
+	}
+	void expectGet(Token tok, std::string& val) {
+		if (!matchGet(tok, val))
+			fail();
+	}
+	void expectGet(Predicate func, std::string& val) {
+		if (!matchGet(func, val))
+			fail();
+	}
+
+	VariableDefinition* parseVariableDefinition() {
+		std::string name;
+		TypeName* type = parseTypeName();
+		Expression* expr = nullptr;
+		expectGet(Token::Identifier, name);
+		if (match(Token::Assign))
+			expr = parseExpression();
+		return m_arena.make<PlainVariableDefinition>(m_arena.copy(name), type, expr);
+	}
+
+	StructDefinition* parseStructDefinition() {
+		std::string name;
+		expect(Token::Struct);
+		TypeName* type = m_arena.make<ElementaryTypeName>(Token::Struct);
+		expectGet(Token::Identifier, name);
+		if (match(Token::LBrace)) {
+			std::vector<VariableDefinition*> members;
+			while (!match(Token::RBrace)) {
+				members.push_back(parseVariableDefinition());
+				match(Token::Semicolon);
+			}
+			std::string_view structName = m_arena.copy(name);
+			return m_arena.make<StructDefinition>(structName, m_arena.list(members), false, structName, type);
+		}
+		std::string var;
+		Expression* expr = nullptr;
+		expectGet(Token::Identifier, var);
+		if (match(Token::Assign))
+			expr = parseExpression();
+		return m_arena.make<
+			StructDefinition>(m_arena.copy(var), AstList<VariableDefinition>{}, true, m_arena.copy(name), type, expr);
+	}
+
+	FunctionDefinition* parseFunctionDefinition() {
+		std::string name;
+		std::string vis;
+		Visibility visibility{Visibility::Default};
+		TypeName* returnType = nullptr;
+		Block* block = nullptr;
+
+		expect(Token::Function);
+		expectGet(Token::Identifier, name);
+		ParameterList* paramList = parseParameterList();
+		if (matchGet(isVisibility, vis))
+			visibility = visibilityByName(vis);
+		expect(Token::Returns);
+		expect(Token::LParen);
+		if (!match(Token::RParen)) {
+			returnType = parseTypeName();
+			expect(Token::RParen);
+		}
+		if (returnType == nullptr)
+			returnType = m_arena.make<ElementaryTypeName>(Token::Void);
+		if (peekCur(Token::LBrace))
+			block = parseBlock();
+		else
+			expect(Token::Semicolon);
+		return m_arena.make<FunctionDefinition>(m_arena.copy(name), paramList, visibility, returnType, block);
+	}
+
+	ParameterList* parseParameterList() {
+		std::vector<VariableDefinition*> params;
+		expect(Token::LParen);
+		if (match(Token::RParen))
+			return nullptr;
+		do {
+			params.push_back(parseVariableDefinition());
+		} while (match(Token::Comma));
+		expect(Token::RParen);
+		return m_arena.make<ParameterList>(m_arena.list(params));
+	}
+
+	TypeName* parseTypeName() {
+		std::string type;
+		expectGet(isType, type);
+		return m_arena.make<ElementaryTypeName>(keywordByName(type), integerTypeBits(type));
+	}
+
+	Block* parseBlock() {
+		std::vector<Statement*> stmts;
+		expect(Token::LBrace);
+		while (!match(Token::RBrace)) {
+			if (Statement* stmt = parseStatement())
+				stmts.push_back(stmt);
+		}
+		return m_arena.make<Block>(m_arena.list(stmts));
+	}
+
+	Statement* parseStatement() {
+		Statement* stmt = nullptr;
+		if (match(Token::Return)) {
+			Expression* expr = peekCur(Token::Semicolon) ? nullptr : parseExpression();
+			stmt = m_arena.make<ReturnStatement>(expr);
+			expect(Token::Semicolon);
+		} else if (match(Token::If)) {
+			Expression* condition = parseCondition();
+			Statement* thenStatement = parseStatement();
+			Statement* elseStatement = match(Token::Else) ? parseStatement() : nullptr;
+			stmt = m_arena.make<IfStatement>(condition, thenStatement, elseStatement);
+		} else if (match(Token::While)) {
+			Expression* condition = parseCondition();
+			stmt = m_arena.make<WhileStatement>(condition, parseStatement());
+		} else if (match(Token::For)) {
+			expect(Token::LParen);
+			SimpleStatement* init = nullptr;
+			if (peekCur(isType))
+				init = parseVariableDefinition();
+			else
+				init = m_arena.make<ExpressionStatement>(parseExpression());
+			expect(Token::Semicolon);
+			Expression* condition = parseExpression();
+			expect(Token::Semicolon);
+			Expression* step = parseExpression();
+			expect(Token::RParen);
+			stmt = m_arena.make<ForStatement>(init, condition, step, parseStatement());
+		} else if (match(Token::Do)) {
+			Statement* body = parseStatement();
+			expect(Token::While);
+			stmt = m_arena.make<DoWhileStatement>(parseCondition(), body);
+			expect(Token::Semicolon);
+		} else if (peekCur(isType)) {
+			stmt = parseVariableDefinition();
+			expect(Token::Semicolon);
+		} else if (peekCur(Token::Struct)) {
+			stmt = parseStructDefinition();
+			expect(Token::Semicolon);
+		} else if (peekCur(Token::LBrace)) {
+			stmt = parseBlock();
+		} else {
+			stmt = m_arena.make<ExpressionStatement>(parseExpression());
+			expect(Token::Semicolon);
+		}
+		return stmt;
+	}
+
+	Expression* parseCondition() {
+		expect(Token::LParen);
+		Expression* condition = parseExpression();
+		expect(Token::RParen);
+		return condition;
+	}
+
+	Expression* parseExpression() {
+		const size_t opBase = m_pendingOps.size();
+		size_t openGroups = 0;
+		auto reduce = [&] {
+			PendingOp op = m_pendingOps.back();
+			m_pendingOps.pop_back();
+			Expression* rhs = m_operands.back();
+			m_operands.pop_back();
+			if (op.precedence == kPrefixPrecedence)
+				m_operands.push_back(m_arena.make<UnaryOp>(op.tok, rhs, true));
+			else if (isAssignmentOp(op.tok))
+				m_operands.back() = m_arena.make<Assignment>(m_operands.back(), op.tok, rhs);
+			else
+				m_operands.back() = m_arena.make<BinaryOp>(m_operands.back(), op.tok, rhs);
+		};
+		auto reduceAbove = [&](int precedence, bool leftAssociative) {
+			while (m_pendingOps.size() > opBase) {
+				int top = m_pendingOps.back().precedence;
+				if (top == 0 || top < precedence || (top == precedence && !leftAssociative))
+					break;
+				reduce();
+			}
+		};
+
+		for (;;) {
+			Token tok = curTok();
+			if (isUnaryOp(tok)) {
+				advance();
+				m_pendingOps.push_back({tok, kPrefixPrecedence});
+				continue;
+			}
+			if (tok == Token::LParen) {
+				advance();
+				m_pendingOps.push_back({tok, 0});
+				++openGroups;
+				continue;
+			}
+			m_operands.push_back(parsePostfixExpression(parsePrimaryExpression()));
+			while (openGroups > 0 && curTok() == Token::RParen) {
+				reduceAbove(1, true);
+				m_pendingOps.pop_back();
+				--openGroups;
+				advance();
+				m_operands.back() = parsePostfixExpression(m_operands.back());
+			}
+			tok = curTok();
+			if (isInfixOp(tok) || isAssignmentOp(tok)) {
+				reduceAbove(precedence(tok), !isAssignmentOp(tok));
+				advance();
+				m_pendingOps.push_back({tok, precedence(tok)});
+				continue;
+			}
+			if (openGroups > 0)
+				fail();
+			reduceAbove(1, true);
+			break;
+		}
+		Expression* expr = m_operands.back();
+		m_operands.pop_back();
+		return expr;
+	}
+
+	Expression* parsePrimaryExpression() {
+		Token tok = curTok();
+		std::string value;
+		if (tok == Token::Identifier) {
+			value = m_source.curVal();
+			advance();
+			return m_arena.make<Identifier>(m_arena.copy(value));
+		}
+		expectGet(isLiteral, value);
+		if (tok == Token::TrueLiteral || tok == Token::FalseLiteral)
+			return m_arena.make<BooleanLiteral>(m_arena.copy(value));
+		if (tok == Token::StringLiteral)
+			return m_arena.make<StringLiteral>(m_arena.copy(value));
+		return m_arena.make<NumberLiteral>(
+			m_arena.copy(value), tok == Token::DoubleNumber ? Type::DOUBLE : Type::INTEGER);
+	}
+
+	Expression* parsePostfixExpression(Expression* expr) {
+		std::string value;
+		for (;;) {
+			Token tok = curTok();
+			switch (tok) {
+			case Token::LBrack: {
+				advance();
+				Expression* index = parseExpression();
+				expect(Token::RBrack);
+				expr = m_arena.make<IndexAccess>(expr, index);
+				break;
+			}
+			case Token::Period:
+				advance();
+				expectGet(Token::Identifier, value);
+				expr = m_arena.make<MemberAccess>(expr, m_arena.copy(value));
+				break;
+			case Token::LParen: {
+				advance();
+				std::vector<Expression*> args;
+				if (curTok() != Token::RParen) {
+					args.push_back(parseExpression());
+					while (match(Token::Comma))
+						args.push_back(parseExpression());
+				}
+				expect(Token::RParen);
+				expr = m_arena.make<FunctionCall>(expr, m_arena.list(args));
+				break;
+			}
+			case Token::Inc:
+				[[fallthrough]];
+			case Token::Dec:
+				advance();
+				return m_arena.make<UnaryOp>(tok, expr, false);
+			default:
+				return expr;
+			}
+		}
+	}
+
+	TokenStream& m_source;
+	AstArena m_arena;
+	std::vector<PendingOp> m_pendingOps;
+	std::vector<Expression*> m_operands;
+};
+
+struct Result {
+	double seconds = 1e30;
+	size_t allocations = 0;
+	size_t bytes = 0;
+	size_t items = 0; // top-level items, to check every path parsed the whole input
+};
+
+/* Best time of runs; the allocation counts are those of the last run. */
+template <typename Parse> Result measure(Preprocess& preprocess, size_t runs, Parse&& parse) {
+	Result result;
+	for (size_t i = 0; i < runs; ++i) {
+		TokenStream stream(preprocess);
+		size_t allocationsBefore = g_allocations, bytesBefore = g_allocatedBytes;
+		auto start = std::chrono::steady_clock::now();
+		result.items = parse(stream);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		result.seconds = std::min(result.seconds, elapsed.count());
+		result.allocations = g_allocations - allocationsBefore;
+		result.bytes = g_allocatedBytes - bytesBefore;
+	}
+	return result;
+}
+
+template <typename Predicate> size_t parseLegacy(TokenStream& stream) {
+	LegacyParser<Predicate> parser(stream);
+	return parser.parse()->getSubNodes().size();
+}
+
+/* Every replaceable allocation function comes here, so nothing is missed. Kept out of line so
+   that the compiler does not pair a malloc it can see with the delete of a new. */
+[[gnu::noinline]] void* countedAlloc(size_t size, size_t align) {
+	++g_allocations;
+	g_allocatedBytes += size;
+	if (size == 0)
+		size = 1;
+	if (align <= alignof(std::max_align_t))
+		return std::malloc(size);
+	/* aligned_alloc wants a size that is a multiple of the alignment. */
+	return std::aligned_alloc(align, (size + align - 1) & ~(align - 1));
+}
+
+[[gnu::noinline]] void countedFree(void* p) noexcept { std::free(p); }
+
+void* allocOrThrow(size_t size, size_t align) {
+	if (void* p = countedAlloc(size, align))
+		return p;
+	throw std::bad_alloc();
+}
+
+}
+
+void* operator new(size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t align) { return allocOrThrow(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return allocOrThrow(size, static_cast<size_t>(align)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return countedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return countedAlloc(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return countedAlloc(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+
+int main(int argc, const char* argv[]) {
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+	size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+	std::filesystem::path path = writeInput(megabytes << 20);
+	Preprocess preprocess(path);
+
+	size_t tokens = 0;
+	{
+		TokenStream stream(preprocess);
+		for (tokens = 1; stream.advance();)
+			++tokens;
+	}
+
+	struct Row {
+		const char* name;
+		Result result;
+	};
+	Row rows[] = {
+		{"std::function", measure(preprocess, runs, parseLegacy<std::function<bool(Token)>>)},
+		{"function pointer", measure(preprocess, runs, parseLegacy<bool (*)(Token)>)},
+		{"Parser", measure(preprocess, runs, [](TokenStream& stream) {
+			 Parser parser(stream);
+			 parser.parse();
+			 return static_cast<SourceUnit*>(parser.GetAst())->getSubNodes().size();
+		 })},
+	};
+	std::filesystem::remove(path);
+
+	std::printf("input: %.1f MiB, %zu tokens, best of %zu runs\n",
+		static_cast<double>(preprocess.source().size()) / (1 << 20), tokens, runs);
+	std::printf("%-18s %10s %14s %12s\n", "", "ns/token", "allocs/token", "bytes/token");
+	for (const Row& row: rows) {
+		if (row.result.items != rows[0].result.items) {
+			std::fprintf(stderr, "%s parsed %zu top-level items, expected %zu\n", row.name, row.result.items,
+				rows[0].result.items);
+			return 1;
+		}
+		std::printf("%-18s %10.2f %14.3f %12.2f\n", row.name, row.result.seconds * 1e9 / tokens,
+			static_cast<double>(row.result.allocations) / tokens, static_cast<double>(row.result.bytes) / tokens);
+	}
+}
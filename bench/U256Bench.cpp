@@ -0,0 +1,162 @@
+#include "u256.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/* 256-bit arithmetic micro-benchmark: times i256 operations JIT-compiled the two ways code
+   generation can emit them, as LLVM's own lowering and as a call into the kernels of
+   runtime/u256.c through memory, which is what CodeGenerator does for uint256 and int256.
+   LLVM 14 has no lowering for 256-bit division and none for exponentiation, so those rows
+   only have a runtime time.
+
+   Usage: u256_bench [thousands of operations] [runs] */
+
+namespace {
+
+using Value = std::array<uint64_t, 4>;
+using Function = void (*)(Value*, const Value*, const Value*);
+
+struct Operation {
+	const char* name;
+	const char* kernel;
+	void (*address)(uint64_t*, const uint64_t*, const uint64_t*);
+	bool hasNative;
+	llvm::Instruction::BinaryOps opcode; // of the native lowering
+};
+
+const Operation kOperations[] = {
+	{"mul", "minisolc_u256_mul", minisolc_u256_mul, true, llvm::Instruction::Mul},
+	{"div", "minisolc_u256_div", minisolc_u256_div, false, llvm::Instruction::UDiv},
+	{"mod", "minisolc_u256_mod", minisolc_u256_mod, false, llvm::Instruction::URem},
+	{"sdiv", "minisolc_i256_div", minisolc_i256_div, false, llvm::Instruction::SDiv},
+	{"exp", "minisolc_u256_exp", minisolc_u256_exp, false, llvm::Instruction::Mul},
+};
+
+/* native_<name> computes *r = *a op *b inline; runtime_<name> stores the loaded operands to
+   stack slots and calls the kernel, as CodeGenerator does. */
+std::unique_ptr<llvm::Module> buildModule(llvm::LLVMContext& context) {
+	auto module = std::make_unique<llvm::Module>("u256_bench", context);
+	llvm::IRBuilder<> builder(context);
+	llvm::Type* i256 = builder.getIntNTy(256);
+	llvm::Type* ptr = i256->getPointerTo();
+	llvm::FunctionType* type = llvm::FunctionType::get(builder.getVoidTy(), {ptr, ptr, ptr}, false);
+	auto define = [&](const std::string& name) {
+		llvm::Function* function = llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, *module);
+		builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", function));
+		return function;
+	};
+	for (const Operation& op: kOperations) {
+		if (op.hasNative) {
+			llvm::Function* function = define(std::string("native_") + op.name);
+			llvm::Value* a = builder.CreateLoad(i256, function->getArg(1));
+			llvm::Value* b = builder.CreateLoad(i256, function->getArg(2));
+			builder.CreateStore(builder.CreateBinOp(op.opcode, a, b), function->getArg(0));
+			builder.CreateRetVoid();
+		}
+		llvm::Function* kernel = llvm::Function::Create(type, llvm::Function::ExternalLinkage, op.kernel, *module);
+		llvm::Function* function = define(std::string("runtime_") + op.name);
+		llvm::Value* a = builder.CreateLoad(i256, function->getArg(1));
+		llvm::Value* b = builder.CreateLoad(i256, function->getArg(2));
+		llvm::AllocaInst* slots[3];
+		for (llvm::AllocaInst*& slot: slots) {
+			slot = builder.CreateAlloca(i256);
+			slot->setAlignment(llvm::Align(16));
+		}
+		builder.CreateStore(a, slots[1]);
+		builder.CreateStore(b, slots[2]);
+		builder.CreateCall(kernel, {slots[0], slots[1], slots[2]});
+		builder.CreateStore(builder.CreateLoad(i256, slots[0]), function->getArg(0));
+		builder.CreateRetVoid();
+	}
+	return module;
+}
+
+Value randomValue(std::mt19937_64& random, unsigned bits) {
+	Value value {};
+	for (unsigned i = 0; i < 4; ++i) {
+		if (bits >= 64 * (i + 1))
+			value[i] = random();
+		else if (bits > 64 * i)
+			value[i] = random() >> (64 - bits % 64);
+	}
+	return value;
+}
+
+/* Full-width operands, except divisors of 64 to 256 bits for the division kernel's paths and
+   exponents below 256 for exp. */
+void makeOperands(const Operation& op, size_t count, std::vector<Value>& a, std::vector<Value>& b) {
+	std::mt19937_64 random(42);
+	a.resize(count);
+	b.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		a[i] = randomValue(random, 256);
+		if (op.hasNative)
+			b[i] = randomValue(random, 256);
+		else if (std::string(op.name) == "exp")
+			b[i] = randomValue(random, 8);
+		else
+			b[i] = randomValue(random, 64 * (1 + random() % 4));
+	}
+}
+
+double nanosecondsPerOperation(Function function, const std::vector<Value>& a, const std::vector<Value>& b,
+	std::vector<Value>& r, size_t runs) {
+	double best = 1e30;
+	for (size_t run = 0; run < runs; ++run) {
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < a.size(); ++i)
+			function(&r[i], &a[i], &b[i]);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best * 1e9 / static_cast<double>(a.size());
+}
+
+}
+
+int main(int argc, const char* argv[]) {
+	size_t count = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000) * 1000;
+	size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
+	std::unique_ptr<llvm::orc::LLJIT> jit = llvm::cantFail(llvm::orc::LLJITBuilder().create());
+	llvm::orc::SymbolMap kernels;
+	for (const Operation& op: kOperations) {
+		kernels[jit->mangleAndIntern(op.kernel)] = llvm::JITEvaluatedSymbol(
+			llvm::pointerToJITTargetAddress(op.address), llvm::JITSymbolFlags::Exported);
+	}
+	llvm::cantFail(jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(kernels)));
+	auto context = std::make_unique<llvm::LLVMContext>();
+	std::unique_ptr<llvm::Module> module = buildModule(*context);
+	llvm::cantFail(jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))));
+	auto lookup = [&](const std::string& name) {
+		return reinterpret_cast<Function>(llvm::cantFail(jit->lookup(name)).getAddress());
+	};
+
+	std::printf("%zu operations per row, best of %zu runs, ns/operation\n", count, runs);
+	std::printf("%-5s %10s %10s\n", "op", "native", "runtime");
+	std::vector<Value> a, b, nativeResults(count), runtimeResults(count);
+	for (const Operation& op: kOperations) {
+		makeOperands(op, count, a, b);
+		double runtime = nanosecondsPerOperation(lookup(std::string("runtime_") + op.name), a, b, runtimeResults, runs);
+		if (!op.hasNative) {
+			std::printf("%-5s %10s %10.2f\n", op.name, "n/a", runtime);
+			continue;
+		}
+		double native = nanosecondsPerOperation(lookup(std::string("native_") + op.name), a, b, nativeResults, runs);
+		std::printf("%-5s %10.2f %10.2f%s\n", op.name, native, runtime,
+			nativeResults == runtimeResults ? "" : "  results differ!");
+	}
+}
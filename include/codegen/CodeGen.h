@@ -3,6 +3,7 @@
 #include "codegen/llvmheaders.h"
 #include "common/Defs.h"
 #include "parser/Ast.h"
+#include "parser/AstVisitor.h"
 
 
 #include <llvm/IR/Value.h>
@@ -10,21 +11,26 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <string_view>
 #include <algorithm>
 
 namespace minisolc {
 
 struct CodeGeneratorBlock {
 	llvm::Value* returnValue;
-	std::map<std::string, llvm::Value*> locals;
-	std::map<std::string, llvm::Type*> types;
 	std::vector<std::shared_ptr<MyStructType> > structdefs;
 };
 
-class CodeGenerator {
+/* A named variable: its storage and the type stored there. */
+struct CodeGeneratorSymbol {
+	llvm::Value* value;
+	llvm::Type* type;
+};
+
+class CodeGenerator: public AstVisitor<CodeGenerator, llvm::Value*, bool, bool> {
 public:
-	CodeGenerator(const std::shared_ptr<BaseAST>& AstRoot) {
-		m_BlockStack.push_back({nullptr, {}, {}, {}});
+	CodeGenerator(BaseAST* AstRoot) {
+		m_BlockStack.push_back({nullptr, {}});
 		createSyscall();
 		generate(AstRoot);
 		LOG_INFO("Codegen  Succeeds.");
@@ -37,6 +43,8 @@ private:
 	static std::unique_ptr<llvm::IRBuilder<>> m_Builder;
 	static std::unique_ptr<llvm::Module> m_Module;
 	std::vector<CodeGeneratorBlock> m_BlockStack;
+	/* Variables by declaration slot, which NameResolver stored on every declaration and identifier. */
+	std::vector<CodeGeneratorSymbol> m_symbols;
 	std::map<std::string, llvm::Function*> m_syscalls;
 
 	/**
@@ -46,25 +54,49 @@ private:
 	 * @param isleftval Used in array and struct, determine whether returns a pointer (for leftvalue) or a value (for right value)
 	 * @return The value of the AST
 	 */
-	llvm::Value* generate(const std::shared_ptr<BaseAST>& AstRoot, bool beginBlock = true, bool isleftval = false);
+	llvm::Value* generate(BaseAST* AstRoot, bool beginBlock = true, bool isleftval = false) {
+		return visit(AstRoot, beginBlock, isleftval);
+	}
 
-	llvm::Value* getSymbolValue(const std::string& name) const {
-		for (auto it = m_BlockStack.rbegin(); it != m_BlockStack.rend(); ++it) {
-			if (it->locals.find(name) != it->locals.end()) {
-				return it->locals.at(name);
-			}
-		}
-		return nullptr;
+	/* One handler per node kind, dispatched by AstVisitor::visit(). */
+	friend class AstVisitor<CodeGenerator, llvm::Value*, bool, bool>;
+	llvm::Value* visitSourceUnit(SourceUnit* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitPlainVariableDefinition(PlainVariableDefinition* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitArrayDefinition(ArrayDefinition* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitStructDefinition(StructDefinition* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitBlock(Block* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitFunctionDefinition(FunctionDefinition* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitReturnStatement(ReturnStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitIdentifier(Identifier* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitBooleanLiteral(BooleanLiteral* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitStringLiteral(StringLiteral* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitNumberLiteral(NumberLiteral* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitAssignment(Assignment* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitBinaryOp(BinaryOp* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitUnaryOp(UnaryOp* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitIfStatement(IfStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitWhileStatement(WhileStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitForStatement(ForStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitDoWhileStatement(DoWhileStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitBreakStatement(BreakStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitContinueStatement(ContinueStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitExpressionStatement(ExpressionStatement* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitIndexAccess(IndexAccess* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitFunctionCall(FunctionCall* node, bool beginBlock, bool isleftval);
+	llvm::Value* visitMemberAccess(MemberAccess* node, bool beginBlock, bool isleftval);
+
+	const CodeGeneratorSymbol* findSymbol(const Identifier* id) const {
+		return id->GetSlot() < m_symbols.size() ? &m_symbols[id->GetSlot()] : nullptr;
+	}
+	llvm::Value* getSymbolValue(const Identifier* id) const {
+		const CodeGeneratorSymbol* symbol = findSymbol(id);
+		return symbol != nullptr ? symbol->value : nullptr;
 	};
-	llvm::Type* getSymbolType(const std::string& name) const {
-		for (auto it = m_BlockStack.rbegin(); it != m_BlockStack.rend(); ++it) {
-			if (it->types.find(name) != it->types.end()) {
-				return it->types.at(name);
-			}
-		}
-		return nullptr;
+	llvm::Type* getSymbolType(const Identifier* id) const {
+		const CodeGeneratorSymbol* symbol = findSymbol(id);
+		return symbol != nullptr ? symbol->type : nullptr;
 	};
-	std::shared_ptr<MyStructType> getStructType(const std::string& name) const {
+	std::shared_ptr<MyStructType> getStructType(std::string_view name) const {
 		for(auto it = m_BlockStack.crbegin(); it != m_BlockStack.crend(); ++it) {
 			auto findres = std::find_if(it->structdefs.cbegin(), it->structdefs.cend(), 
 				[s = llvm::StringRef(name)](const auto& st) { return st->GetStructType()->getStructName() == s; });
@@ -73,24 +105,31 @@ private:
 		}
 		return nullptr;
 	}
-	std::shared_ptr<MyStructType> getStructSymbolType(const std::string& name) const {
-		for (auto it = m_BlockStack.rbegin(); it != m_BlockStack.rend(); ++it) {
-			if (it->types.find(name) != it->types.end()) {
-				return this->getStructType(it->types.at(name)->getStructName().str());
-			}
-		}
-		return nullptr;
+	std::shared_ptr<MyStructType> getStructSymbolType(const Identifier* id) const {
+		llvm::Type* type = getSymbolType(id);
+		return type != nullptr ? this->getStructType(type->getStructName()) : nullptr;
 	}
 	llvm::Value* getReturnValue() const { return m_BlockStack.back().returnValue; };
-	void setSymbolValue(const std::string& name, llvm::Value* value) { m_BlockStack.back().locals[name] = value; };
-	void setSymbolType(const std::string& name, llvm::Type* type) { m_BlockStack.back().types[name] = type; };
+	void setSymbol(const Declaration* declaration, llvm::Value* value, llvm::Type* type) {
+		if (declaration->GetSlot() >= m_symbols.size())
+			m_symbols.resize(declaration->GetSlot() + 1, {nullptr, nullptr});
+		m_symbols[declaration->GetSlot()] = {value, type};
+	};
 	void setReturnValue(llvm::Value* value) { m_BlockStack.back().returnValue = value; };
-	void pushBlock() { m_BlockStack.push_back({nullptr, {}, {}, {}}); };
+	void pushBlock() { m_BlockStack.push_back({nullptr, {}}); };
 	void popBlock() { m_BlockStack.pop_back(); };
 
 
-	static llvm::Constant* getInitValue(Token tok);
-	static llvm::Type* getLLVMType(Token type);
+	/// bits is the width of integer types and ignored for the others.
+	static llvm::Constant* getInitValue(Token tok, uint16_t bits = 32);
+	static llvm::Type* getLLVMType(Token type, uint16_t bits = 32);
+	static llvm::Type* getLLVMType(TypeName* type) { return getLLVMType(type->GetType(), type->GetBits()); }
+	/// Extend or truncate an integer value to type; bools are never sign-extended.
+	static llvm::Value* convertInteger(llvm::Value* value, llvm::Type* type, bool isSigned);
+	/// Call the kernel name of runtime/u256.h on two i256 values.
+	llvm::Value* callU256Kernel(const char* name, llvm::Value* lhs, llvm::Value* rhs);
+	/// base ** exponent as a square-and-multiply loop at the base's width, the exponent unsigned.
+	llvm::Value* emitPower(llvm::Value* base, llvm::Value* exponent);
 
 	void createSyscall();
 };
@@ -3,6 +3,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
 
 #include "common/Defs.h"
@@ -15,7 +16,7 @@ public:
         Names.push_back(sr); 
     }
     std::string getNameAtIndex(unsigned N) const { return Names.at(N); }
-    unsigned findIndexofName(const std::string& name) const {
+    unsigned findIndexofName(std::string_view name) const {
         auto finditer = std::find(Names.cbegin(), Names.cend(), name);
         if (finditer == Names.cend())
             return static_cast<unsigned>(-1);
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <exception>
-#include <functional>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -27,17 +26,19 @@ private:
 
 class ParseError: public Error {
 public:
-	ParseError(TokenInfo tokInfo): Error("Parse Error"), m_tokinfo(tokInfo) {}
+	ParseError(TokenInfo tokInfo, Location loc): Error("Parse Error"), m_tokinfo(tokInfo), m_loc(std::move(loc)) {}
 	void print() const {};
+	/// A heap copy of the most derived error, for keeping it past the catch block.
+	virtual std::unique_ptr<ParseError> clone() const { return std::make_unique<ParseError>(*this); }
 
 protected:
 	void printErrorLine(std::string msg = "", std::string shortMsg = "") const {
-		std::string filename = m_tokinfo.m_loc.m_line->fileName;
-		std::string line = m_tokinfo.m_loc.m_line->source;
-		size_t idx = m_tokinfo.m_loc.m_line->lineNumber;
-		size_t start = m_tokinfo.m_loc.m_start;
-		size_t end = m_tokinfo.m_loc.m_end;
-		std::shared_ptr<Line> include = m_tokinfo.m_loc.m_line->includeLine;
+		std::string filename = m_loc.m_line->fileName;
+		std::string line = m_loc.m_line->source;
+		size_t idx = m_loc.m_line->lineNumber;
+		size_t start = m_loc.m_start;
+		size_t end = m_loc.m_end;
+		std::shared_ptr<Line> include = m_loc.m_line->includeLine;
 
 		// error:
 		std::cout << DARKRED << "ERROR: " << RESET << msg;
@@ -70,13 +71,16 @@ protected:
 	}
 
 	TokenInfo m_tokinfo;
+	Location m_loc;
 };
 
 class UnexpectedToken: public ParseError {
 public:
 	/// TODO: 有可能有Token和func同时的情况以及前者为vector的情况
-	UnexpectedToken(TokenInfo tokInfo, Token expectTok): ParseError(tokInfo) { m_expectTok.push_back(expectTok); }
-	UnexpectedToken(TokenInfo tokInfo, std::function<bool(Token)> func): ParseError(tokInfo) {
+	UnexpectedToken(TokenInfo tokInfo, Location loc, Token expectTok): ParseError(tokInfo, std::move(loc)) { m_expectTok.push_back(expectTok); }
+	/// Expects any token pred accepts, such as isType.
+	template <typename Pred>
+	UnexpectedToken(TokenInfo tokInfo, Location loc, Pred func): ParseError(tokInfo, std::move(loc)) {
 		for (int i = 0; i < static_cast<int>(Token::NUM_TOKENS); i++) {
 			if (func(static_cast<Token>(i))) {
 				m_expectTok.push_back(static_cast<Token>(i));
@@ -84,6 +88,7 @@ public:
 		}
 	}
 
+	std::unique_ptr<ParseError> clone() const override { return std::make_unique<UnexpectedToken>(*this); }
 	void print() const override {
 		std::stringstream ss;
 		std::string shortMsg;
@@ -113,7 +118,10 @@ private:
 
 class ContractDefinitionParseError: public ParseError {
 public:
-	ContractDefinitionParseError(TokenInfo tokInfo): ParseError(tokInfo) {}
+	ContractDefinitionParseError(TokenInfo tokInfo, Location loc): ParseError(tokInfo, std::move(loc)) {}
+	std::unique_ptr<ParseError> clone() const override {
+		return std::make_unique<ContractDefinitionParseError>(*this);
+	}
 	void print() const override {
 		std::stringstream ss;
 		std::string shortMsg;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace minisolc {
+
+/// 64-bit FNV-1a, usable at compile time.
+constexpr uint64_t fnv1a(std::string_view s) {
+	uint64_t h = 14695981039346656037ull;
+	for (char c: s) {
+		h ^= static_cast<uint8_t>(c);
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+/// Finalizer of MurmurHash3: spreads every input bit over the whole word.
+constexpr uint64_t mix64(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ull;
+	x ^= x >> 33;
+	return x;
+}
+
+}
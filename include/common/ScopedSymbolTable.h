@@ -0,0 +1,118 @@
+#pragma once
+
+#include "common/Defs.h"
+#include "common/StringInterner.h"
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace minisolc {
+
+/* Nested scopes of name -> T bindings. Names are interned, and one open-addressing table maps
+   each id to its innermost binding, which links to the binding it shadows. Bindings are stored
+   in declaration order, so that list doubles as the undo log: closing a scope pops its bindings
+   and restores what they shadowed. A lookup costs the same at any nesting depth. The table
+   starts with one open, outermost scope. */
+template <typename T>
+class ScopedSymbolTable {
+public:
+	ScopedSymbolTable(): m_slots(16) { m_scopes.push_back(0); }
+
+	void pushScope() { m_scopes.push_back(static_cast<uint32_t>(m_bindings.size())); }
+	void popScope() {
+		ASSERT(m_scopes.size() > 1, "Cannot close the outermost scope.");
+		uint32_t begin = m_scopes.back();
+		m_scopes.pop_back();
+		while (m_bindings.size() > begin) {
+			const Binding& binding = m_bindings.back();
+			findSlot(binding.id)->binding = binding.shadowed;
+			m_bindings.pop_back();
+		}
+	}
+	size_t depth() const { return m_scopes.size(); }
+
+	/// Binds name in the innermost scope; false, leaving the table unchanged, if it is bound there already.
+	bool declare(std::string_view name, T value) { return bind(m_names.intern(name), std::move(value), false); }
+	/// Binds name in the innermost scope, replacing the binding it has there, if any.
+	void assign(std::string_view name, T value) { bind(m_names.intern(name), std::move(value), true); }
+
+	/// The innermost binding of name, or nullptr.
+	T* find(std::string_view name) {
+		const Slot* slot = findSlot(m_names.find(name));
+		return slot == nullptr || slot->binding == 0 ? nullptr : &m_bindings[slot->binding - 1].value;
+	}
+	const T* find(std::string_view name) const { return const_cast<ScopedSymbolTable*>(this)->find(name); }
+
+private:
+	/* Binding and shadow links are indices into m_bindings plus one, so 0 means none. */
+	struct Binding {
+		uint32_t id;
+		uint32_t shadowed;
+		T value;
+	};
+	/* An id of 0 marks a free slot. Slots are never freed: a name whose bindings were all
+	   popped keeps its slot with binding 0. */
+	struct Slot {
+		uint32_t id = 0;
+		uint32_t binding = 0;
+	};
+
+	static size_t hashId(uint32_t id) { return id * 0x9e3779b1u; }
+
+	Slot* findSlot(uint32_t id) {
+		if (id == 0)
+			return nullptr;
+		size_t mask = m_slots.size() - 1;
+		for (size_t i = hashId(id) & mask;; i = (i + 1) & mask) {
+			if (m_slots[i].id == id)
+				return &m_slots[i];
+			if (m_slots[i].id == 0)
+				return nullptr;
+		}
+	}
+
+	Slot& insertSlot(uint32_t id) {
+		/* Keep the load at most one half, so probe runs stay short. */
+		if ((m_used + 1) * 2 > m_slots.size()) {
+			std::vector<Slot> old(m_slots.size() * 2);
+			old.swap(m_slots);
+			m_used = 0;
+			for (const Slot& slot: old) {
+				if (slot.id != 0)
+					insertSlot(slot.id).binding = slot.binding;
+			}
+		}
+		size_t mask = m_slots.size() - 1;
+		size_t i = hashId(id) & mask;
+		while (m_slots[i].id != 0 && m_slots[i].id != id)
+			i = (i + 1) & mask;
+		if (m_slots[i].id == 0) {
+			m_slots[i].id = id;
+			++m_used;
+		}
+		return m_slots[i];
+	}
+
+	bool bind(uint32_t id, T value, bool replace) {
+		Slot* slot = findSlot(id);
+		if (slot == nullptr)
+			slot = &insertSlot(id);
+		if (slot->binding > m_scopes.back()) {
+			if (replace)
+				m_bindings[slot->binding - 1].value = std::move(value);
+			return replace;
+		}
+		m_bindings.push_back({id, slot->binding, std::move(value)});
+		slot->binding = static_cast<uint32_t>(m_bindings.size());
+		return true;
+	}
+
+	StringInterner m_names;
+	std::vector<Slot> m_slots;
+	size_t m_used = 0;
+	std::vector<Binding> m_bindings;
+	std::vector<uint32_t> m_scopes;
+};
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace minisolc {
+
+/* Maps each distinct string to a small integer id, so that names can be stored and compared
+   as 32-bit values. Id 0 is the empty string and means "no value". Views returned by get()
+   stay valid for the lifetime of the interner. */
+class StringInterner {
+public:
+	StringInterner() {
+		m_strings.emplace_back();
+		m_ids.emplace(std::string_view(m_strings.front()), 0);
+	}
+
+	uint32_t intern(std::string_view s) {
+		auto it = m_ids.find(s);
+		if (it != m_ids.end())
+			return it->second;
+		uint32_t id = static_cast<uint32_t>(m_strings.size());
+		/* A deque never relocates its elements, so the key below keeps pointing at live storage. */
+		const std::string& stored = m_strings.emplace_back(s);
+		m_ids.emplace(std::string_view(stored), id);
+		return id;
+	}
+
+	/// The id of s if it was interned, else 0.
+	uint32_t find(std::string_view s) const {
+		auto it = m_ids.find(s);
+		return it == m_ids.end() ? 0 : it->second;
+	}
+
+	std::string_view get(uint32_t id) const { return m_strings[id]; }
+	size_t size() const { return m_strings.size(); }
+
+private:
+	std::deque<std::string> m_strings;
+	std::unordered_map<std::string_view, uint32_t> m_ids;
+};
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Defs.h"
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace minisolc {
+
+/* A fixed set of worker threads consuming a FIFO of tasks. submit() returns a future for
+   the task's result; the destructor finishes the queued tasks before joining. */
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+		if (threads == 0)
+			threads = 1;
+		for (size_t i = 0; i < threads; ++i) {
+			m_workers.emplace_back([this] { work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_ready.notify_all();
+		for (std::thread& worker: m_workers) {
+			worker.join();
+		}
+	}
+	DISALLOW_COPY_AND_MOVE(ThreadPool);
+
+	template <typename F> auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+		using R = std::invoke_result_t<std::decay_t<F>>;
+		auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+		std::future<R> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.emplace([packaged] { (*packaged)(); });
+		}
+		m_ready.notify_one();
+		return result;
+	}
+
+	size_t size() const { return m_workers.size(); }
+
+private:
+	void work() {
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_ready.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+				if (m_tasks.empty())
+					return;
+				task = std::move(m_tasks.front());
+				m_tasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	bool m_stopping = false;
+};
+
+}
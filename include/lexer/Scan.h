@@ -0,0 +1,22 @@
+#pragma once
+
+namespace minisolc {
+
+/* Scanning kernels for the lexer's long runs. Each scans [p, end) and never reads outside it.
+   On x86 they process 16 (SSE2) or 32 (AVX2) bytes per step, chosen once at startup from the
+   CPU's features; elsewhere, and for the final partial block, a scalar loop is used. Character
+   classes are ASCII, matching isspace/isalnumus in the "C" locale. */
+
+/// First byte in [p, end) that is not whitespace, or end.
+const char* skipWhitespace(const char* p, const char* end);
+
+/// First byte in [p, end) that is not a letter, digit or '_', or end.
+const char* skipIdentifier(const char* p, const char* end);
+
+/// First occurrence of c in [p, end), or end.
+const char* findByte(const char* p, const char* end, char c);
+
+/// Start of the first "*/" in [p, end), or end.
+const char* findCommentEnd(const char* p, const char* end);
+
+}
@@ -2,8 +2,10 @@
 
 #include "preprocess/CharStream.h"
 #include <cctype>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 
 
 namespace minisolc {
@@ -209,12 +211,13 @@ namespace minisolc {
 
 
 /// Token
-enum class Token : unsigned int {
+enum class Token : uint8_t {
 #define T(name, string, precedence) name,
 	TOKEN_LIST(T, T) NUM_TOKENS
 #undef T
 
 };
+static_assert(static_cast<unsigned>(Token::NUM_TOKENS) <= UINT8_MAX, "Token must fit in one byte");
 
 enum class StateMutability {
 	Nonpayable,
@@ -225,7 +228,8 @@ enum class StateMutability {
 
 enum class Visibility { Default, Private, Internal, Public, External };
 
-enum class Type {
+/* A byte wide, so an Expression's types and flat index fit in the padding after its node kind. */
+enum class Type : uint8_t {
 	UNKNOWN,
 	INTEGER,
 	DOUBLE,
@@ -235,24 +239,48 @@ enum class Type {
 	//... and other types if needed.
 };
 
-Token keywordByName(std::string _name);
+/* Width and signedness of an INTEGER value. int and uint are 32 bits wide, intM and uintM M bits. */
+struct IntegerType {
+	uint16_t bits = 32;
+	bool isSigned = true;
+
+	bool operator==(IntegerType other) const { return bits == other.bits && isSigned == other.isSigned; }
+	bool operator!=(IntegerType other) const { return !(*this == other); }
+};
+
+/// The type both operands of a binary operation are converted to: the wider one, and for equal
+/// widths unsigned unless both are signed.
+constexpr IntegerType commonIntegerType(IntegerType a, IntegerType b) {
+	if (a.bits != b.bits)
+		return a.bits > b.bits ? a : b;
+	return {a.bits, a.isSigned && b.isSigned};
+}
+
+Token keywordByName(std::string_view _name);
+/// The width of the integer type keyword _name: M for intM and uintM, 32 for int and uint, else 0.
+uint16_t integerTypeBits(std::string_view _name);
 char const* tokenToString(Token tok);
 
 StateMutability stateMutabilityByName(std::string _name);
 char const* stateMutabilityToString(StateMutability _state);
 
-Visibility visibilityByName(std::string _name);
+Visibility visibilityByName(std::string_view _name);
 char const* visibilityToString(Visibility _visibility);
 
 Type typeByName(std::string _name);
 char const* typeToString(Type type);
 
 constexpr bool isType(Token tok) { return tok >= Token::Int && tok < Token::TypesEnd; }
+constexpr bool isIntegerType(Token tok) {
+	return tok == Token::Int || tok == Token::UInt || tok == Token::IntM || tok == Token::UIntM;
+}
+constexpr bool isSignedIntegerType(Token tok) { return tok == Token::Int || tok == Token::IntM; }
 constexpr bool isLiteral(Token tok) { return tok >= Token::TrueLiteral && tok <= Token::CommentLiteral; }
 constexpr bool isAssignmentOp(Token tok) { return tok >= Token::Assign && tok <= Token::AssignMod; }
 constexpr bool isBinaryOp(Token tok) { return tok >= Token::Comma && tok <= Token::Exp; }
 constexpr bool isUnaryOp(Token tok) { return (tok >= Token::Not && tok <= Token::Delete) || tok == Token::Sub; }
 constexpr bool isCompareOp(Token tok) { return tok >= Token::Equal && tok <= Token::GreaterThanOrEqual; }
+constexpr bool isShiftOp(Token tok) { return tok >= Token::SHL && tok <= Token::SHR; }
 
 constexpr bool isVisibility(Token tok) {
 	return tok == Token::Private || tok == Token::Internal || tok == Token::Public || tok == Token::External;
@@ -280,14 +308,12 @@ struct Location {
 	Location(std::shared_ptr<Line> line, size_t start, size_t end): m_line(line), m_start(start), m_end(end){};
 };
 
+/* A token is the slice [m_offset, m_offset + m_length) of the preprocessed source. The line of a
+   token is only looked up, with TokenStream::location, when a diagnostic needs it. */
 struct TokenInfo {
+	uint32_t m_offset;
+	uint32_t m_length;
 	Token m_tok;
-	std::string m_val;
-	Location m_loc;
-
-	TokenInfo(const Token tok, const std::string& v, std::shared_ptr<Line> line, size_t start, size_t end)
-		: m_tok(tok), m_val(v), m_loc(line, start, end){};
-	TokenInfo(const Token tok, std::string&& v, std::shared_ptr<Line> line, size_t start, size_t end)
-		: m_tok(tok), m_val(v), m_loc(line, start, end){};
 };
+static_assert(sizeof(TokenInfo) == 12, "TokenInfo should stay compact");
 }
\ No newline at end of file
@@ -3,97 +3,160 @@
 #include "Token.h"
 #include "common/Defs.h"
 #include "preprocess/Preprocess.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 namespace minisolc {
 
+/* Tokens are kept in a ring buffer indexed by absolute token position. By default the whole
+   input is tokenized up front and nothing is ever dropped. In lazy mode tokens are scanned
+   on demand as the parser advances or peeks, and tokens behind the current position are
+   released unless a pinned position still needs them, so memory is bounded by the lookahead
+   plus the longest pinned backtracking window. */
 class TokenStream {
 public:
-	TokenStream(Preprocess& preprocess) {
-		m_source = preprocess.source();
+	TokenStream(Preprocess& preprocess, bool lazy = false): m_source(preprocess.source()), m_lazy(lazy) {
+		ASSERT_EXIT(m_source.size() <= UINT32_MAX, "Source exceeds 4 GiB.");
 		m_striter = m_source.cbegin();
-		tokenize();
-		addToken(Token::EOS, "");
-		mtokeniter = m_tokens.cbegin();
+		if (m_lazy) {
+			fill(0);
+		} else {
+			while (!m_done)
+				scanToken();
+		}
 	}
 
+	/// A window over tokens [begin, end) of a stream that is not lazy, with a cursor of its own, so
+	/// ranges can be parsed concurrently. Positions are those of whole and the window ends in EOS.
+	TokenStream(const TokenStream& whole, size_t begin, size_t end);
+
 	TokenInfo curTokInfo() const {
-		if (mtokeniter == m_tokens.cend())
-			return TokenInfo(Token::EOS, "", nullptr, 0, 0);
-		return *mtokeniter;
+		if (eof())
+			return TokenInfo{static_cast<uint32_t>(m_source.size()), 0, Token::EOS};
+		return at(m_cursor);
 	}
+	Location curLoc() const { return location(curTokInfo()); }
 
 	Token curTok() const {
-		if (mtokeniter == m_tokens.cend())
+		if (eof())
 			return Token::EOS;
-		return mtokeniter->m_tok;
+		return at(m_cursor).m_tok;
 	}
-	std::string curVal() const {
-		if (mtokeniter == m_tokens.cend())
-			return "";
-		return mtokeniter->m_val;
+	/// Views into the source, valid as long as it is.
+	std::string_view curVal() const {
+		if (eof())
+			return {};
+		return value(at(m_cursor));
 	}
 	// std::string curLine() const {
 	// 	if (mtokeniter == m_tokens.cend() || m_curline == m_lines.cend())
 	// 		return "";
 	// 	return *m_curline;
 	// }
-	Token peekTok(size_t count) const {
-		if (mtokeniter == m_tokens.cend() || mtokeniter + count >= m_tokens.cend())
+	Token peekTok(size_t count) {
+		if (eof() || !fill(m_cursor + count))
 			return Token::EOS;
-		return (mtokeniter + count)->m_tok;
+		return at(m_cursor + count).m_tok;
 	}
-	std::string peekVal(size_t count) const {
-		if (mtokeniter == m_tokens.cend() || mtokeniter + count >= m_tokens.cend())
-			return "";
-		return (mtokeniter + count)->m_val;
+	std::string_view peekVal(size_t count) {
+		if (eof() || !fill(m_cursor + count))
+			return {};
+		return value(at(m_cursor + count));
 	}
 
 	bool advance() {
-		if (mtokeniter < m_tokens.cend()) {
-			++mtokeniter;
+		if (!eof()) {
+			++m_cursor;
+			fill(m_cursor);
+			release();
 		}
-		return mtokeniter != m_tokens.cend();
+		return !eof();
 	}
 
-	size_t pos() const { return mtokeniter - m_tokens.cbegin(); }
+	size_t pos() const { return m_cursor; }
+	/// In lazy mode pos must not lie before the oldest pinned position (or the current one).
 	void setPos(size_t pos) {
-		if (pos < m_tokens.size())
-			mtokeniter = pos + m_tokens.cbegin();
-		else {
-			mtokeniter = m_tokens.cend();
-		}
+		ASSERT(pos >= m_head, "Token position was already released; pin() it before backtracking.");
+		fill(pos);
+		m_cursor = std::max(m_head, std::min(pos, m_tail));
+		release();
 	}
-	bool eof() const { return mtokeniter == m_tokens.cend(); }
+	/// Keep the tokens from the current position on until unpin(), so setPos() may return here.
+	size_t pin() {
+		m_pins.push_back(m_cursor);
+		return m_cursor;
+	}
+	void unpin(size_t pos);
+
+	bool eof() const { return m_done && m_cursor >= m_tail; }
 	bool error() const { return m_error; }
+	bool lazy() const { return m_lazy; }
+	/// Prints the tokens still buffered, which is every token unless the stream is lazy.
 	void Dump() const {
-		for (const auto& tokenInfo: m_tokens) {
-			std::cout << tokenInfo.m_val << " ";
+		for (size_t i = m_head; i < m_tail; ++i) {
+			std::cout << value(at(i)) << " ";
 		}
 	}
 
+	/// The source text of a token.
+	std::string_view value(const TokenInfo& info) const {
+		return std::string_view(m_source.data() + info.m_offset, info.m_length);
+	}
+
+	/// Resolve a token to its line, for diagnostics.
+	Location location(const TokenInfo& info) const {
+		size_t lineIndex = m_source.lineIndexOf(info.m_offset);
+		size_t start = info.m_offset - m_source.lineStart(lineIndex);
+		return Location(m_source.line(lineIndex), start, start + info.m_length);
+	}
+
 private:
-	void tokenize();
+	void scanToken();
+	bool fill(size_t index);
+	void push(const TokenInfo& info) {
+		if (m_tail - m_head == m_capacity)
+			grow();
+		m_ring[m_tail & m_mask] = info;
+		++m_tail;
+	}
+	void grow();
+	void release();
+	const TokenInfo& at(size_t index) const { return m_ring[index & m_mask]; }
+	const char* sourceEnd() const { return m_source.data() + m_source.size(); }
+
+	void tokenizePunctuator();
 	void tokenizeKeywordIdent();
 	bool tokenizeNumber();
 	bool tokenizeString();
 	void skipSpace();
 	bool skipAnnotation();
-	void addToken(Token tok, std::string val) {
-		m_tokens.push_back({tok, val, m_striter.line(), m_striter.linePos(), m_striter.linePos() + val.length()});
+	/// Add the token of the given length that starts at m_tokStart.
+	void addToken(Token tok, size_t length) {
+		push({static_cast<uint32_t>(m_tokStart.offset()), static_cast<uint32_t>(length), tok});
 	};
 
+	static constexpr size_t kInitialCapacity = 64; // a power of two
+
 	/// 全局信息
 	bool m_error = false; // 是否出错
 
-	CharStream m_source;
+	const CharStream& m_source;
 	CharStream::const_iterator m_striter;
+	CharStream::const_iterator m_tokStart; // start of the token being scanned
+	bool m_lazy;
+	bool m_done = false; // EOS has been scanned
 
-	std::vector<TokenInfo> m_tokens;
-	std::vector<TokenInfo>::const_iterator mtokeniter;
+	std::unique_ptr<TokenInfo[]> m_ring; // not value-initialized: slots are written before they are read
+	size_t m_capacity = 0;
+	size_t m_mask = 0;
+	size_t m_head = 0;	 // oldest buffered token
+	size_t m_tail = 0;	 // one past the newest buffered token
+	size_t m_cursor = 0; // current token
+	std::vector<size_t> m_pins;
 };
 
 }
\ No newline at end of file
@@ -2,51 +2,60 @@
 
 #include "common/Defs.h"
 #include "lexer/Token.h"
+#include "parser/AstArena.h"
+#include <cstdint>
 #include <iostream>
-#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
 namespace minisolc {
 
+/* Every concrete AST class, in the order of ElementASTTypes. The enumerator
+   and the class share a name. */
+#define AST_NODE_LIST(V)                                    \
+	V(SourceUnit)                                           \
+	V(PlainVariableDefinition)                              \
+	V(ArrayDefinition)                                      \
+	V(StructDefinition)                                     \
+	V(ParameterList) /* Maybe useless, remove later */      \
+	V(Block)                                                \
+	V(FunctionDefinition)                                   \
+	V(ElementaryTypeName) /* Maybe useless, remove later */ \
+	V(ReturnStatement)                                      \
+	V(Identifier)                                           \
+	V(BooleanLiteral)                                       \
+	V(StringLiteral)                                        \
+	V(NumberLiteral)                                        \
+	V(Assignment)                                           \
+	V(BinaryOp)                                             \
+	V(UnaryOp)                                              \
+	V(IfStatement)                                          \
+	V(WhileStatement)                                       \
+	V(ForStatement)                                         \
+	V(DoWhileStatement)                                     \
+	V(BreakStatement)                                       \
+	V(ContinueStatement)                                    \
+	V(ExpressionStatement)                                  \
+	V(IndexAccess)                                          \
+	V(FunctionCall)                                         \
+	V(MemberAccess)
+
 /* Each final AST records its own type
    for subsequent code generation. */
 enum class ElementASTTypes {
 	Invalid = 0,
-	SourceUnit,
-	PlainVariableDefinition,
-	ArrayDefinition,
-	StructDefinition,
-	ParameterList, // Maybe useless, remove later
-	Block,
-	FunctionDefinition,
-	ElementaryTypeName, // Maybe useless, remove later
-	ReturnStatement,
-	Identifier,
-	BooleanLiteral,
-	StringLiteral,
-	NumberLiteral,
-	Assignment,
-	BinaryOp,
-	UnaryOp,
-	IfStatement,
-	WhileStatement,
-	ForStatement,
-	DoWhileStatement,
-	BreakStatement,
-	ContinueStatement,
-	ExpressionStatement,
-	IndexAccess,
-	FunctionCall,
-	MemberAccess,
-};
-
-// Base class for all ASTs
+#define V(name) name,
+	AST_NODE_LIST(V)
+#undef V
+};
+
+/* Base class for all ASTs. Nodes live in an AstArena and are never destroyed one by one,
+   so no node may own heap memory: children are raw pointers or AstLists, and names are
+   views of strings copied into the same arena. */
 class BaseAST {
 public:
-	virtual ~BaseAST() = default;
-
 	virtual void Dump(size_t, size_t) const {};
 	ElementASTTypes GetASTType() const { return m_ASTType; }
 
@@ -74,6 +83,8 @@ protected:
 
 	static size_t unset(size_t mask, size_t pos) { return mask & ~(1 << pos); }
 
+	~BaseAST() = default;
+
 	ElementASTTypes m_ASTType = ElementASTTypes::Invalid;
 };
 
@@ -89,31 +100,49 @@ public:
 		SetType(type);
 		SetCastType(type);
 	}
+	/// Width and signedness of an INTEGER expression, as TypeSystem found.
+	IntegerType GetIntType() const { return m_intType; }
+	void SetIntType(IntegerType type) { m_intType = type; }
+	uint32_t GetFlatIndex() const { return m_flatIndex; }
+	void SetFlatIndex(uint32_t index) { m_flatIndex = index; }
 
 protected:
 	Type m_type = Type::UNKNOWN;
 	Type m_castType = Type::UNKNOWN;
+	IntegerType m_intType;
+	uint32_t m_flatIndex = UINT32_MAX; // position in a FlatExprStore, if any
 };
 class TypeName: public BaseAST {
 public:
 	virtual Token GetType() = 0;
+	/// The width of an integer type, else 0.
+	virtual uint16_t GetBits() const { return 0; }
+	/// The integer type this names; only meaningful if isIntegerType(GetType()).
+	IntegerType GetIntType() { return {GetBits(), isSignedIntegerType(GetType())}; }
 };
 
 class Declaration {
 public:
-	Declaration(std::string name, std::shared_ptr<TypeName> type = nullptr): m_name(name), m_type(std::move(type)) {}
+	Declaration(std::string_view name, TypeName* type = nullptr): m_name(name), m_type(type) {}
 
 	GETS_M(GetName, m_name);
 	GETS_M(GetDeclarationType, m_type);
+	uint32_t GetSlot() const { return m_slot; }
+	void SetSlot(uint32_t slot) { m_slot = slot; }
+	/// Whether an assignment or ++/-- writes it after its declaration, as NameResolver found.
+	bool IsAssigned() const { return m_assigned; }
+	void SetAssigned(bool assigned) { m_assigned = assigned; }
 
 protected:
-	std::string m_name;
-	std::shared_ptr<TypeName> m_type;
+	std::string_view m_name;
+	TypeName* m_type;
+	uint32_t m_slot = UINT32_MAX; // index among all declarations, assigned by NameResolver
+	bool m_assigned = false;
 };
 
 class SourceUnit final: public BaseAST {
 public:
-	SourceUnit(std::vector<std::shared_ptr<BaseAST>> subnodes): m_subnodes(std::move(subnodes)) {
+	SourceUnit(AstList<BaseAST> subnodes): m_subnodes(subnodes) {
 		m_ASTType = ElementASTTypes::SourceUnit;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -135,18 +164,18 @@ public:
 	GETS_M(getSubNodes, m_subnodes); // for tranverse
 
 private:
-	std::vector<std::shared_ptr<BaseAST>> m_subnodes;
+	AstList<BaseAST> m_subnodes;
 };
 
 class VariableDefinition: public Declaration, public SimpleStatement {
 public:
-	VariableDefinition(std::string name, std::shared_ptr<TypeName> type): Declaration(name, std::move(type)) {}
+	VariableDefinition(std::string_view name, TypeName* type): Declaration(name, type) {}
 };
 
 class PlainVariableDefinition final: public VariableDefinition {
 public:
-	PlainVariableDefinition(std::string name, std::shared_ptr<TypeName> type, std::shared_ptr<Expression> expr)
-		: VariableDefinition(name, std::move(type)), m_expr(std::move(expr)) {
+	PlainVariableDefinition(std::string_view name, TypeName* type, Expression* expr)
+		: VariableDefinition(name, type), m_expr(expr) {
 		m_ASTType = ElementASTTypes::PlainVariableDefinition;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -172,14 +201,15 @@ public:
 	}
 
 	GETS_M(getVarDefExpr, m_expr);
+	void setVarDefExpr(Expression* expr) { m_expr = expr; }
 
 private:
-	std::shared_ptr<Expression> m_expr; // optional
+	Expression* m_expr; // optional
 };
 
 class ParameterList final: public BaseAST {
 public:
-	ParameterList(std::vector<std::shared_ptr<VariableDefinition>> params): params(std::move(params)) {
+	ParameterList(AstList<VariableDefinition> params): params(params) {
 		m_ASTType = ElementASTTypes::ParameterList;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -201,12 +231,12 @@ public:
 	GETS_M(GetArgs, params);
 
 private:
-	std::vector<std::shared_ptr<VariableDefinition>> params; // type, ident
+	AstList<VariableDefinition> params; // type, ident
 };
 
 class Block final: public Statement {
 public:
-	Block(std::vector<std::shared_ptr<Statement>> stmts): m_stmts(std::move(stmts)) {
+	Block(AstList<Statement> stmts): m_stmts(stmts) {
 		m_ASTType = ElementASTTypes::Block;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -228,23 +258,24 @@ public:
 	GETS_M(GetStatements, m_stmts);
 
 private:
-	std::vector<std::shared_ptr<Statement>> m_stmts;
+	AstList<Statement> m_stmts;
 };
 
 class FunctionDefinition final: public Declaration, public BaseAST {
 public:
 	FunctionDefinition(
-		std::string name,
-		std::shared_ptr<ParameterList> param_list,
+		std::string_view name,
+		ParameterList* param_list,
 		Visibility visibility,
-		std::shared_ptr<TypeName> return_type,
-		std::shared_ptr<Block> block)
-		: Declaration(name, std::move(return_type)), m_param(std::move(param_list)), m_visibility(visibility),
-		  m_block(std::move(block)) {
+		TypeName* return_type,
+		Block* block)
+		: Declaration(name, return_type), m_param(param_list), m_visibility(visibility),
+		  m_block(block) {
 		m_ASTType = ElementASTTypes::FunctionDefinition;
 	}
 
 	GETS_M(GetParameterList, m_param);
+	GETS_M(GetVisibility, m_visibility);
 	GETS_M(GetBody, m_block);
 
 	void Dump(size_t depth, size_t mask) const override {
@@ -281,36 +312,45 @@ public:
 	}
 
 private:
-	std::shared_ptr<ParameterList> m_param;
+	ParameterList* m_param;
 	Visibility m_visibility;
-	std::shared_ptr<Block> m_block;
+	Block* m_block;
 };
 
 
 class ElementaryTypeName final: public TypeName {
 public:
-	ElementaryTypeName(Token type): m_type(type) { m_ASTType = ElementASTTypes::ElementaryTypeName; }
+	ElementaryTypeName(Token type, uint16_t bits = 0): m_type(type), m_bits(bits) {
+		m_ASTType = ElementASTTypes::ElementaryTypeName;
+	}
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
 		std::cout << astColor(depth) << "ElementaryTypeNameAST" << RESET << '\n';
 
 		printIndent(depth + 1, mask);
-		std::cout << "type: " << tokenToString(m_type) << '\n';
+		std::cout << "type: ";
+		if (m_type == Token::IntM || m_type == Token::UIntM)
+			std::cout << (m_type == Token::IntM ? "int" : "uint") << m_bits << '\n';
+		else
+			std::cout << tokenToString(m_type) << '\n';
 	}
 	Token GetType() override { return m_type; }
+	uint16_t GetBits() const override { return m_bits; }
 
 private:
 	Token m_type;
+	uint16_t m_bits;
 };
 
 
 class ReturnStatement final: public Statement {
 public:
-	ReturnStatement(std::shared_ptr<Expression> expr): m_expr(std::move(expr)) {
+	ReturnStatement(Expression* expr): m_expr(expr) {
 		m_ASTType = ElementASTTypes::ReturnStatement;
 	}
 
 	GETS_M(GetExpr, m_expr);
+	void SetExpr(Expression* expr) { m_expr = expr; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -324,22 +364,25 @@ public:
 	}
 
 private:
-	std::shared_ptr<Expression> m_expr; // optional
+	Expression* m_expr; // optional
 };
 
 class PrimaryExpression: public Expression {
 public:
-	PrimaryExpression(std::string value): m_value(value) {}
+	PrimaryExpression(std::string_view value): m_value(value) {}
 
 	GETS_M(GetValue, m_value);
 
 protected:
-	std::string m_value;
+	std::string_view m_value;
 };
 
 class Identifier final: public PrimaryExpression {
 public:
-	Identifier(std::string value): PrimaryExpression(value) { m_ASTType = ElementASTTypes::Identifier; }
+	Identifier(std::string_view value): PrimaryExpression(value) { m_ASTType = ElementASTTypes::Identifier; }
+	/// The slot of the declaration this names, or UINT32_MAX if NameResolver found none.
+	uint32_t GetSlot() const { return m_slot; }
+	void SetSlot(uint32_t slot) { m_slot = slot; }
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
 		std::cout << astColor(depth) << "IdentifierAST" << RESET << '\n';
@@ -355,11 +398,14 @@ public:
 		printIndent(depth + 1, mask);
 		std::cout << "castType: " << typeToString(m_castType) << '\n';
 	}
+
+private:
+	uint32_t m_slot = UINT32_MAX;
 };
 
 class BooleanLiteral final: public PrimaryExpression {
 public:
-	BooleanLiteral(std::string value): PrimaryExpression(value) {
+	BooleanLiteral(std::string_view value): PrimaryExpression(value) {
 		m_ASTType = ElementASTTypes::BooleanLiteral;
 		SetType(Type::BOOLEAN);
 		SetCastType(Type::BOOLEAN);
@@ -383,7 +429,7 @@ public:
 
 class StringLiteral final: public PrimaryExpression {
 public:
-	StringLiteral(std::string value): PrimaryExpression(value) {
+	StringLiteral(std::string_view value): PrimaryExpression(value) {
 		m_ASTType = ElementASTTypes::StringLiteral;
 		SetType(Type::STRING);
 		SetCastType(Type::STRING);
@@ -407,7 +453,7 @@ public:
 
 class NumberLiteral final: public PrimaryExpression {
 public:
-	NumberLiteral(std::string value, Type type): PrimaryExpression(value) /*, m_unit(unit)*/ {
+	NumberLiteral(std::string_view value, Type type): PrimaryExpression(value) /*, m_unit(unit)*/ {
 		m_ASTType = ElementASTTypes::NumberLiteral;
 		SetType(type);
 		SetCastType(type);
@@ -434,8 +480,8 @@ public:
 
 class ArrayDefinition final: public VariableDefinition {
 public:
-	ArrayDefinition(std::string name, std::shared_ptr<TypeName> type, std::shared_ptr<Expression> size)
-		: VariableDefinition(name, std::move(type)), m_size(std::move(size)) {
+	ArrayDefinition(std::string_view name, TypeName* type, Expression* size)
+		: VariableDefinition(name, type), m_size(size) {
 		m_ASTType = ElementASTTypes::ArrayDefinition;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -457,17 +503,18 @@ public:
 	}
 
 	GETS_M(GetArraySize, m_size);
+	void SetArraySize(Expression* expr) { m_size = expr; }
 
 private:
-	std::shared_ptr<Expression> m_size;
+	Expression* m_size;
 };
 
 class StructDefinition final: public VariableDefinition {
 public:
-	StructDefinition(std::string name, std::vector<std::shared_ptr<VariableDefinition>> memList, 
-		bool isVariable, const std::string& structName, const std::shared_ptr<Expression> expr = nullptr)
-		: VariableDefinition(name, std::make_shared<ElementaryTypeName>(Token::Struct)), 
-		  m_MemList(std::move(memList)), m_isVariable(isVariable), m_StructName (structName), m_expr(expr) {
+	StructDefinition(std::string_view name, AstList<VariableDefinition> memList, 
+		bool isVariable, std::string_view structName, TypeName* type, Expression* expr = nullptr)
+		: VariableDefinition(name, type), 
+		  m_MemList(memList), m_isVariable(isVariable), m_StructName (structName), m_expr(expr) {
 		m_ASTType = ElementASTTypes::StructDefinition;
 	}
 	void Dump(size_t depth, size_t mask) const override {
@@ -486,8 +533,8 @@ public:
 			printIndent(depth + 1, mask);
 			std::cout << "members:" << '\n';
 			mask = set(mask, depth + 2);
-			for (auto iter = m_MemList.cbegin(); iter != m_MemList.cend(); ++iter) {
-				if (iter + 1 == m_MemList.cend())
+			for (auto iter = m_MemList.begin(); iter != m_MemList.end(); ++iter) {
+				if (iter + 1 == m_MemList.end())
 					mask = unset(mask, depth + 2);
 				(*iter)->Dump(depth + 2, mask);
 			}
@@ -498,24 +545,26 @@ public:
 	GETS_M(GetisVariable, m_isVariable);
 	GETS_M(GetStructName, m_StructName);
 	GETS_M(GetInitExpr, m_expr);
+	void SetInitExpr(Expression* expr) { m_expr = expr; }
 
 private:
-	std::vector<std::shared_ptr<VariableDefinition>> m_MemList;
+	AstList<VariableDefinition> m_MemList;
 	bool m_isVariable;
-	std::string m_StructName;
-	std::shared_ptr<Expression> m_expr; // optional
+	std::string_view m_StructName;
+	Expression* m_expr; // optional
 };
 
 class Assignment final: public Expression {
 public:
-	Assignment(std::shared_ptr<Expression> lhs, Token assignOp, std::shared_ptr<Expression> rhs)
-		: m_leftHandSide(std::move(lhs)), m_assigmentOp(std::move(assignOp)), m_rightHandSide(std::move(rhs)) {
+	Assignment(Expression* lhs, Token assignOp, Expression* rhs)
+		: m_leftHandSide(lhs), m_assigmentOp(std::move(assignOp)), m_rightHandSide(rhs) {
 		m_ASTType = ElementASTTypes::Assignment;
 	}
 
-	std::shared_ptr<Expression> GetLeftHand() const { return m_leftHandSide; }
+	Expression* GetLeftHand() const { return m_leftHandSide; }
 	Token GetAssigmentOp() const { return m_assigmentOp; }
-	std::shared_ptr<Expression> GetRightHand() const { return m_rightHandSide; }
+	Expression* GetRightHand() const { return m_rightHandSide; }
+	void SetRightHand(Expression* expr) { m_rightHandSide = expr; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -545,21 +594,23 @@ public:
 
 
 private:
-	std::shared_ptr<Expression> m_leftHandSide;
+	Expression* m_leftHandSide;
 	Token m_assigmentOp;
-	std::shared_ptr<Expression> m_rightHandSide;
+	Expression* m_rightHandSide;
 };
 
 class BinaryOp final: public Expression {
 public:
-	BinaryOp(std::shared_ptr<Expression> lhs, Token binaryOp, std::shared_ptr<Expression> rhs)
-		: m_leftHandSide(std::move(lhs)), m_binaryOp(std::move(binaryOp)), m_rightHandSide(std::move(rhs)) {
+	BinaryOp(Expression* lhs, Token binaryOp, Expression* rhs)
+		: m_leftHandSide(lhs), m_binaryOp(std::move(binaryOp)), m_rightHandSide(rhs) {
 		m_ASTType = ElementASTTypes::BinaryOp;
 	}
 
-	std::shared_ptr<Expression> GetLeftHand() const { return m_leftHandSide; }
-	std::shared_ptr<Expression> GetRightHand() const { return m_rightHandSide; }
+	Expression* GetLeftHand() const { return m_leftHandSide; }
+	Expression* GetRightHand() const { return m_rightHandSide; }
+	void SetRightHand(Expression* expr) { m_rightHandSide = expr; }
 	GETS_M(GetOp, m_binaryOp);
+	void SetLeftHand(Expression* expr) { m_leftHandSide = expr; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -589,20 +640,21 @@ public:
 
 
 private:
-	std::shared_ptr<Expression> m_leftHandSide;
+	Expression* m_leftHandSide;
 	Token m_binaryOp;
-	std::shared_ptr<Expression> m_rightHandSide;
+	Expression* m_rightHandSide;
 };
 
 class UnaryOp final: public Expression {
 public:
-	UnaryOp(Token unaryOp, std::shared_ptr<Expression> subExpr, bool isPrefix)
-		: m_unaryOp(std::move(unaryOp)), m_subExpr(std::move(subExpr)), m_isPrefix(isPrefix) {
+	UnaryOp(Token unaryOp, Expression* subExpr, bool isPrefix)
+		: m_unaryOp(std::move(unaryOp)), m_subExpr(subExpr), m_isPrefix(isPrefix) {
 		m_ASTType = ElementASTTypes::UnaryOp;
 	}
 
 	GETS_M(GetOp, m_unaryOp);
 	GETS_M(GetExpr, m_subExpr);
+	void SetExpr(Expression* expr) { m_subExpr = expr; }
 	bool IsPrefix() const { return m_isPrefix; }
 
 	void Dump(size_t depth, size_t mask) const override {
@@ -628,24 +680,27 @@ public:
 
 private:
 	Token m_unaryOp;
-	std::shared_ptr<Expression> m_subExpr;
+	Expression* m_subExpr;
 	bool m_isPrefix;
 };
 
 class IfStatement final: public Statement {
 public:
 	IfStatement(
-		std::shared_ptr<Expression> condition,
-		std::shared_ptr<Statement> thenStatement,
-		std::shared_ptr<Statement> elseStatement = nullptr)
-		: m_condition(std::move(condition)), m_thenStatement(std::move(thenStatement)),
-		  m_elseStatement(std::move(elseStatement)) {
+		Expression* condition,
+		Statement* thenStatement,
+		Statement* elseStatement = nullptr)
+		: m_condition(condition), m_thenStatement(thenStatement),
+		  m_elseStatement(elseStatement) {
 		m_ASTType = ElementASTTypes::IfStatement;
 	}
 
 	GETS_M(GetCondition, m_condition);
 	GETS_M(GetThenStatement, m_thenStatement);
 	GETS_M(GetElseStatement, m_elseStatement);
+	void SetCondition(Expression* expr) { m_condition = expr; }
+	void SetThenStatement(Statement* statement) { m_thenStatement = statement; }
+	void SetElseStatement(Statement* statement) { m_elseStatement = statement; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -679,15 +734,15 @@ public:
 	}
 
 private:
-	std::shared_ptr<Expression> m_condition;
-	std::shared_ptr<Statement> m_thenStatement;
-	std::shared_ptr<Statement> m_elseStatement;
+	Expression* m_condition;
+	Statement* m_thenStatement;
+	Statement* m_elseStatement;
 };
 
 class WhileStatement final: public Statement {
 public:
-	WhileStatement(std::shared_ptr<Expression> condition, std::shared_ptr<Statement> body)
-		: m_condition(std::move(condition)), m_body(std::move(body)) {
+	WhileStatement(Expression* condition, Statement* body)
+		: m_condition(condition), m_body(body) {
 		m_ASTType = ElementASTTypes::WhileStatement;
 	}
 
@@ -709,22 +764,23 @@ public:
 	}
 
 	GETS_M(GetConditionExpr, m_condition);
+	void SetConditionExpr(Expression* expr) { m_condition = expr; }
 	GETS_M(GetWhileLoopBody, m_body);
 
 private:
-	std::shared_ptr<Expression> m_condition;
-	std::shared_ptr<Statement> m_body;
+	Expression* m_condition;
+	Statement* m_body;
 };
 
 class ForStatement final: public Statement {
 public:
 	ForStatement(
-		std::shared_ptr<SimpleStatement> init,
-		std::shared_ptr<Expression> condition,
-		std::shared_ptr<Expression> update,
-		std::shared_ptr<Statement> body)
-		: m_init(std::move(init)), m_condition(std::move(condition)), m_update(std::move(update)),
-		  m_body(std::move(body)) {
+		SimpleStatement* init,
+		Expression* condition,
+		Expression* update,
+		Statement* body)
+		: m_init(init), m_condition(condition), m_update(update),
+		  m_body(body) {
 		m_ASTType = ElementASTTypes::ForStatement;
 	}
 
@@ -757,20 +813,22 @@ public:
 
 	GETS_M(GetInitExpr, m_init);
 	GETS_M(GetConditionExpr, m_condition);
+	void SetConditionExpr(Expression* expr) { m_condition = expr; }
 	GETS_M(GetUpdateExpr, m_update);
+	void SetUpdateExpr(Expression* expr) { m_update = expr; }
 	GETS_M(GetForLoopBody, m_body);
 
 private:
-	std::shared_ptr<SimpleStatement> m_init;
-	std::shared_ptr<Expression> m_condition;
-	std::shared_ptr<Expression> m_update;
-	std::shared_ptr<Statement> m_body;
+	SimpleStatement* m_init;
+	Expression* m_condition;
+	Expression* m_update;
+	Statement* m_body;
 };
 
 class DoWhileStatement final: public Statement {
 public:
-	DoWhileStatement(std::shared_ptr<Expression> condition, std::shared_ptr<Statement> body)
-		: m_body(std::move(body)), m_condition(std::move(condition)) {
+	DoWhileStatement(Expression* condition, Statement* body)
+		: m_body(body), m_condition(condition) {
 		m_ASTType = ElementASTTypes::DoWhileStatement;
 	}
 
@@ -793,10 +851,11 @@ public:
 
 	GETS_M(GetDoWhileLoopBody, m_body);
 	GETS_M(GetConditionExpr, m_condition);
+	void SetConditionExpr(Expression* expr) { m_condition = expr; }
 
 private:
-	std::shared_ptr<Statement> m_body;
-	std::shared_ptr<Expression> m_condition;
+	Statement* m_body;
+	Expression* m_condition;
 };
 
 class BreakStatement final: public Statement {
@@ -821,11 +880,12 @@ public:
 
 class ExpressionStatement final: public SimpleStatement {
 public:
-	ExpressionStatement(std::shared_ptr<Expression> expr): m_expr(std::move(expr)) {
+	ExpressionStatement(Expression* expr): m_expr(expr) {
 		m_ASTType = ElementASTTypes::ExpressionStatement;
 	}
 
-	const std::shared_ptr<Expression>& GetExpr() const { return m_expr; }
+	Expression* GetExpr() const { return m_expr; }
+	void SetExpr(Expression* expr) { m_expr = expr; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -838,13 +898,13 @@ public:
 	}
 
 private:
-	std::shared_ptr<Expression> m_expr;
+	Expression* m_expr;
 };
 
 class IndexAccess final: public Expression {
 public:
-	IndexAccess(std::shared_ptr<Expression> expr, std::shared_ptr<Expression> index)
-		: m_expr(std::move(expr)), m_index(std::move(index)) {
+	IndexAccess(Expression* expr, Expression* index)
+		: m_expr(expr), m_index(index) {
 		m_ASTType = ElementASTTypes::IndexAccess;
 	}
 
@@ -873,22 +933,25 @@ public:
 
 	GETS_M(GetArrayName, m_expr);
 	GETS_M(GetArrayIndex, m_index);
+	void SetArrayIndex(Expression* expr) { m_index = expr; }
 
 private:
-	std::shared_ptr<Expression> m_expr; // array name
-	std::shared_ptr<Expression> m_index;
+	Expression* m_expr; // array name
+	Expression* m_index;
 };
 
 class FunctionCall final: public Expression {
 public:
-	FunctionCall(std::shared_ptr<Expression> expr, std::vector<std::shared_ptr<Expression>> args)
-		: m_expr(std::move(expr)), m_args(std::move(args)) {
+	FunctionCall(Expression* expr, AstList<Expression> args)
+		: m_expr(expr), m_args(args) {
 		m_ASTType = ElementASTTypes::FunctionCall;
 	}
 
-	std::string GetFunctionName() const { return reinterpret_cast<Identifier*>(m_expr.get())->GetValue(); }
+	std::string_view GetFunctionName() const { return static_cast<Identifier*>(m_expr)->GetValue(); }
+	GETS_M(GetCallee, m_expr);
 
-	std::vector<std::shared_ptr<Expression>> GetArgs() const { return m_args; }
+	AstList<Expression> GetArgs() const { return m_args; }
+	void SetArgs(AstList<Expression> args) { m_args = args; }
 
 	void Dump(size_t depth, size_t mask) const override {
 		printIndent(depth, mask);
@@ -920,14 +983,14 @@ public:
 	}
 
 private:
-	std::shared_ptr<Expression> m_expr;
-	std::vector<std::shared_ptr<Expression>> m_args;
+	Expression* m_expr;
+	AstList<Expression> m_args;
 };
 
 class MemberAccess final: public Expression {
 public:
-	MemberAccess(std::shared_ptr<Expression> expr, std::string member)
-		: m_expr(std::move(expr)), m_member(std::move(member)) {
+	MemberAccess(Expression* expr, std::string_view member)
+		: m_expr(expr), m_member(member) {
 		m_ASTType = ElementASTTypes::MemberAccess;
 	}
 
@@ -955,8 +1018,8 @@ public:
 	GETS_M(GetStructVarExpr, m_expr);
 	GETS_M(GetMember, m_member);
 private:
-	std::shared_ptr<Expression> m_expr;
-	std::string m_member;
+	Expression* m_expr;
+	std::string_view m_member;
 };
 
 
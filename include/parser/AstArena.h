@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common/Defs.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace minisolc {
+
+/* A read-only array of child nodes. The pointers live in the same arena as the nodes, so
+   an AstList is two words and copying it copies no elements. */
+template <typename T> class AstList {
+public:
+	AstList() = default;
+	AstList(T* const* data, uint32_t size): m_data(data), m_size(size) {}
+
+	T* const* begin() const { return m_data; }
+	T* const* end() const { return m_data + m_size; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	T* operator[](size_t i) const { return m_data[i]; }
+	T* back() const { return m_data[m_size - 1]; }
+
+private:
+	T* const* m_data = nullptr;
+	uint32_t m_size = 0;
+};
+
+/* Bump allocator holding every node of one AST. Allocation is a pointer increment; nothing
+   is freed until the arena itself goes away, which releases the whole tree at once. Only
+   trivially destructible objects may be placed in it. */
+class AstArena {
+public:
+	AstArena() = default;
+	DISALLOW_COPY_AND_MOVE(AstArena);
+
+	template <typename T, typename... Args> T* make(Args&&... args) {
+		static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed.");
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/* Copies a child list built on the parser's stack into the arena. */
+	template <typename T> AstList<T> list(const std::vector<T*>& items) {
+		if (items.empty())
+			return {};
+		T** data = static_cast<T**>(allocate(items.size() * sizeof(T*), alignof(T*)));
+		std::memcpy(data, items.data(), items.size() * sizeof(T*));
+		return {data, static_cast<uint32_t>(items.size())};
+	}
+
+	/* Copies nodes collected elsewhere, e.g. on the parser's scratch stack, as a list of T. */
+	template <typename T, typename It> AstList<T> list(It first, It last) {
+		size_t size = static_cast<size_t>(std::distance(first, last));
+		if (size == 0)
+			return {};
+		T** data = static_cast<T**>(allocate(size * sizeof(T*), alignof(T*)));
+		for (size_t i = 0; i < size; ++i, ++first)
+			data[i] = static_cast<T*>(*first);
+		return {data, static_cast<uint32_t>(size)};
+	}
+
+	std::string_view copy(std::string_view s) {
+		if (s.empty())
+			return {};
+		char* data = static_cast<char*>(allocate(s.size(), 1));
+		std::memcpy(data, s.data(), s.size());
+		return {data, s.size()};
+	}
+
+	void* allocate(size_t size, size_t align) {
+		uintptr_t p = (m_cur + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+		if (p + size > m_end)
+			return allocateBlock(size, align);
+		m_cur = p + size;
+		return reinterpret_cast<void*>(p);
+	}
+
+	/// Bytes reserved from the system so far.
+	size_t reserved() const { return m_reserved; }
+
+private:
+	void* allocateBlock(size_t size, size_t align) {
+		size_t blockSize = std::max(kBlockSize, size + align);
+		/* Not value-initialized: a fresh block is never read before it is written. */
+		m_blocks.emplace_back(new std::byte[blockSize]);
+		m_reserved += blockSize;
+		m_cur = reinterpret_cast<uintptr_t>(m_blocks.back().get());
+		m_end = m_cur + blockSize;
+		return allocate(size, align);
+	}
+
+	static constexpr size_t kBlockSize = 64 << 10;
+
+	std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+	uintptr_t m_cur = 0;
+	uintptr_t m_end = 0;
+	size_t m_reserved = 0;
+};
+
+}
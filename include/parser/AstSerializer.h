@@ -0,0 +1,45 @@
+#pragma once
+
+#include "parser/Ast.h"
+#include "parser/AstArena.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace minisolc {
+
+/* Binary AST files, so a build whose inputs are unchanged can skip preprocessing, lexing and
+   parsing. Integers are LEB128 varints, strings are a length and the bytes. The layout is
+
+     "MSAST", format version
+     input count, then per input file: path, fnv1a of its bytes
+     the tree in pre-order: per node its ElementASTTypes value (0 for a null child), for
+     expressions their type, cast type, integer width and signedness, then its fields in
+     constructor order; a list is a count followed by its nodes.
+
+   Bump kAstFormatVersion whenever a node's fields change. */
+constexpr uint32_t kAstFormatVersion = 2;
+
+struct AstInput {
+	std::string path;
+	uint64_t hash;
+};
+
+/// The hash an AstInput records for path: fnv1a of its bytes, or 0 if it cannot be read.
+uint64_t hashInput(const std::filesystem::path& path);
+
+std::string serializeAst(BaseAST* root, const std::vector<AstInput>& inputs);
+
+/// Rebuilds the tree of data in arena. Returns nullptr if data is not an AST file of this
+/// format version or is malformed; inputs, if given, receives the recorded input files.
+BaseAST* deserializeAst(std::string_view data, AstArena& arena, std::vector<AstInput>* inputs = nullptr);
+
+/// Writes root to file; false on an I/O error.
+bool saveAst(const std::filesystem::path& file, BaseAST* root, const std::vector<AstInput>& inputs);
+
+/// The tree stored in file if every input it records still has the recorded hash, else nullptr.
+BaseAST* loadFreshAst(const std::filesystem::path& file, AstArena& arena);
+
+}
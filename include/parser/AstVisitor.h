@@ -0,0 +1,56 @@
+#pragma once
+
+#include "parser/Ast.h"
+
+namespace minisolc {
+
+template <typename T> struct AstKind;
+#define V(name)                                                     \
+	template <> struct AstKind<name> {                                  \
+		static constexpr ElementASTTypes value = ElementASTTypes::name; \
+	};
+AST_NODE_LIST(V)
+#undef V
+
+/* Checked downcast without RTTI: the node as a T if it is one, otherwise nullptr. */
+template <typename T> T* astCast(BaseAST* node) {
+	return node != nullptr && node->GetASTType() == AstKind<T>::value ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T> const T* astCast(const BaseAST* node) {
+	return node != nullptr && node->GetASTType() == AstKind<T>::value ? static_cast<const T*>(node) : nullptr;
+}
+
+/* Static dispatch over the AST. A pass derives from AstVisitor<Pass, R, Args...> and defines
+   R visitX(X* node, Args... args) for each node kind X it handles; visit() switches once on
+   GetASTType() and calls the matching handler through a static_cast, so no RTTI is involved.
+   Kinds without a handler, and null children, go to visitNode(). */
+template <typename Derived, typename R, typename... Args> class AstVisitor {
+public:
+	R visit(BaseAST* node, Args... args) {
+		if (node == nullptr)
+			return derived().visitNode(node, args...);
+		switch (node->GetASTType()) {
+#define V(name)                   \
+	case ElementASTTypes::name: \
+		return derived().visit##name(static_cast<name*>(node), args...);
+			AST_NODE_LIST(V)
+#undef V
+		default:
+			return derived().visitNode(node, args...);
+		}
+	}
+
+	/// Fallback for null children and unhandled kinds.
+	R visitNode(BaseAST* node, Args... args) { return R(); }
+
+#define V(name) \
+	R visit##name(name* node, Args... args) { return derived().visitNode(node, args...); }
+	AST_NODE_LIST(V)
+#undef V
+
+private:
+	Derived& derived() { return static_cast<Derived&>(*this); }
+};
+
+}
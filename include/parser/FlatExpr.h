@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lexer/Token.h"
+#include "parser/Ast.h"
+#include <cstdint>
+#include <vector>
+
+namespace minisolc {
+
+/* Struct-of-arrays copy of the expressions the parser builds. Nodes are appended as they are
+   created, which is post-order: every operand sits at a smaller index than its user, so one
+   forward loop over the arrays sees operands first, without chasing pointers.
+
+   Operands by kind (kNone when absent):
+     BinaryOp, Assignment, IndexAccess   lhs, rhs
+     UnaryOp, MemberAccess               lhs
+     FunctionCall                        lhs = callee, rhs = offset in args(): count, then the indices
+   Anything else (operator prefix/postfix, names, literal text) is on the node itself. */
+class FlatExprStore {
+public:
+	using Index = uint32_t;
+	static constexpr Index kNone = UINT32_MAX;
+
+	/// Appends an expression whose operands are already in the store and records its index on it.
+	Index append(Expression* expr);
+
+	/// Appends every expression of other, renumbered after this store's; joins stores built in parallel.
+	void append(const FlatExprStore& other) {
+		for (Expression* expr: other.m_nodes)
+			append(expr);
+	}
+
+	/// Drops the expressions from index size on, e.g. those of an abandoned speculative parse.
+	void truncate(size_t size);
+
+	/// Re-reads the types of all nodes, e.g. after the type system has run.
+	void refreshTypes();
+
+	/// Marks expressions built only from literals and operators, in a single forward pass.
+	std::vector<bool> constantMask() const;
+
+	size_t size() const { return m_kinds.size(); }
+	bool empty() const { return m_kinds.empty(); }
+
+	GETS_M(kinds, m_kinds);
+	GETS_M(ops, m_ops);
+	GETS_M(lhs, m_lhs);
+	GETS_M(rhs, m_rhs);
+	GETS_M(types, m_types);
+	GETS_M(nodes, m_nodes);
+	GETS_M(args, m_args);
+
+private:
+	std::vector<ElementASTTypes> m_kinds;
+	std::vector<Token> m_ops;
+	std::vector<Index> m_lhs;
+	std::vector<Index> m_rhs;
+	std::vector<Type> m_types;
+	std::vector<Expression*> m_nodes;
+	std::vector<Index> m_args;
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "parser/Ast.h"
+#include "parser/AstArena.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace minisolc {
+
+/* What the last incremental build of a source produced: the AST of each top-level function
+   as serializeAst() writes it, types included, keyed by Parser::TopLevelFunction::hash. There
+   is one file per source, rewritten after each build with exactly the functions of that build. */
+class FunctionCache {
+public:
+	/// Replaces the contents by those of file. A missing or malformed file, or one written with
+	/// another AST format version, leaves the cache empty and returns false.
+	bool load(const std::filesystem::path& file);
+	/// Writes the contents to file; false on an I/O error.
+	bool save(const std::filesystem::path& file) const;
+
+	/// The serialized AST for hash, or nullptr.
+	const std::string* find(uint64_t hash) const {
+		auto it = m_asts.find(hash);
+		return it == m_asts.end() ? nullptr : &it->second;
+	}
+	/// The cached definition for hash rebuilt in arena, or nullptr.
+	FunctionDefinition* findAst(uint64_t hash, AstArena& arena) const;
+	void put(uint64_t hash, std::string ast) { m_asts.insert_or_assign(hash, std::move(ast)); }
+	size_t size() const { return m_asts.size(); }
+
+private:
+	std::unordered_map<uint64_t, std::string> m_asts;
+};
+
+}
@@ -1,118 +1,252 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 // #include <tuple>
-#include <functional>
+#include <optional>
+#include <unordered_map>
 
 #include "Ast.h"
+#include "AstArena.h"
+#include "FlatExpr.h"
 #include "lexer/TokenStream.h"
 #include "common/Error.h"
+#include "common/ThreadPool.h"
 
 namespace minisolc {
 
 class Parser {
 public:
-	Parser(TokenStream& source): m_source(source) {}
+	/// With flatExpressions, every expression is also appended to a FlatExprStore as it is built,
+	/// except those of functions a FunctionLookup hands back.
+	Parser(TokenStream& source, bool flatExpressions = false): m_source(source) {
+		if (flatExpressions)
+			m_flat.emplace();
+	}
 	void parse();
+	/// Same result as parse(), but runs of top-level definitions are parsed on pool, each into an
+	/// arena of its own, and then stitched into one SourceUnit. Lazy streams are parsed serially.
+	void parse(ThreadPool& pool);
 	void Dump() const {
 		if (m_root) {
 			m_root->Dump(0, 0);
 		}
 	}
 
-	const std::shared_ptr<BaseAST>& GetAst() const { return m_root; }
+	BaseAST* GetAst() const { return m_root; }
+	/// The flat expression store, or nullptr when it is disabled.
+	const FlatExprStore* GetFlatExprs() const { return m_flat ? &*m_flat : nullptr; }
+	FlatExprStore* GetFlatExprs() { return m_flat ? &*m_flat : nullptr; }
+
+	/// Every syntax error of the last parse(), in source order. The AST is partial when this is not empty.
+	GETS_M(GetDiagnostics, m_diagnostics);
+	bool HasErrors() const { return !m_diagnostics.empty(); }
+
+	/// Speculative parsing counters of the last parse(): rewinds taken and memoized results reused.
+	size_t GetRewinds() const { return m_rewinds; }
+	size_t GetMemoHits() const { return m_memoHits; }
+
+	/* Incremental parsing. With a lookup set, parse() first hashes every top-level function
+	   with a body: its own tokens, plus every token before it outside function bodies, i.e.
+	   the declarations it can see. The lookup is asked for each hash before the function is
+	   parsed; a node it returns, built in the given arena, is used instead. */
+	struct TopLevelFunction {
+		size_t begin; // token positions of 'function' and one past the closing '}'
+		size_t end;
+		uint64_t hash;
+		FunctionDefinition* node = nullptr; // nullptr if the function did not parse
+		bool reused = false;
+	};
+	using FunctionLookup = std::function<FunctionDefinition*(uint64_t hash, AstArena& arena)>;
+	/// Parsing with a lookup is serial; parse(ThreadPool&) falls back to parse().
+	void setFunctionLookup(FunctionLookup lookup) { m_lookup = std::move(lookup); }
+	/// The top-level functions of the last parse() with a lookup, in source order.
+	GETS_M(GetFunctions, m_functions);
 
 private:
-	bool peekCur(Token tok) {
-		bool res = curTok() == tok;
-		return res;
-	}
-	bool peekCur(std::function<bool(Token)> func) {
-		bool res = func(curTok());
-		return res;
-	}
-	bool match(Token tok) {
-		bool res = curTok() == tok;
-		if (res)
-			advance();
-		return res;
+	/* Rules that may be tried speculatively; together with a token position they key the memo. */
+	enum class Rule : uint8_t { StructVariable };
+
+	/* A position to come back to. While it is alive the token stream keeps every token from
+	   there on, so rewind() is valid even in lazy mode. */
+	class Checkpoint {
+	public:
+		explicit Checkpoint(Parser& parser)
+			: m_parser(parser), m_pos(parser.m_source.pin()), m_diagnostics(parser.m_diagnostics.size()),
+			  m_lastErrorPos(parser.m_lastErrorPos), m_flatSize(parser.m_flat ? parser.m_flat->size() : 0) {}
+		~Checkpoint() { m_parser.m_source.unpin(m_pos); }
+		DISALLOW_COPY_AND_MOVE(Checkpoint);
+
+		size_t pos() const { return m_pos; }
+		/// Returns to the checkpoint, dropping the errors reported and expressions flattened since.
+		void rewind() {
+			m_parser.m_source.setPos(m_pos);
+			m_parser.m_diagnostics.resize(m_diagnostics);
+			m_parser.m_lastErrorPos = m_lastErrorPos;
+			if (m_parser.m_flat)
+				m_parser.m_flat->truncate(m_flatSize);
+			++m_parser.m_rewinds;
+		}
+
+	private:
+		Parser& m_parser;
+		size_t m_pos;
+		size_t m_diagnostics;
+		size_t m_lastErrorPos;
+		size_t m_flatSize;
+	};
+
+	/* Tries one alternative: parse() runs from the current token and either yields a node or
+	   fails (nullptr or ParseError), in which case the stream is rewound and nullptr returned.
+	   Outcomes are memoized by (rule, position), so retrying a rule where it already ran, after
+	   an enclosing alternative was abandoned, costs a lookup and keeps parsing linear. A memoized
+	   node is handed out once more at most: whoever took it first was rewound past it, but the
+	   next taker may keep it, and no node may sit in the tree twice. With a flat store only
+	   failures are memoized: that rewind also dropped the node's expressions from the store. */
+	template <typename T, typename F> T* speculate(Rule rule, F&& parse) {
+		uint64_t key = static_cast<uint64_t>(m_source.pos()) << 8 | static_cast<uint8_t>(rule);
+		if (auto it = m_memo.find(key); it != m_memo.end()) {
+			++m_memoHits;
+			BaseAST* node = it->second.node;
+			if (node != nullptr) {
+				m_source.setPos(it->second.end);
+				m_memo.erase(it);
+			}
+			return static_cast<T*>(node);
+		}
+		Checkpoint checkpoint(*this);
+		size_t mark = m_scratch.size();
+		T* node = nullptr;
+		try {
+			node = parse();
+		} catch (ParseError&) {
+			m_scratch.resize(mark);
+			node = nullptr;
+		}
+		if (node == nullptr)
+			checkpoint.rewind();
+		if (node == nullptr || !m_flat)
+			m_memo.emplace(key, MemoEntry{node, m_source.pos()});
+		return node;
 	}
-	bool match(std::function<bool(Token)> func) {
-		bool res = func(curTok());
+
+	/* Token tests take a token or any predicate on tokens, e.g. isType or a lambda; predicates
+	   are template arguments, so the calls inline. Values are views into the source. */
+	bool peekCur(Token tok) const { return curTok() == tok; }
+	template <typename Pred> bool peekCur(Pred pred) const { return pred(curTok()); }
+	template <typename Test> bool match(Test test) {
+		bool res = peekCur(test);
 		if (res)
 			advance();
 		return res;
-	};
-	bool matchGet(Token tok, std::string& val) {
-		val = curVal();
-		return match(tok);
 	}
-	bool matchGet(std::function<bool(Token)> func, std::string& val) {
+	template <typename Test> bool matchGet(Test test, std::string_view& val) {
 		val = curVal();
-		return match(func);
+		return match(test);
 	}
-	
-	bool expect(Token tok) {
-		if (match(tok)) return true;
-		throw UnexpectedToken(curTokInfo(), tok);
-		return false;
+	template <typename Test> bool expect(Test test) {
+		if (match(test))
+			return true;
+		throw UnexpectedToken(curTokInfo(), curLoc(), test);
 	}
-	bool expect(std::function<bool(Token)> func) {
-		if (match(func)) return true;
-		throw UnexpectedToken(curTokInfo(), func);
-		return false;
+	template <typename Test> bool expectGet(Test test, std::string_view& val) {
+		if (matchGet(test, val))
+			return true;
+		throw UnexpectedToken(curTokInfo(), curLoc(), test);
 	}
-	bool expectGet(Token tok, std::string& val) {
-		if (matchGet(tok, val)) return true;
-		throw UnexpectedToken(curTokInfo(), tok);
-		return false;
+
+	template <typename T, typename... Args> T* makeExpr(Args&&... args) {
+		T* expr = m_arena.make<T>(std::forward<Args>(args)...);
+		if (m_flat)
+			m_flat->append(expr);
+		return expr;
 	}
-	bool expectGet(std::function<bool(Token)> func, std::string& val) {
-		if (matchGet(func, val)) return true;
-		throw UnexpectedToken(curTokInfo(), func);
-		return false;
+
+	/* Child lists are collected on one scratch stack shared by all rules, a nested rule pushing
+	   above its caller's entries, and copied into the arena once complete. Whoever catches a
+	   ParseError drops what the abandoned rules left above its own mark. */
+	template <typename T> AstList<T> takeList(size_t mark) {
+		AstList<T> list = m_arena.list<T>(m_scratch.begin() + mark, m_scratch.end());
+		m_scratch.resize(mark);
+		return list;
 	}
 
+	void beginParse();
+	void endParse();
+	/// Token positions splitting the input into at most maxChunks runs of whole top-level items.
+	std::vector<size_t> chunkBoundaries(size_t maxChunks);
+	/// Fills m_functions from the tokens ahead, without parsing.
+	void hashFunctions();
+	/// The cached definition of the top-level function starting here, if the lookup has one.
+	FunctionDefinition* reuseFunction();
+
+	/* Panic-mode recovery. report() records an error (once per token position); synchronize()
+	   then skips to where parsing can resume: just past a ';' or a balanced '{...}', or before
+	   a '}' closing the enclosing block or the next 'function'. */
+	void report(const ParseError& e);
+	void synchronize();
+
 	Token curTok() const { return m_source.curTok(); }
-	std::string curVal() const { return m_source.curVal(); }
+	std::string_view curVal() const { return m_source.curVal(); }
 	TokenInfo curTokInfo() const { return m_source.curTokInfo(); }
+	Location curLoc() const { return m_source.curLoc(); }
 	void advance() { m_source.advance(); }
 	bool eof() const { return m_source.curTok() == Token::EOS; }
 
-	std::shared_ptr<SourceUnit> parseSourceUnit();
-	std::shared_ptr<VariableDefinition> parseVariableDefinition();
-	std::shared_ptr<FunctionDefinition> parseFunctionDefinition();
-	std::shared_ptr<StructDefinition> parseStructDefinition();
-	std::shared_ptr<ParameterList> parseParameterList();
-	std::shared_ptr<TypeName> parseTypeName();
-	std::shared_ptr<Block> parseBlock();
-	std::shared_ptr<Statement> parseStatement();
-	std::shared_ptr<ReturnStatement> parseReturn();
-	std::shared_ptr<Expression> parseExpression(
-		std::shared_ptr<Expression> const& partiallyParsedExpression = std::shared_ptr<Expression>()
-	);
-	std::shared_ptr<Expression> parseBinaryExpression(
-		int minPrecedence = 4,
-		std::shared_ptr<Expression> const& partiallyParsedExpression = std::shared_ptr<Expression>()
-	);
-	std::shared_ptr<Expression> parseUnaryExpression(
-		std::shared_ptr<Expression> const& partiallyParsedExpression = std::shared_ptr<Expression>()
-	);
-	std::shared_ptr<Expression> parseLeftHandSideExpression(
-		std::shared_ptr<Expression> const& partiallyParsedExpression = std::shared_ptr<Expression>()
-	);
-	std::shared_ptr<Expression> parsePrimaryExpression();
-	std::shared_ptr<Expression> parseLiterial();
-	std::shared_ptr<IfStatement> parseIf();
-	std::shared_ptr<WhileStatement> parseWhile();
-	std::shared_ptr<ForStatement> parseFor();
-	std::shared_ptr<DoWhileStatement> parseDoWhile();
-	std::shared_ptr<ContinueStatement> parseContinue();
-	std::shared_ptr<BreakStatement> parseBreak();
-	std::shared_ptr<ExpressionStatement> parseExpressionStatement();
+	SourceUnit* parseSourceUnit();
+	VariableDefinition* parseVariableDefinition();
+	FunctionDefinition* parseFunctionDefinition();
+	StructDefinition* parseStructDefinition();
+	/// The rest of a struct variable declaration, from the variable name on.
+	StructDefinition* parseStructVariable(std::string_view structName, TypeName* type);
+	/// A struct variable declared without the struct keyword, "S x", or nullptr if this is not one.
+	StructDefinition* speculateStructVariable();
+	ParameterList* parseParameterList();
+	TypeName* parseTypeName();
+	Block* parseBlock();
+	Statement* parseStatement();
+	ReturnStatement* parseReturn();
+	Expression* parseExpression();
+	Expression* parsePostfixExpression(Expression* expr);
+	Expression* parsePrimaryExpression();
+	Expression* parseLiterial();
+	IfStatement* parseIf();
+	WhileStatement* parseWhile();
+	ForStatement* parseFor();
+	DoWhileStatement* parseDoWhile();
+	ContinueStatement* parseContinue();
+	BreakStatement* parseBreak();
+	ExpressionStatement* parseExpressionStatement();
 
 	TokenStream& m_source;
-	std::shared_ptr<BaseAST> m_root;
+	AstArena m_arena; // owns every node reachable from m_root
+	BaseAST* m_root = nullptr;
+	std::optional<FlatExprStore> m_flat;
+
+	struct MemoEntry {
+		BaseAST* node; // nullptr if the rule failed here
+		size_t end;
+	};
+	std::unordered_map<uint64_t, MemoEntry> m_memo;
+	std::vector<std::unique_ptr<ParseError>> m_diagnostics;
+	size_t m_lastErrorPos = SIZE_MAX;
+	std::vector<std::unique_ptr<Parser>> m_chunks; // keep the arenas of a parallel parse alive
+
+	/* Operators and operands parseExpression() has not combined yet. Nested calls (call
+	   arguments, indices) work above the sizes they found on entry. */
+	struct PendingOp {
+		Token tok;
+		int precedence; // 0 for an open '('
+	};
+	std::vector<PendingOp> m_pendingOps;
+	std::vector<Expression*> m_operands;
+	std::vector<BaseAST*> m_scratch;
+	size_t m_rewinds = 0;
+	size_t m_memoHits = 0;
+
+	FunctionLookup m_lookup;
+	std::vector<TopLevelFunction> m_functions;
+	size_t m_nextFunction = 0; // first entry of m_functions not reached yet
 };
 
 }
@@ -1,10 +1,15 @@
 #pragma once
 
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace minisolc {
@@ -19,164 +24,201 @@ struct Line {
 		: source(source), lineNumber(lineNumber), fileName(fileName), includeLine(includeLine) {}
 };
 
+/* All preprocessed text lives in one contiguous buffer: either owned by the stream, or a
+   memory-mapped file adopted as-is when no rewriting was needed. m_lineStarts is a side
+   table of line-start offsets (with a trailing entry equal to the buffer size), so line i
+   spans [m_lineStarts[i], m_lineStarts[i + 1]) and an offset is mapped back to its line
+   with a binary search.
+
+   Line metadata is kept per segment, a run of consecutive lines of one file; the Line
+   objects used for diagnostics are only materialized when line() asks for them. */
 class CharStream {
 public:
-	CharStream() {}
-	void push_back(std::shared_ptr<Line> line) { m_lines.emplace_back(line); }
+	CharStream() { m_lineStarts.push_back(0); }
+
+	/// Start a run of lines taken from fileName, the first of which is line lineNumber.
+	void beginSegment(const std::string& fileName, size_t lineNumber, std::shared_ptr<Line> includeLine) {
+		m_segments.push_back({m_lines, lineNumber, fileName, std::move(includeLine)});
+	}
 
-	std::string str() const {
-		std::string result;
-		for (const auto& line: m_lines) {
-			result += line->source;
+	/// Append one line of the current segment; the '\n' terminator is added here.
+	void appendLine(std::string_view text) {
+		m_buffer.append(text.data(), text.size());
+		m_buffer.push_back('\n');
+		m_lineStarts.push_back(m_buffer.size());
+		++m_lines;
+	}
+
+	/// Use file's bytes as the whole stream without copying them. Every line of file must be '\n' terminated.
+	void adopt(std::shared_ptr<const MappedFile> file, const std::string& fileName) {
+		m_buffer.clear();
+		m_lineStarts.assign(1, 0);
+		m_segments.clear();
+		m_lineCache.clear();
+		m_lines = 0;
+		m_mapped = std::move(file);
+		beginSegment(fileName, 1, nullptr);
+		const char* begin = m_mapped->data();
+		const char* end = begin + m_mapped->size();
+		for (const char* p = begin; p < end;) {
+			const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+			p = eol + 1;
+			m_lineStarts.push_back(static_cast<size_t>(p - begin));
+			++m_lines;
 		}
-		return result;
 	}
 
+	void reserve(size_t size) { m_buffer.reserve(size); }
+	bool empty() const { return size() == 0; }
+
+	std::string str() const { return std::string(data(), size()); }
+
 	void Dump() const { std::cout << str() << std::endl; }
 
+	const char* data() const { return m_mapped ? m_mapped->data() : m_buffer.data(); }
+	size_t size() const { return m_mapped ? m_mapped->size() : m_buffer.size(); }
+	size_t lineCount() const { return m_lines; }
+	size_t lineStart(size_t lineIndex) const { return m_lineStarts[lineIndex]; }
+	std::string_view lineText(size_t lineIndex) const {
+		return std::string_view(data() + m_lineStarts[lineIndex], m_lineStarts[lineIndex + 1] - m_lineStarts[lineIndex]);
+	}
+
+	/// Index of the line containing offset; the end of the stream belongs to the last line.
+	size_t lineIndexOf(size_t offset) const {
+		if (m_lines == 0)
+			return 0;
+		auto it = std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend() - 1, offset);
+		return static_cast<size_t>(it - m_lineStarts.cbegin()) - 1;
+	}
+
+	/// Safe to call from several threads, e.g. parser workers reporting errors.
+	std::shared_ptr<Line> line(size_t lineIndex) const {
+		if (lineIndex >= m_lines)
+			return nullptr;
+		std::lock_guard<std::mutex> lock(m_lineCacheMutex);
+		if (m_lineCache.size() < m_lines)
+			m_lineCache.resize(m_lines);
+		std::shared_ptr<Line>& cached = m_lineCache[lineIndex];
+		if (cached == nullptr) {
+			auto seg = std::upper_bound(
+				m_segments.cbegin(), m_segments.cend(), lineIndex, [](size_t index, const Segment& segment) {
+					return index < segment.firstLine;
+				});
+			--seg;
+			cached = std::make_shared<Line>(
+				std::string(lineText(lineIndex)),
+				seg->lineNumber + (lineIndex - seg->firstLine),
+				seg->fileName,
+				seg->includeLine);
+		}
+		return cached;
+	}
+
 	class const_iterator {
 	public:
 		using value_type = char;
 		using difference_type = std::ptrdiff_t;
 		using pointer = const char*;
 		using reference = const char&;
-		using iterator_category = std::input_iterator_tag;
-
-		const_iterator(): stream(nullptr), lineIndex(0), charIndex(0) {}
-		const_iterator(const CharStream* stream, std::size_t lineIndex, std::size_t charIndex)
-			: stream(stream), lineIndex(lineIndex), charIndex(charIndex) {}
+		using iterator_category = std::random_access_iterator_tag;
 
-		char operator*() const { return stream->m_lines[lineIndex]->source[charIndex]; }
+		const_iterator(): stream(nullptr), ptr(nullptr) {}
+		const_iterator(const CharStream* stream, const char* ptr): stream(stream), ptr(ptr) {}
 
-		const_iterator operator+(int n) const {
-			const_iterator result = *this;
-			for (int i = 0; i < n; ++i) {
-				++result;
-			}
-			return result;
-		}
+		/* The buffer is always followed by a NUL, so dereferencing cend() yields '\0'. */
+		reference operator*() const { return *ptr; }
+		reference operator[](difference_type n) const { return ptr[n]; }
 
 		const_iterator& operator++() {
-			if (lineIndex >= stream->m_lines.size()) {
-				return *this;
-			}
-			if (charIndex < stream->m_lines[lineIndex]->source.size() - 1) {
-				++charIndex;
-			} else if (lineIndex < stream->m_lines.size() - 1) {
-				++lineIndex;
-				charIndex = 0;
-			} else {
-				stream = nullptr;
-				lineIndex = 0;
-				charIndex = 0;
-			}
+			++ptr;
 			return *this;
 		}
 
 		const_iterator operator++(int) {
 			const_iterator old = *this;
-			++(*this);
+			++ptr;
 			return old;
 		}
 
-		const_iterator& operator+=(int n) {
-			for (int i = 0; i < n; ++i) {
-				++(*this);
-			}
-			return *this;
-		}
-
 		const_iterator& operator--() {
-			if (lineIndex == 0 && charIndex == 0) {
-				return *this;
-			}
-			if (charIndex > 0) {
-				--charIndex;
-			} else {
-				--lineIndex;
-				charIndex = stream->m_lines[lineIndex]->source.size() - 1;
-			}
+			--ptr;
 			return *this;
 		}
 
 		const_iterator operator--(int) {
 			const_iterator old = *this;
-			--(*this);
+			--ptr;
 			return old;
 		}
 
-		const_iterator& operator-=(int n) {
-			for (int i = 0; i < n; ++i) {
-				--(*this);
-			}
+		const_iterator& operator+=(difference_type n) {
+			ptr += n;
 			return *this;
 		}
 
-		const_iterator operator-(int n) const {
-			const_iterator result = *this;
-			for (int i = 0; i < n; ++i) {
-				--result;
-			}
-			return result;
+		const_iterator& operator-=(difference_type n) {
+			ptr -= n;
+			return *this;
 		}
 
-		bool operator==(const const_iterator& other) const {
-			return stream == other.stream && lineIndex == other.lineIndex && charIndex == other.charIndex;
-		}
+		const_iterator operator+(difference_type n) const { return const_iterator(stream, ptr + n); }
+		const_iterator operator-(difference_type n) const { return const_iterator(stream, ptr - n); }
+		difference_type operator-(const const_iterator& other) const { return ptr - other.ptr; }
 
-		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+		bool operator==(const const_iterator& other) const { return ptr == other.ptr; }
+		bool operator!=(const const_iterator& other) const { return ptr != other.ptr; }
+		bool operator<(const const_iterator& other) const { return ptr < other.ptr; }
+		bool operator>(const const_iterator& other) const { return ptr > other.ptr; }
+		bool operator<=(const const_iterator& other) const { return ptr <= other.ptr; }
+		bool operator>=(const const_iterator& other) const { return ptr >= other.ptr; }
 
 		const_iterator find(char c) const {
-			const_iterator it = *this;
-			while (it != stream->cend()) {
-				if (*it == c) {
-					return it;
-				}
-				++it;
-			}
-			return stream->cend();
+			const char* end = stream->data() + stream->size();
+			const void* res = std::memchr(ptr, c, static_cast<size_t>(end - ptr));
+			return res == nullptr ? stream->cend() : const_iterator(stream, static_cast<const char*>(res));
 		}
 
-		const_iterator find(std::string s) const {
-			const_iterator it = *this;
-			while (it != stream->cend()) {
-				bool found = true;
-				for (size_t i = 0; i < s.size(); ++i) {
-					if (it + i == stream->cend() || *(it + i) != s[i]) {
-						found = false;
-						break;
-					}
-				}
-				if (found) {
-					return it;
-				}
-				++it;
-			}
-			return stream->cend();
+		const_iterator find(std::string_view s) const {
+			std::string_view rest(ptr, static_cast<size_t>(stream->data() + stream->size() - ptr));
+			size_t pos = rest.find(s);
+			return pos == std::string_view::npos ? stream->cend() : const_iterator(stream, ptr + pos);
 		}
 
-		size_t linePos() const { return charIndex; }
-		std::shared_ptr<Line> line() const { 
-			if (stream == nullptr) return nullptr;
-			return stream->m_lines[lineIndex]; 
+		size_t offset() const { return static_cast<size_t>(ptr - stream->data()); }
+		size_t linePos() const { return offset() - stream->lineStart(stream->lineIndexOf(offset())); }
+		std::shared_ptr<Line> line() const {
+			if (stream == nullptr)
+				return nullptr;
+			return stream->line(stream->lineIndexOf(offset()));
 		}
 
 		const CharStream* stream;
-		std::size_t lineIndex;
-		std::size_t charIndex;
-	private:
+		const char* ptr;
 	};
 
-	const_iterator cbegin() const { return const_iterator(this, 0, 0); }
+	const_iterator cbegin() const { return const_iterator(this, data()); }
 
-	const_iterator cend() const { return const_iterator(nullptr, 0, 0); }
+	const_iterator cend() const { return const_iterator(this, data() + size()); }
 
 	const_iterator find(char c, const_iterator it) const { return it.find(c); }
 
-	const_iterator find(std::string s, const_iterator it) const { return it.find(s); }
+	const_iterator find(std::string_view s, const_iterator it) const { return it.find(s); }
 
 private:
-	std::vector<std::shared_ptr<Line>> m_lines;
+	struct Segment {
+		size_t firstLine;  // index of the segment's first line in the stream
+		size_t lineNumber; // line number of that line in its file
+		std::string fileName;
+		std::shared_ptr<Line> includeLine;
+	};
+
+	std::string m_buffer;
+	std::shared_ptr<const MappedFile> m_mapped;
+	std::vector<size_t> m_lineStarts;
+	std::vector<Segment> m_segments;
+	size_t m_lines = 0;
+	mutable std::vector<std::shared_ptr<Line>> m_lineCache;
+	mutable std::mutex m_lineCacheMutex;
 };
 
 
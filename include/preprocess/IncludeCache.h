@@ -0,0 +1,52 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace minisolc {
+
+/* A source file read and split into lines once. The lines are views into file. */
+struct SourceFile {
+	std::shared_ptr<MappedFile> file;
+	std::vector<std::string_view> lines;
+	std::filesystem::file_time_type mtime;
+	bool hasDirective = false; // some line starts with '#'
+	bool terminated = true;	   // the file is empty or ends with '\n'
+};
+
+/* Files already read by the preprocessor, keyed by canonical path. An entry is reused as
+   long as the file's modification time is unchanged, so one cache may be shared by several
+   Preprocess runs. load() may be called from several threads at once. */
+class IncludeCache {
+public:
+	/// Canonical form of path, used as the cache key and for include-once checks.
+	static std::string canonicalName(const std::filesystem::path& path);
+
+	/// The split file at path, read from disk unless a fresh entry is cached.
+	/// Returns nullptr if the file cannot be opened. hit, if given, tells whether the cache was used.
+	std::shared_ptr<const SourceFile> load(const std::filesystem::path& path, bool* hit = nullptr);
+
+	size_t hits() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_files.size();
+	}
+
+private:
+	static std::shared_ptr<const SourceFile> read(const std::filesystem::path& path, std::filesystem::file_time_type mtime);
+
+	std::unordered_map<std::string, std::shared_ptr<const SourceFile>> m_files;
+	size_t m_hits = 0;
+	mutable std::mutex m_mutex;
+};
+
+}
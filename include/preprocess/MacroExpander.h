@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace minisolc {
+
+struct Macro {
+	std::string name;
+	std::vector<std::string> params;
+	std::string body;
+	bool functionLike = false;
+	bool rescan = true; // false when the body mentions no identifier and can be pasted as-is
+};
+
+/* Expands #define macros one identifier at a time: every identifier outside string
+   literals and comments costs a single hash lookup, so a line is expanded in time
+   linear in its length no matter how many macros are defined. Function-like macros
+   take their arguments from the same line. A macro is never expanded again inside
+   its own expansion, which keeps recursive definitions finite. */
+class MacroExpander {
+public:
+	/// Parse "#define NAME body" or "#define NAME(a, b) body". Returns false if malformed.
+	bool define(std::string_view directive);
+
+	/// Expand the macros used in line into out (which is overwritten).
+	/// Returns false, leaving out unspecified, when line contains no macro use.
+	bool expand(std::string_view line, std::string& out);
+
+	bool empty() const { return m_macros.empty(); }
+	size_t size() const { return m_macros.size(); }
+
+	/* Block comments are tracked across lines; a new file starts outside of one. */
+	bool inBlockComment() const { return m_inBlockComment; }
+	void setInBlockComment(bool inBlockComment) { m_inBlockComment = inBlockComment; }
+
+private:
+	bool expandText(std::string_view text, std::string& out, bool trackComments);
+	void substitute(const Macro& macro, const std::vector<std::string_view>& args, std::string& out);
+	const Macro* find(std::string_view name) const;
+	bool isActive(const Macro* macro) const;
+
+	std::unordered_map<std::string_view, std::unique_ptr<Macro>> m_macros; // keys point into Macro::name
+	std::vector<const Macro*> m_active;
+	bool m_inBlockComment = false;
+};
+
+}
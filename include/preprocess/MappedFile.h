@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common/Defs.h"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace minisolc {
+
+/* A read-only view of a whole source file. On POSIX systems the file is mapped
+   with mmap so the preprocessor and lexer can read it without copying; the bytes
+   between the end of the file and the end of the last page are zero, which gives
+   the lexer the NUL sentinel it relies on. Files whose size is an exact multiple
+   of the page size (and platforms without mmap) are read into memory instead. */
+class MappedFile {
+public:
+	static std::shared_ptr<MappedFile> open(const std::filesystem::path& path);
+	~MappedFile();
+	DISALLOW_COPY_AND_MOVE(MappedFile);
+
+	const char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	std::string_view view() const { return std::string_view(m_data, m_size); }
+	bool isMapped() const { return m_mapping != nullptr; }
+
+private:
+	MappedFile() = default;
+	bool readFallback(const std::filesystem::path& path);
+
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	void* m_mapping = nullptr;
+	size_t m_mappingSize = 0;
+	std::string m_fallback;
+};
+
+}
@@ -1,28 +1,44 @@
 #pragma once
 
 #include "CharStream.h"
+#include "IncludeCache.h"
+#include "MacroExpander.h"
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
-#include <map>
 
 namespace minisolc {
 
 class Preprocess {
 public:
-	Preprocess(std::filesystem::path filePath) { preprocess(filePath); };
+	/// cache may be shared with other runs; a private one is created when it is null.
+	Preprocess(std::filesystem::path filePath, std::shared_ptr<IncludeCache> cache = nullptr)
+		: m_cache(cache != nullptr ? std::move(cache) : std::make_shared<IncludeCache>()) {
+		preprocess(filePath);
+	};
 	void preprocess(std::filesystem::path filePath, std::shared_ptr<Line> includeLine = nullptr);
-	CharStream source() const { return m_stream; }
+	const CharStream& source() const { return m_stream; }
+	/// Canonical names of every file spliced into source(), the root file included.
+	const std::unordered_set<std::string>& includedFiles() const { return m_included; }
 	void Dump() const { m_stream.Dump(); };
 
 private:
 	std::filesystem::path getRelativePath(std::filesystem::path path) const;
 	void processInclude(const std::string& line, std::filesystem::path parentPath, std::shared_ptr<Line> includeLine);
 	void processDefine(const std::string& line);
+	void prefetchIncludes(const std::filesystem::path& root, const SourceFile& rootSource);
+	void logSuccess() const;
 
 	CharStream m_stream;
-	std::map<std::string, std::string> m_defines;
+	MacroExpander m_macros;
+	std::shared_ptr<IncludeCache> m_cache;
+	std::unordered_set<std::string> m_included; // canonical names of the files already spliced in
+	size_t m_includes = 0;
+	size_t m_skippedIncludes = 0; // repeated includes
+	size_t m_cachedIncludes = 0;  // included files already read by an earlier run
 };
 
 }
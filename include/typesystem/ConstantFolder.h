@@ -0,0 +1,81 @@
+#pragma once
+
+#include "parser/Ast.h"
+#include "parser/AstArena.h"
+#include "parser/AstVisitor.h"
+#include <cstddef>
+#include <cstdint>
+#include <llvm/ADT/APInt.h>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace minisolc {
+
+/// The value of an integer literal (decimal, 0x hexadecimal or 0 octal, as the lexer reads them),
+/// optionally negated with a leading '-', as a bits-wide integer; nullopt if it is malformed or
+/// its magnitude does not fit in bits.
+std::optional<llvm::APInt> parseIntegerLiteral(std::string_view text, uint16_t bits);
+
+/* Folds constant integer and boolean expressions of an analyzed tree into literals, with the
+   semantics of the IR CodeGenerator emits for them: an integer wraps at the width TypeSystem
+   gave it, divides, compares and shifts right signed or unsigned as its type says, and meets
+   an operand of another type at their common type; bool is a 1-bit integer. An operation
+   whose IR result is undefined (division by zero, a shift by the width or more) is left
+   alone, and so is anything on floating point values. An integer or bool variable, local or
+   global, that is initialized with a constant of its own type and never assigned again is
+   propagated into its uses, which folds the values of #define'd names once they are bound to
+   variables. NameResolver marks assignments in every function, so a global written anywhere
+   is not propagated. An if with a constant condition loses the block it can never run.
+
+   Runs after TypeSystem, whose types it copies onto the literals, and NameResolver, whose
+   slots and assignment marks it relies on. New nodes live in the folder's own arena, so the
+   folder must outlive every pass over the tree. */
+class ConstantFolder: public AstVisitor<ConstantFolder, Expression*> {
+public:
+	ConstantFolder(BaseAST* root);
+
+	/// The number of expressions replaced by a literal.
+	size_t foldedCount() const { return m_folded; }
+
+private:
+	friend class AstVisitor<ConstantFolder, Expression*>;
+
+	/// Folds the statements below node.
+	void foldStatement(BaseAST* node) { visit(node); }
+	/// Folds node and returns what should replace it, possibly node itself.
+	Expression* fold(Expression* node) {
+		Expression* folded = visit(node);
+		return folded != nullptr ? folded : node;
+	}
+
+	/// The value of a literal this pass can fold: an integer literal that fits its type or a bool literal.
+	static std::optional<llvm::APInt> constantValue(const Expression* expr);
+	/// A literal for value, typed like the expression it replaces but as wide as value.
+	Expression* makeLiteral(const llvm::APInt& value, const Expression* replaced);
+
+	Expression* visitSourceUnit(SourceUnit* node);
+	Expression* visitPlainVariableDefinition(PlainVariableDefinition* node);
+	Expression* visitArrayDefinition(ArrayDefinition* node);
+	Expression* visitStructDefinition(StructDefinition* node);
+	Expression* visitBlock(Block* node);
+	Expression* visitFunctionDefinition(FunctionDefinition* node);
+	Expression* visitReturnStatement(ReturnStatement* node);
+	Expression* visitIdentifier(Identifier* node);
+	Expression* visitAssignment(Assignment* node);
+	Expression* visitBinaryOp(BinaryOp* node);
+	Expression* visitUnaryOp(UnaryOp* node);
+	Expression* visitIfStatement(IfStatement* node);
+	Expression* visitWhileStatement(WhileStatement* node);
+	Expression* visitForStatement(ForStatement* node);
+	Expression* visitDoWhileStatement(DoWhileStatement* node);
+	Expression* visitExpressionStatement(ExpressionStatement* node);
+	Expression* visitIndexAccess(IndexAccess* node);
+	Expression* visitFunctionCall(FunctionCall* node);
+
+	AstArena m_arena;
+	std::vector<std::optional<llvm::APInt>> m_constants; // by declaration slot
+	size_t m_folded = 0;
+};
+
+}
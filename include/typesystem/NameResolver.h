@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common/ScopedSymbolTable.h"
+#include "parser/Ast.h"
+#include "parser/AstVisitor.h"
+#include <cstdint>
+#include <vector>
+
+namespace minisolc {
+
+/* Numbers every declaration of the tree with a slot and stores on each Identifier the slot of
+   the declaration it names, so later passes index per-slot tables instead of looking names
+   up. Scopes follow CodeGenerator: a function's parameters and the top level of its body
+   share one scope, loop bodies get one more, and a for loop's initializer belongs to the
+   enclosing scope. A function's own name is declared after its body, as TypeSystem did.
+   Declarations that are written after their definition are marked with SetAssigned(). */
+class NameResolver: public AstVisitor<NameResolver, void> {
+public:
+	NameResolver(BaseAST* root) { resolve(root); }
+
+	/// The number of slots handed out; every slot is below it.
+	uint32_t slotCount() const { return static_cast<uint32_t>(m_declarations.size()); }
+
+private:
+	friend class AstVisitor<NameResolver, void>;
+
+	void resolve(BaseAST* node) { visit(node); }
+	void declare(Declaration* declaration);
+	void markAssigned(Expression* target);
+
+	void visitSourceUnit(SourceUnit* node);
+	void visitPlainVariableDefinition(PlainVariableDefinition* node);
+	void visitArrayDefinition(ArrayDefinition* node);
+	void visitStructDefinition(StructDefinition* node);
+	void visitBlock(Block* node);
+	void visitFunctionDefinition(FunctionDefinition* node);
+	void visitReturnStatement(ReturnStatement* node);
+	void visitIdentifier(Identifier* node);
+	void visitAssignment(Assignment* node);
+	void visitBinaryOp(BinaryOp* node);
+	void visitUnaryOp(UnaryOp* node);
+	void visitIfStatement(IfStatement* node);
+	void visitWhileStatement(WhileStatement* node);
+	void visitForStatement(ForStatement* node);
+	void visitDoWhileStatement(DoWhileStatement* node);
+	void visitExpressionStatement(ExpressionStatement* node);
+	void visitIndexAccess(IndexAccess* node);
+	void visitFunctionCall(FunctionCall* node);
+	void visitMemberAccess(MemberAccess* node);
+
+	ScopedSymbolTable<uint32_t> m_scopes;
+	std::vector<Declaration*> m_declarations; // by slot
+};
+
+}
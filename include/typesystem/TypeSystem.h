@@ -3,9 +3,15 @@
 
 #include "lexer/Token.h"
 #include "parser/Ast.h"
+#include "parser/AstVisitor.h"
 #include "parser/Parser.h"
-#include <map>
+#include "typesystem/NameResolver.h"
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 using namespace minisolc;
 
@@ -13,11 +19,15 @@ using namespace minisolc;
 // 从parser拿到AST的root，遍历这个tree，codegen
 
 ;
-class TypeSystem {
+class TypeSystem: public AstVisitor<TypeSystem, Type> {
 public:
-	TypeSystem(const Parser& parser) {
-		pushMap();
-		root = parser.GetAst();
+	TypeSystem(const Parser& parser): TypeSystem(parser.GetAst()) {}
+	/// Functions in reused were analyzed by an earlier run; only their names are declared.
+	/// Names are resolved for the whole tree first, reused functions included.
+	TypeSystem(BaseAST* ast, const std::unordered_set<const FunctionDefinition*>* reused = nullptr)
+		: m_reused(reused) {
+		root = ast;
+		NameResolver resolver(root);
 		analyze(root);
 		LOG_INFO("Analysis Succeeds.");
 	};
@@ -28,21 +38,57 @@ public:
 		}
 	}
 
-	// Function to add a new type to the type system
-	void setType(std::string identifier, Type type);
+	// Function to add a new type to the type system, by declaration slot
+	void setType(uint32_t slot, Type type, IntegerType intType = {});
 
-	Type getType(std::string identifier);
+	Type getType(uint32_t slot);
+	IntegerType getIntType(uint32_t slot);
 
-	void pushMap() { m_maps.push_back({}); }
+	Type analyze(BaseAST* AstNode) { return visit(AstNode); }
 
-	void popMap() { m_maps.pop_back(); }
 
-	Type analyze(const std::shared_ptr<BaseAST>& AstNode);
+private:
+	friend class AstVisitor<TypeSystem, Type>;
 
+	Type visitSourceUnit(SourceUnit* node);
+	Type visitPlainVariableDefinition(PlainVariableDefinition* node);
+	Type visitArrayDefinition(ArrayDefinition* node);
+	Type visitStructDefinition(StructDefinition* node);
+	Type visitBlock(Block* node);
+	Type visitFunctionDefinition(FunctionDefinition* node);
+	Type visitReturnStatement(ReturnStatement* node);
+	Type visitIdentifier(Identifier* node);
+	Type visitBooleanLiteral(BooleanLiteral* node);
+	Type visitStringLiteral(StringLiteral* node);
+	Type visitNumberLiteral(NumberLiteral* node);
+	Type visitAssignment(Assignment* node);
+	Type visitBinaryOp(BinaryOp* node);
+	Type visitUnaryOp(UnaryOp* node);
+	Type visitIfStatement(IfStatement* node);
+	Type visitWhileStatement(WhileStatement* node);
+	Type visitForStatement(ForStatement* node);
+	Type visitDoWhileStatement(DoWhileStatement* node);
+	Type visitBreakStatement(BreakStatement* node);
+	Type visitContinueStatement(ContinueStatement* node);
+	Type visitExpressionStatement(ExpressionStatement* node);
+	Type visitIndexAccess(IndexAccess* node);
+	Type visitFunctionCall(FunctionCall* node);
+	Type visitMemberAccess(MemberAccess* node);
 
-private:
-	std::vector<std::map<std::string, Type>> m_maps;
-	std::shared_ptr<BaseAST> root;
+	void declareFunction(FunctionDefinition* node);
+	/// Give an expression built from integer literals only the integer type of its context.
+	void adoptIntType(Expression* expr, IntegerType type);
+
+	struct SlotType {
+		Type type;
+		IntegerType intType; // width and signedness if type is INTEGER
+	};
+
+	std::vector<std::optional<SlotType>> m_types; // by declaration slot; empty until analyzed
+	std::vector<FunctionDefinition*> m_functions;  // by declaration slot, for argument types
+	std::optional<IntegerType> m_returnIntType;    // of the function being analyzed
+	BaseAST* root;
+	const std::unordered_set<const FunctionDefinition*>* m_reused;
 };
 
 #endif // TYPE_SYSTEM_H
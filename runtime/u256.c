@@ -0,0 +1,208 @@
+#include "u256.h"
+
+#include <string.h>
+
+typedef unsigned __int128 u128;
+
+/* The number of limbs up to the most significant non-zero one. */
+static int significantLimbs(const uint64_t a[4]) {
+	int n = 4;
+	while (n > 0 && a[n - 1] == 0)
+		--n;
+	return n;
+}
+
+static int lessThan(const uint64_t a[4], const uint64_t b[4]) {
+	for (int i = 3; i >= 0; --i) {
+		if (a[i] != b[i])
+			return a[i] < b[i];
+	}
+	return 0;
+}
+
+static void negate(uint64_t r[4], const uint64_t a[4]) {
+	uint64_t carry = 1;
+	for (int i = 0; i < 4; ++i) {
+		u128 sum = (u128)~a[i] + carry;
+		r[i] = (uint64_t)sum;
+		carry = (uint64_t)(sum >> 64);
+	}
+}
+
+static void shiftLeft(uint64_t r[4], const uint64_t a[4], unsigned shift) {
+	uint64_t t[4] = {0, 0, 0, 0};
+	unsigned limbs = shift / 64, bits = shift % 64;
+	for (unsigned i = limbs; i < 4; ++i) {
+		t[i] = a[i - limbs] << bits;
+		if (bits != 0 && i > limbs)
+			t[i] |= a[i - limbs - 1] >> (64 - bits);
+	}
+	memcpy(r, t, sizeof(t));
+}
+
+/* q = a / b and r = a % b for a non-zero b: a short division when b is a single limb, u128
+   division when both fit in two, and Knuth's algorithm D (TAOCP 4.3.1) with 64-bit digits
+   otherwise. */
+static void divmod(uint64_t q[4], uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	int n = significantLimbs(b), m = significantLimbs(a);
+	uint64_t quotient[4] = {0, 0, 0, 0}, remainder[4] = {0, 0, 0, 0};
+	if (m < n || (m == n && lessThan(a, b))) {
+		memcpy(remainder, a, sizeof(remainder));
+	} else if (n == 1) {
+		u128 rest = 0;
+		for (int i = m - 1; i >= 0; --i) {
+			u128 current = (rest << 64) | a[i];
+			quotient[i] = (uint64_t)(current / b[0]);
+			rest = current % b[0];
+		}
+		remainder[0] = (uint64_t)rest;
+	} else if (m <= 2) {
+		u128 x = ((u128)a[1] << 64) | a[0], y = ((u128)b[1] << 64) | b[0];
+		u128 xq = x / y, xr = x % y;
+		quotient[0] = (uint64_t)xq, quotient[1] = (uint64_t)(xq >> 64);
+		remainder[0] = (uint64_t)xr, remainder[1] = (uint64_t)(xr >> 64);
+	} else {
+		/* Normalize so the divisor's top limb has its high bit set; the dividend gains a limb. */
+		unsigned shift = (unsigned)__builtin_clzll(b[n - 1]);
+		uint64_t v[4], u[5];
+		for (int i = n - 1; i > 0; --i)
+			v[i] = shift ? (b[i] << shift) | (b[i - 1] >> (64 - shift)) : b[i];
+		v[0] = b[0] << shift;
+		u[m] = shift ? a[m - 1] >> (64 - shift) : 0;
+		for (int i = m - 1; i > 0; --i)
+			u[i] = shift ? (a[i] << shift) | (a[i - 1] >> (64 - shift)) : a[i];
+		u[0] = a[0] << shift;
+
+		for (int j = m - n; j >= 0; --j) {
+			/* Estimate the quotient digit from the top two limbs; it is at most 2 too large. */
+			u128 top = ((u128)u[j + n] << 64) | u[j + n - 1];
+			u128 qhat = top / v[n - 1], rhat = top % v[n - 1];
+			while ((qhat >> 64) != 0 || qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+				--qhat;
+				rhat += v[n - 1];
+				if ((rhat >> 64) != 0)
+					break;
+			}
+			/* u[j..j+n] -= qhat * v, adding v back once if that went negative. */
+			uint64_t carry = 0, borrow = 0;
+			for (int i = 0; i < n; ++i) {
+				u128 product = qhat * v[i] + carry;
+				carry = (uint64_t)(product >> 64);
+				u128 difference = (u128)u[i + j] - (uint64_t)product - borrow;
+				u[i + j] = (uint64_t)difference;
+				borrow = (uint64_t)(difference >> 64) != 0;
+			}
+			u128 difference = (u128)u[j + n] - carry - borrow;
+			u[j + n] = (uint64_t)difference;
+			if ((uint64_t)(difference >> 64) != 0) {
+				--qhat;
+				carry = 0;
+				for (int i = 0; i < n; ++i) {
+					u128 sum = (u128)u[i + j] + v[i] + carry;
+					u[i + j] = (uint64_t)sum;
+					carry = (uint64_t)(sum >> 64);
+				}
+				u[j + n] += carry;
+			}
+			quotient[j] = (uint64_t)qhat;
+		}
+		for (int i = 0; i < n; ++i)
+			remainder[i] = shift ? (u[i] >> shift) | (u[i + 1] << (64 - shift)) : u[i];
+	}
+	if (q != NULL)
+		memcpy(q, quotient, sizeof(quotient));
+	if (r != NULL)
+		memcpy(r, remainder, sizeof(remainder));
+}
+
+void minisolc_u256_mul(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	/* Schoolbook, keeping only the 10 partial products below 2^256. */
+	uint64_t t[4] = {0, 0, 0, 0};
+	for (int i = 0; i < 4; ++i) {
+		uint64_t carry = 0;
+		for (int j = 0; i + j < 4; ++j) {
+			u128 product = (u128)a[i] * b[j] + t[i + j] + carry;
+			t[i + j] = (uint64_t)product;
+			carry = (uint64_t)(product >> 64);
+		}
+	}
+	memcpy(r, t, sizeof(t));
+}
+
+void minisolc_u256_div(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	if (significantLimbs(b) == 0)
+		memset(r, 0, 4 * sizeof(uint64_t));
+	else
+		divmod(r, NULL, a, b);
+}
+
+void minisolc_u256_mod(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	if (significantLimbs(b) == 0)
+		memset(r, 0, 4 * sizeof(uint64_t));
+	else
+		divmod(NULL, r, a, b);
+}
+
+void minisolc_i256_div(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	int negativeA = (int)(a[3] >> 63), negativeB = (int)(b[3] >> 63);
+	uint64_t x[4], y[4];
+	if (negativeA)
+		negate(x, a);
+	else
+		memcpy(x, a, sizeof(x));
+	if (negativeB)
+		negate(y, b);
+	else
+		memcpy(y, b, sizeof(y));
+	minisolc_u256_div(r, x, y);
+	if (negativeA != negativeB)
+		negate(r, r);
+}
+
+void minisolc_i256_mod(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+	int negativeA = (int)(a[3] >> 63);
+	uint64_t x[4], y[4];
+	if (negativeA)
+		negate(x, a);
+	else
+		memcpy(x, a, sizeof(x));
+	if (b[3] >> 63)
+		negate(y, b);
+	else
+		memcpy(y, b, sizeof(y));
+	minisolc_u256_mod(r, x, y);
+	if (negativeA)
+		negate(r, r);
+}
+
+void minisolc_u256_exp(uint64_t r[4], const uint64_t base[4], const uint64_t exponent[4]) {
+	int limbs = significantLimbs(exponent);
+	/* A power of two is a shift: (2^k)^e = 2^(k*e), and 1 is 2^0. */
+	int ones = 0;
+	for (int i = 0; i < 4; ++i)
+		ones += __builtin_popcountll(base[i]);
+	if (ones == 1) {
+		int top = significantLimbs(base) - 1;
+		u128 k = (u128)top * 64 + (unsigned)__builtin_ctzll(base[top]);
+		static const uint64_t one[4] = {1, 0, 0, 0};
+		if (k != 0 && (limbs > 1 || k * exponent[0] >= 256))
+			memset(r, 0, 4 * sizeof(uint64_t));
+		else
+			shiftLeft(r, one, (unsigned)(k * exponent[0]));
+		return;
+	}
+	/* Square and multiply from the least significant exponent bit. */
+	uint64_t result[4] = {1, 0, 0, 0}, power[4];
+	memcpy(power, base, sizeof(power));
+	for (int i = 0; i < limbs; ++i) {
+		uint64_t bits = exponent[i];
+		for (int bit = 0; bit < 64; ++bit, bits >>= 1) {
+			if (bits & 1)
+				minisolc_u256_mul(result, result, power);
+			if (i == limbs - 1 && (bits >> 1) == 0)
+				break;
+			minisolc_u256_mul(power, power, power);
+		}
+	}
+	memcpy(r, result, sizeof(result));
+}
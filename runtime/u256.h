@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+/* 256-bit integer kernels for programs built by minisolc, which calls them for the operations on
+   uint256 and int256 that LLVM has no (or no fast) lowering for.
+
+   A value is four 64-bit limbs, least significant first, which is also how an i256 is laid out
+   in memory on a little-endian target: codegen stores its operands to memory and passes
+   pointers. Arithmetic wraps modulo 2^256. Division and remainder by zero give 0 instead of
+   trapping, as the EVM does. The result may alias an operand.
+
+   Link the library with the program:
+       clang a.bc runtime/u256.c -O2 -o a.out */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void minisolc_u256_mul(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]);
+void minisolc_u256_div(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]);
+void minisolc_u256_mod(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]);
+/// Truncated towards zero, so the remainder takes the sign of the dividend; -2^255 / -1 wraps.
+void minisolc_i256_div(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]);
+void minisolc_i256_mod(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]);
+/// base ** exponent, the exponent unsigned; serves int256 as well since it wraps the same way.
+void minisolc_u256_exp(uint64_t r[4], const uint64_t base[4], const uint64_t exponent[4]);
+
+#ifdef __cplusplus
+}
+#endif
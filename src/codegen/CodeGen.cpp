@@ -1,6 +1,7 @@
 #include "codegen/CodeGen.h"
 #include "common/Defs.h"
 #include "parser/Ast.h"
+#include "typesystem/ConstantFolder.h"
 
 #include <fstream>
 #include <llvm/IR/Constants.h>
@@ -15,13 +16,17 @@ std::unique_ptr<llvm::LLVMContext> CodeGenerator::m_Context = std::make_unique<l
 std::unique_ptr<llvm::IRBuilder<>> CodeGenerator::m_Builder = std::make_unique<llvm::IRBuilder<>>(*m_Context);
 std::unique_ptr<llvm::Module> CodeGenerator::m_Module = std::make_unique<llvm::Module>("minisolc", *m_Context);
 
-llvm::Constant* CodeGenerator::getInitValue(Token tok) {
+llvm::Constant* CodeGenerator::getInitValue(Token tok, uint16_t bits) {
 	ASSERT(isType(tok), "Invalid type!");
 	switch (tok) {
 	case Token::Int:
 		[[fallthrough]];
 	case Token::UInt:
-		return m_Builder->getInt32(0);
+		[[fallthrough]];
+	case Token::IntM:
+		[[fallthrough]];
+	case Token::UIntM:
+		return m_Builder->getIntN(bits, 0);
 	case Token::String:
 		return nullptr;
 	case Token::Bool:
@@ -35,13 +40,17 @@ llvm::Constant* CodeGenerator::getInitValue(Token tok) {
 	}
 }
 
-llvm::Type* CodeGenerator::getLLVMType(Token type) {
+llvm::Type* CodeGenerator::getLLVMType(Token type, uint16_t bits) {
 	ASSERT(isType(type), "Invalid type!");
 	switch (type) {
 	case Token::Int:
 		[[fallthrough]];
 	case Token::UInt:
-		return llvm::Type::getInt32Ty(*m_Context);
+		[[fallthrough]];
+	case Token::IntM:
+		[[fallthrough]];
+	case Token::UIntM:
+		return llvm::Type::getIntNTy(*m_Context, bits);
 	case Token::String:
 		return llvm::Type::getInt8PtrTy(*m_Context);
 	case Token::Bool:
@@ -57,733 +66,860 @@ llvm::Type* CodeGenerator::getLLVMType(Token type) {
 	}
 }
 
-llvm::Value* CodeGenerator::generate(const std::shared_ptr<BaseAST>& AstNode, bool beginBlock, bool isleftval) {
-	switch (AstNode->GetASTType()) {
-	case ElementASTTypes::SourceUnit: {
-		const SourceUnit* node = dynamic_cast<const SourceUnit*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		for (const auto& subnode: node->getSubNodes()) {
-			this->generate(subnode);
-		}
-		return nullptr;
-	}
-	case ElementASTTypes::PlainVariableDefinition: {
-		const PlainVariableDefinition* node = dynamic_cast<const PlainVariableDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Token type = node->GetDeclarationType()->GetType();
-		llvm::Type* llvmType = getLLVMType(type);
-		llvm::Value* res = m_Builder->CreateAlloca(llvmType, nullptr);
-		setSymbolValue(node->GetName(), res);
-		setSymbolType(node->GetName(), llvmType);
-
-		auto& expr = node->getVarDefExpr();
-		if (expr != nullptr) {
-			res = generate(
-				std::make_shared<Assignment>(std::make_shared<Identifier>(node->GetName()), Token::Assign, expr));
-		} else {
-			// initialize the variable
-			llvm::Value* value = getInitValue(type);
-			if (value != nullptr)
-				m_Builder->CreateStore(value, res);
-		}
+llvm::Value* CodeGenerator::convertInteger(llvm::Value* value, llvm::Type* type, bool isSigned) {
+	if (value == nullptr || type == nullptr || value->getType() == type || !value->getType()->isIntegerTy()
+		|| !type->isIntegerTy())
+		return value;
+	if (type->isIntegerTy(1))
+		return m_Builder->CreateICmpNE(value, llvm::ConstantInt::get(value->getType(), 0));
+	return m_Builder->CreateIntCast(value, type, isSigned && !value->getType()->isIntegerTy(1));
+}
 
-		return res;
+llvm::Value* CodeGenerator::callU256Kernel(const char* name, llvm::Value* lhs, llvm::Value* rhs) {
+	llvm::Type* type = m_Builder->getIntNTy(256);
+	llvm::Function* kernel = m_Module->getFunction(name);
+	if (kernel == nullptr) {
+		llvm::Type* ptr = type->getPointerTo();
+		auto kernelType = llvm::FunctionType::get(m_Builder->getVoidTy(), {ptr, ptr, ptr}, false);
+		kernel = llvm::Function::Create(kernelType, llvm::Function::ExternalLinkage, name, m_Module.get());
 	}
-	case ElementASTTypes::ArrayDefinition: {
-		const ArrayDefinition* node = dynamic_cast<const ArrayDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Type* arrType = getLLVMType(node->GetDeclarationType()->GetType());
-		llvm::Value* arrSize = generate(node->GetArraySize());
-		llvm::Value* res = m_Builder->CreateAlloca(arrType, arrSize);
-		setSymbolValue(node->GetName(), res);
-		setSymbolType(node->GetName(), arrType);
-		return res;
+	/* The kernels take their operands in memory. The slots go in the entry block, so that a call
+	   inside a loop does not grow the stack. */
+	llvm::BasicBlock& entry = m_Builder->GetInsertBlock()->getParent()->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder(&entry, entry.begin());
+	llvm::AllocaInst* slots[3];
+	for (llvm::AllocaInst*& slot: slots) {
+		slot = entryBuilder.CreateAlloca(type);
+		slot->setAlignment(llvm::Align(16));
 	}
-	case ElementASTTypes::StructDefinition: {
-		const StructDefinition* node = dynamic_cast<const StructDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Value* res;
-		const std::string& structName = node->GetStructName();
-		if (node->GetisVariable()) {
-			/* A struct variable declaration. */
-			std::shared_ptr<MyStructType> myStruct = this->getStructType(structName);
-			ASSERT(myStruct != nullptr, "Invalid struct variable declaration!");
-			res = m_Builder->CreateAlloca(myStruct->GetStructType(), nullptr);
-			setSymbolValue(node->GetName(), res);
-			setSymbolType(node->GetName(), myStruct->GetStructType());
-			if (node->GetInitExpr() != nullptr) {
-				auto expr = node->GetInitExpr();
-				res = generate(
-					std::make_shared<Assignment>(	std::make_shared<Identifier>(node->GetName()), 
-													Token::Assign, 
-													node->GetInitExpr()
-					)
-				);
-			}
-		} else {
-			/* Struct type definition. */
-			std::shared_ptr<MyStructType> myStruct = std::make_shared<MyStructType>();
-			std::vector<llvm::Type*> stMems;
-			const auto& MemList = node->GetStructMemList();
-			llvm::Value* val;
-			for (const auto& mem: MemList) {
-				stMems.push_back(getLLVMType(mem->GetDeclarationType()->GetType()));
-				myStruct->AddElementName(mem->GetName());
-			}
-			myStruct->GetStructType() = llvm::StructType::create(*m_Context);
-			myStruct->GetStructType()->setBody(stMems);
-			myStruct->GetStructType()->setName(structName);
-			m_BlockStack.back().structdefs.push_back(std::move(myStruct));
-			res = nullptr;
-		}
+	m_Builder->CreateStore(lhs, slots[1]);
+	m_Builder->CreateStore(rhs, slots[2]);
+	m_Builder->CreateCall(kernel, {slots[0], slots[1], slots[2]});
+	return m_Builder->CreateLoad(type, slots[0]);
+}
 
-		return res;
-	}
-	case ElementASTTypes::Block: {
-		if (beginBlock) {
-			pushBlock();
-		}
+llvm::Value* CodeGenerator::emitPower(llvm::Value* base, llvm::Value* exponent) {
+	/* A bool exponent is widened: shifting an i1 right by one is poison. */
+	if (exponent->getType()->isIntegerTy(1))
+		exponent = m_Builder->CreateZExt(exponent, m_Builder->getInt8Ty());
+	llvm::Type* type = base->getType();
+	llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* preheader = m_Builder->GetInsertBlock();
+	llvm::BasicBlock* loopBlock = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* bodyBlock = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* exitBlock = llvm::BasicBlock::Create(*m_Context);
+	m_Builder->CreateBr(loopBlock);
+
+	/* From the least significant exponent bit: result *= power where it is set, power squared. */
+	function->getBasicBlockList().push_back(loopBlock);
+	m_Builder->SetInsertPoint(loopBlock);
+	llvm::PHINode* result = m_Builder->CreatePHI(type, 2);
+	llvm::PHINode* power = m_Builder->CreatePHI(type, 2);
+	llvm::PHINode* bits = m_Builder->CreatePHI(exponent->getType(), 2);
+	m_Builder->CreateCondBr(
+		m_Builder->CreateICmpEQ(bits, llvm::ConstantInt::get(exponent->getType(), 0)), exitBlock, bodyBlock);
+
+	function->getBasicBlockList().push_back(bodyBlock);
+	m_Builder->SetInsertPoint(bodyBlock);
+	llvm::Value* set = m_Builder->CreateTrunc(bits, m_Builder->getInt1Ty());
+	llvm::Value* nextResult = m_Builder->CreateSelect(set, m_Builder->CreateMul(result, power), result);
+	llvm::Value* nextPower = m_Builder->CreateMul(power, power);
+	llvm::Value* nextBits = m_Builder->CreateLShr(bits, 1);
+	m_Builder->CreateBr(loopBlock);
+
+	result->addIncoming(llvm::ConstantInt::get(type, 1), preheader);
+	result->addIncoming(nextResult, bodyBlock);
+	power->addIncoming(base, preheader);
+	power->addIncoming(nextPower, bodyBlock);
+	bits->addIncoming(exponent, preheader);
+	bits->addIncoming(nextBits, bodyBlock);
+
+	function->getBasicBlockList().push_back(exitBlock);
+	m_Builder->SetInsertPoint(exitBlock);
+	return result;
+}
 
-		const Block* node = dynamic_cast<const Block*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		for (const auto& subnode: node->GetStatements()) {
-			this->generate(subnode);
-		}
+/* The value of a constant power of two, else nullptr. */
+static const llvm::APInt* powerOf2(const llvm::Value* value) {
+	const llvm::ConstantInt* constant = llvm::dyn_cast<llvm::ConstantInt>(value);
+	return constant != nullptr && constant->getValue().isPowerOf2() ? &constant->getValue() : nullptr;
+}
 
-		if (beginBlock) {
-			popBlock();
-		}
-		return nullptr;
+/* The integer type a generated value has: its LLVM width, signed as the type system says. Bools are unsigned. */
+static IntegerType integerTypeOf(const Expression* expr, const llvm::Value* value) {
+	unsigned bits = value->getType()->getIntegerBitWidth();
+	return {static_cast<uint16_t>(bits), bits > 1 && expr->GetIntType().isSigned};
+}
+
+llvm::Value* CodeGenerator::visitSourceUnit(SourceUnit* node, bool beginBlock, bool isleftval) {
+	for (const auto& subnode: node->getSubNodes()) {
+		this->generate(subnode);
 	}
-	case ElementASTTypes::FunctionDefinition: {
-		const FunctionDefinition* node = dynamic_cast<const FunctionDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
+	return nullptr;
+}
 
-		// Check if the function has been defined
-		llvm::Function* func = m_Module->getFunction(node->GetName());
-		if (func != nullptr)
-			return nullptr;
+llvm::Value* CodeGenerator::visitPlainVariableDefinition(PlainVariableDefinition* node, bool beginBlock, bool isleftval) {
+	Token type = node->GetDeclarationType()->GetType();
+	llvm::Type* llvmType = getLLVMType(node->GetDeclarationType());
+	llvm::Value* res = m_Builder->CreateAlloca(llvmType, nullptr);
+	setSymbol(node, res, llvmType);
+
+	auto& expr = node->getVarDefExpr();
+	if (expr != nullptr) {
+		/* Temporary nodes, only referenced during this call. */
+		Identifier target(node->GetName());
+		target.SetSlot(node->GetSlot());
+		Assignment init(&target, Token::Assign, expr);
+		res = generate(&init);
+	} else {
+		// initialize the variable
+		llvm::Value* value = getInitValue(type, node->GetDeclarationType()->GetBits());
+		if (value != nullptr)
+			m_Builder->CreateStore(value, res);
+	}
 
-		// Create the function
-		std::vector<llvm::Type*> argTypes;
-		const auto& paralist = node->GetParameterList();
-		const auto& argsvt
-			= (paralist != nullptr) ? paralist->GetArgs() : std::vector<std::shared_ptr<VariableDefinition>>{};
-		for (const auto& arg: argsvt) {
-			if (arg->GetASTType() == ElementASTTypes::PlainVariableDefinition)
-				argTypes.push_back(getLLVMType(arg->GetDeclarationType()->GetType()));
-			// else if (arg->GetASTType() == ElementASTTypes::ArrayDefinition)
-			// 	argTypes.push_back(getLLVMType(arg->GetDeclarationType()->GetType())->getPointerTo());
-		}
-		llvm::FunctionType* funcType
-			= llvm::FunctionType::get(getLLVMType(node->GetDeclarationType()->GetType()), argTypes, false);
-		func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, node->GetName(), m_Module.get());
-		// Set names for all arguments
-		unsigned idx = 0;
-		for (auto& arg: func->args()) {
-			arg.setName(argsvt[idx++]->GetName());
-		}
+	return res;
+}
 
-		if (func == nullptr)
-			return nullptr;
+llvm::Value* CodeGenerator::visitArrayDefinition(ArrayDefinition* node, bool beginBlock, bool isleftval) {
+	llvm::Type* arrType = getLLVMType(node->GetDeclarationType());
+	llvm::Value* arrSize = generate(node->GetArraySize());
+	llvm::Value* res = m_Builder->CreateAlloca(arrType, arrSize);
+	setSymbol(node, res, arrType);
+	return res;
+}
+
+llvm::Value* CodeGenerator::visitStructDefinition(StructDefinition* node, bool beginBlock, bool isleftval) {
+	llvm::Value* res;
+	std::string_view structName = node->GetStructName();
+	if (node->GetisVariable()) {
+		/* A struct variable declaration. */
+		std::shared_ptr<MyStructType> myStruct = this->getStructType(structName);
+		ASSERT(myStruct != nullptr, "Invalid struct variable declaration!");
+		res = m_Builder->CreateAlloca(myStruct->GetStructType(), nullptr);
+		setSymbol(node, res, myStruct->GetStructType());
+		if (node->GetInitExpr() != nullptr) {
+			Identifier target(node->GetName());
+			target.SetSlot(node->GetSlot());
+			Assignment init(&target, Token::Assign, node->GetInitExpr());
+			res = generate(&init);
+		}
+	} else {
+		/* Struct type definition. */
+		std::shared_ptr<MyStructType> myStruct = std::make_shared<MyStructType>();
+		std::vector<llvm::Type*> stMems;
+		const auto& MemList = node->GetStructMemList();
+		llvm::Value* val;
+		for (const auto& mem: MemList) {
+			stMems.push_back(getLLVMType(mem->GetDeclarationType()));
+			myStruct->AddElementName(std::string(mem->GetName()));
+		}
+		myStruct->GetStructType() = llvm::StructType::create(*m_Context);
+		myStruct->GetStructType()->setBody(stMems);
+		myStruct->GetStructType()->setName(structName);
+		m_BlockStack.back().structdefs.push_back(std::move(myStruct));
+		res = nullptr;
+	}
 
-		if (node->GetBody() == nullptr)
-			return func;
+	return res;
+}
 
-		// Create a new basic block to start insertion into.
-		llvm::BasicBlock* bb = llvm::BasicBlock::Create(*m_Context, "entry", func);
-		m_Builder->SetInsertPoint(bb);
+llvm::Value* CodeGenerator::visitBlock(Block* node, bool beginBlock, bool isleftval) {
+	if (beginBlock) {
 		pushBlock();
+	}
 
-		for (size_t i = 0; i < func->arg_size(); ++i) {
-			auto arg = func->getArg(static_cast<unsigned int>(i));
-			setSymbolValue(std::string(arg->getName()), arg);
-			setSymbolType(std::string(arg->getName()), arg->getType());
-			m_Builder->CreateStore(arg, generate(argsvt.at(i)));
-		}
+	for (const auto& subnode: node->GetStatements()) {
+		this->generate(subnode);
+	}
 
-		// Generate the body of the function.
-		generate(node->GetBody(), false);
-		if (func->getReturnType()->isVoidTy()) {
-			if (m_Builder->GetInsertBlock()->getTerminator() == nullptr)
-				m_Builder->CreateRetVoid();
-		}
+	if (beginBlock) {
 		popBlock();
+	}
+	return nullptr;
+}
 
-		// Validate the generated code, checking for consistency.
-		llvm::verifyFunction(*func);
+llvm::Value* CodeGenerator::visitFunctionDefinition(FunctionDefinition* node, bool beginBlock, bool isleftval) {
 
+	// Check if the function has been defined
+	llvm::Function* func = m_Module->getFunction(node->GetName());
+	if (func != nullptr)
+		return nullptr;
+
+	// Create the function
+	std::vector<llvm::Type*> argTypes;
+	const auto& paralist = node->GetParameterList();
+	const auto& argsvt
+		= (paralist != nullptr) ? paralist->GetArgs() : AstList<VariableDefinition>{};
+	for (const auto& arg: argsvt) {
+		if (arg->GetASTType() == ElementASTTypes::PlainVariableDefinition)
+			argTypes.push_back(getLLVMType(arg->GetDeclarationType()));
+		// else if (arg->GetASTType() == ElementASTTypes::ArrayDefinition)
+		// 	argTypes.push_back(getLLVMType(arg->GetDeclarationType()->GetType())->getPointerTo());
+	}
+	llvm::FunctionType* funcType
+		= llvm::FunctionType::get(getLLVMType(node->GetDeclarationType()), argTypes, false);
+	func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, node->GetName(), m_Module.get());
+	// Set names for all arguments
+	unsigned idx = 0;
+	for (auto& arg: func->args()) {
+		arg.setName(argsvt[idx++]->GetName());
+	}
+
+	if (func == nullptr)
+		return nullptr;
+
+	if (node->GetBody() == nullptr)
 		return func;
-		// Error reading body, remove function.
-		// func->eraseFromParent();
-		// return nullptr;
-	}
-	case ElementASTTypes::ReturnStatement: {
-		const ReturnStatement* node = dynamic_cast<const ReturnStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		auto expr = node->GetExpr();
-		if (expr == nullptr) {
-			return m_Builder->CreateRetVoid();
-		}
-		llvm::Value* retVal = generate(expr);
-		setReturnValue(retVal);
-		return m_Builder->CreateRet(retVal);
+
+	// Create a new basic block to start insertion into.
+	llvm::BasicBlock* bb = llvm::BasicBlock::Create(*m_Context, "entry", func);
+	m_Builder->SetInsertPoint(bb);
+	pushBlock();
+
+	for (size_t i = 0; i < func->arg_size(); ++i) {
+		auto arg = func->getArg(static_cast<unsigned int>(i));
+		m_Builder->CreateStore(arg, generate(argsvt[i]));
 	}
-	case ElementASTTypes::Identifier: {
-		std::string name = dynamic_cast<const Identifier*>(AstNode.get())->GetValue();
-		llvm::Value* value = getSymbolValue(name);
-		llvm::Type* type = getSymbolType(name);
-		if (value == nullptr) {
-			return nullptr;
-		}
-		return m_Builder->CreateLoad(type, value);
+
+	// Generate the body of the function.
+	generate(node->GetBody(), false);
+	if (func->getReturnType()->isVoidTy()) {
+		if (m_Builder->GetInsertBlock()->getTerminator() == nullptr)
+			m_Builder->CreateRetVoid();
 	}
-	case ElementASTTypes::BooleanLiteral: {
-		std::string valueString = dynamic_cast<const BooleanLiteral*>(AstNode.get())->GetValue();
-		bool value = valueString == "true" ? true : false;
-		return llvm::ConstantInt::get(m_Builder->getInt1Ty(), value);
+	popBlock();
+
+	// Validate the generated code, checking for consistency.
+	llvm::verifyFunction(*func);
+
+	return func;
+	// Error reading body, remove function.
+	// func->eraseFromParent();
+	// return nullptr;
+}
+
+llvm::Value* CodeGenerator::visitReturnStatement(ReturnStatement* node, bool beginBlock, bool isleftval) {
+	auto expr = node->GetExpr();
+	if (expr == nullptr) {
+		return m_Builder->CreateRetVoid();
 	}
-	case ElementASTTypes::StringLiteral: {
-		std::string valueString = dynamic_cast<const StringLiteral*>(AstNode.get())->GetValue();
-		valueString = valueString.substr(1, valueString.size() - 2); // remove ""
-		size_t stridx;
+	llvm::Value* retVal = generate(expr);
+	retVal = convertInteger(
+		retVal, m_Builder->GetInsertBlock()->getParent()->getReturnType(), expr->GetIntType().isSigned);
+	setReturnValue(retVal);
+	return m_Builder->CreateRet(retVal);
+}
 
-		// escape character
-		while ((stridx = valueString.find("\\n")) != std::string::npos) {
-			valueString.replace(stridx, 2, "\n");
-		}
-		while ((stridx = valueString.find("\\r")) != std::string::npos) {
-			valueString.replace(stridx, 2, "\r");
-		}
-		while ((stridx = valueString.find("\\t")) != std::string::npos) {
-			valueString.replace(stridx, 2, "\t");
-		}
+llvm::Value* CodeGenerator::visitIdentifier(Identifier* node, bool beginBlock, bool isleftval) {
+	llvm::Value* value = getSymbolValue(node);
+	llvm::Type* type = getSymbolType(node);
+	if (value == nullptr) {
+		return nullptr;
+	}
+	return m_Builder->CreateLoad(type, value);
+}
 
-		auto res = m_Builder->CreateGlobalStringPtr(llvm::StringRef(valueString));
-		return res;
-	}
-	case ElementASTTypes::NumberLiteral: {
-		/// TODO: check its type
-		std::string valueString = dynamic_cast<const NumberLiteral*>(AstNode.get())->GetValue();
-		llvm::Constant* res;
-		try {
-			if (valueString.find('.') != std::string::npos) {
-				/* double */
-				double value = std::stod(valueString);
-				res = llvm::ConstantFP::get(m_Builder->getDoubleTy(), value);
-			} else {
-				/* integer */
-				uint32_t value = static_cast<uint32_t>(std::stoi(valueString));
-				res = m_Builder->getInt32(value);
+llvm::Value* CodeGenerator::visitBooleanLiteral(BooleanLiteral* node, bool beginBlock, bool isleftval) {
+	std::string_view valueString = node->GetValue();
+	bool value = valueString == "true" ? true : false;
+	return llvm::ConstantInt::get(m_Builder->getInt1Ty(), value);
+}
+
+llvm::Value* CodeGenerator::visitStringLiteral(StringLiteral* node, bool beginBlock, bool isleftval) {
+	std::string valueString(node->GetValue());
+	valueString = valueString.substr(1, valueString.size() - 2); // remove ""
+	size_t stridx;
+
+	// escape character
+	while ((stridx = valueString.find("\\n")) != std::string::npos) {
+		valueString.replace(stridx, 2, "\n");
+	}
+	while ((stridx = valueString.find("\\r")) != std::string::npos) {
+		valueString.replace(stridx, 2, "\r");
+	}
+	while ((stridx = valueString.find("\\t")) != std::string::npos) {
+		valueString.replace(stridx, 2, "\t");
+	}
+
+	auto res = m_Builder->CreateGlobalStringPtr(llvm::StringRef(valueString));
+	return res;
+}
+
+llvm::Value* CodeGenerator::visitNumberLiteral(NumberLiteral* node, bool beginBlock, bool isleftval) {
+	/// TODO: check its type
+	std::string valueString(node->GetValue());
+	llvm::Constant* res;
+	try {
+		if (valueString.find('.') != std::string::npos) {
+			/* double */
+			double value = std::stod(valueString);
+			res = llvm::ConstantFP::get(m_Builder->getDoubleTy(), value);
+		} else {
+			/* integer, as wide as the type system made it */
+			uint16_t bits = node->GetIntType().bits;
+			std::optional<llvm::APInt> value = parseIntegerLiteral(valueString, bits);
+			if (!value.has_value()) {
+				LOG_ERROR("Number literal %s does not fit in %u bits.", valueString.c_str(), bits);
+				value = llvm::APInt(bits, 0);
 			}
-		} catch (std::exception& e) {
-			LOG_ERROR("Number Literial fails, %s", e.what());
+			res = m_Builder->getInt(*value);
 		}
+	} catch (std::exception& e) {
+		LOG_ERROR("Number Literial fails, %s", e.what());
+	}
 
-		return res;
+	return res;
+}
+
+llvm::Value* CodeGenerator::visitAssignment(Assignment* node, bool beginBlock, bool isleftval) {
+	llvm::Value *leftHandValue, *rightHandValue;
+	llvm::Type* leftHandType = nullptr; // of the stored value, for integer conversion
+	switch (node->GetLeftHand()->GetASTType()) {
+	case ElementASTTypes::Identifier: {
+		const Identifier* leftHand = astCast<Identifier>(node->GetLeftHand());
+		ASSERT(leftHand != nullptr, "Invalid assignment target.");
+		leftHandValue = getSymbolValue(leftHand);
+		leftHandType = getSymbolType(leftHand);
+		rightHandValue = generate(node->GetRightHand());
+		break;
 	}
-	case ElementASTTypes::Assignment: {
-		const Assignment* node = dynamic_cast<const Assignment*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Value *leftHandValue, *rightHandValue;
-		switch (node->GetLeftHand()->GetASTType()) {
-		case ElementASTTypes::Identifier: {
-			const Identifier* leftHand = dynamic_cast<const Identifier*>(node->GetLeftHand().get());
-			ASSERT(leftHand != nullptr, "dynamic cast fails.");
-			leftHandValue = getSymbolValue(leftHand->GetValue());
-			rightHandValue = generate(node->GetRightHand());
-			break;
-		}
-		case ElementASTTypes::IndexAccess:
-			[[fallthrough]];
-		case ElementASTTypes::MemberAccess:
-			leftHandValue = generate(node->GetLeftHand(), true, true);
-			rightHandValue = generate(node->GetRightHand());
-			break;
-		case ElementASTTypes::StructDefinition: {
-			ASSERT(node->GetRightHand()->GetASTType() == ElementASTTypes::StructDefinition, "Invalid struct assignment.");
-			const auto leftStruct = std::dynamic_pointer_cast<StructDefinition>(node->GetLeftHand());
-			const auto rightStruct = std::dynamic_pointer_cast<StructDefinition>(node->GetRightHand());
-			ASSERT(leftStruct != nullptr && rightStruct != nullptr, "Dynamic cast fails.");
-			ASSERT(leftStruct->GetStructName() == rightStruct->GetStructName(), "Invalid struct assignment.");
-			leftHandValue = generate(node->GetLeftHand());
-			rightHandValue = generate(node->GetRightHand());
-			break;
-		}
+	case ElementASTTypes::IndexAccess:
+		[[fallthrough]];
+	case ElementASTTypes::MemberAccess:
+		leftHandValue = generate(node->GetLeftHand(), true, true);
+		if (auto gep = llvm::dyn_cast_or_null<llvm::GetElementPtrInst>(leftHandValue))
+			leftHandType = gep->getResultElementType();
+		rightHandValue = generate(node->GetRightHand());
+		break;
+	case ElementASTTypes::StructDefinition: {
+		ASSERT(node->GetRightHand()->GetASTType() == ElementASTTypes::StructDefinition, "Invalid struct assignment.");
+		const auto leftStruct = astCast<StructDefinition>(node->GetLeftHand());
+		const auto rightStruct = astCast<StructDefinition>(node->GetRightHand());
+		ASSERT(leftStruct != nullptr && rightStruct != nullptr, "Invalid struct assignment.");
+		ASSERT(leftStruct->GetStructName() == rightStruct->GetStructName(), "Invalid struct assignment.");
+		leftHandValue = generate(node->GetLeftHand());
+		rightHandValue = generate(node->GetRightHand());
+		break;
+	}
+	default:
+		LOG_ERROR("Invalid type in assignment.");
+		return nullptr;
+	}
+
+	bool isSigned = node->GetRightHand()->GetIntType().isSigned;
+	Token assignmentOp = node->GetAssigmentOp();
+	if (assignmentOp == Token::Assign) {
+		return m_Builder->CreateStore(convertInteger(rightHandValue, leftHandType, isSigned), leftHandValue);
+	} else {
+		// LOG_WARNING("Not implemented");
+		Token binOp;
+		switch (assignmentOp) {
+		case Token::AssignBitOr:
+			binOp = Token::BitOr; break;
+		case Token::AssignBitXor:
+			binOp = Token::BitXor; break;
+		case Token::AssignBitAnd:
+			binOp = Token::BitAnd; break;
+		case Token::AssignShl:
+			binOp = Token::SHL; break;
+		case Token::AssignSar:
+			binOp = Token::SAR; break;
+		case Token::AssignShr:
+			binOp = Token::SHR; break;
+		case Token::AssignAdd:
+			binOp = Token::Add; break;
+		case Token::AssignSub:
+			binOp = Token::Sub; break;
+		case Token::AssignMul:
+			binOp = Token::Mul; break;
+		case Token::AssignDiv:
+			binOp = Token::Div; break;
+		case Token::AssignMod:
+			binOp = Token::Mod; break;
 		default:
-			LOG_ERROR("Invalid type in assignment.");
+			LOG_WARNING("Invalid assignment operation.");
 			return nullptr;
 		}
+		BinaryOp value(node->GetLeftHand(), binOp, node->GetRightHand());
+		return m_Builder->CreateStore(convertInteger(generate(&value), leftHandType, isSigned), leftHandValue);
+	}
+}
 
-		Token assignmentOp = node->GetAssigmentOp();
-		if (assignmentOp == Token::Assign) {
-			return m_Builder->CreateStore(rightHandValue, leftHandValue);
-		} else {
-			// LOG_WARNING("Not implemented");
-			Token binOp;
-			switch (assignmentOp) {
-			case Token::AssignBitOr:
-				binOp = Token::BitOr; break;
-			case Token::AssignBitXor:
-				binOp = Token::BitXor; break;
-			case Token::AssignBitAnd:
-				binOp = Token::BitAnd; break;
-			case Token::AssignShl:
-				binOp = Token::SHL; break;
-			case Token::AssignSar:
-				binOp = Token::SAR; break;
-			case Token::AssignShr:
-				binOp = Token::SHR; break;
-			case Token::AssignAdd:
-				binOp = Token::Add; break;
-			case Token::AssignSub:
-				binOp = Token::Sub; break;
-			case Token::AssignMul:
-				binOp = Token::Mul; break;
-			case Token::AssignDiv:
-				binOp = Token::Div; break;
-			case Token::AssignMod:
-				binOp = Token::Mod; break;
-			default:
-				LOG_WARNING("Invalid assignment operation.");
-				return nullptr;
-			}
-			return 	m_Builder->CreateStore(
-						generate(std::make_shared<BinaryOp>(node->GetLeftHand(), binOp, node->GetRightHand())), 
-						leftHandValue
-					);
+llvm::Value* CodeGenerator::visitBinaryOp(BinaryOp* node, bool beginBlock, bool isleftval) {
+	Token op = node->GetOp();
+	llvm::Value* leftHandValue = generate(node->GetLeftHand());
+	llvm::Value* rightHandValue = generate(node->GetRightHand());
+	llvm::Value* res;
+	if (leftHandValue->getType()->isFloatingPointTy() || rightHandValue->getType()->isFloatingPointTy()) {
+		/* float point */
+		switch (op) {
+		case Token::Comma:
+			res = rightHandValue;
+			break;
+		case Token::Or... Token::SHR:
+			LOG_ERROR("Invalid operator for float points!");
+			res = nullptr;
+			break;
+		case Token::Add:
+			res = m_Builder->CreateFAdd(leftHandValue, rightHandValue);
+			break;
+		case Token::Sub:
+			res = m_Builder->CreateFSub(leftHandValue, rightHandValue);
+			break;
+		case Token::Mul:
+			res = m_Builder->CreateFMul(leftHandValue, rightHandValue);
+			break;
+		case Token::Div:
+			res = m_Builder->CreateFDiv(leftHandValue, rightHandValue);
+			break;
+		case Token::Mod:
+			res = m_Builder->CreateFRem(leftHandValue, rightHandValue);
+			break;		 // ?
+		case Token::Exp: // TODO
+			LOG_WARNING("Not implemented!");
+			res = nullptr;
+			break;
+		case Token::Equal:
+			res = m_Builder->CreateFCmpUEQ(leftHandValue, rightHandValue);
+			break;
+		case Token::NotEqual:
+			res = m_Builder->CreateFCmpUNE(leftHandValue, rightHandValue);
+			break;
+		case Token::LessThan:
+			res = m_Builder->CreateFCmpULT(leftHandValue, rightHandValue);
+			break;
+		case Token::LessThanOrEqual:
+			res = m_Builder->CreateFCmpULE(leftHandValue, rightHandValue);
+			break;
+		case Token::GreaterThan:
+			res = m_Builder->CreateFCmpUGT(leftHandValue, rightHandValue);
+			break;
+		case Token::GreaterThanOrEqual:
+			res = m_Builder->CreateFCmpUGE(leftHandValue, rightHandValue);
+			break;
+		default:
+			res = nullptr;
 		}
-	}
-	case ElementASTTypes::BinaryOp: {
-		const BinaryOp* node = dynamic_cast<const BinaryOp*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Token op = node->GetOp();
-		llvm::Value* leftHandValue = generate(node->GetLeftHand());
-		llvm::Value* rightHandValue = generate(node->GetRightHand());
-		llvm::Value* res;
-		if (leftHandValue->getType()->isFloatingPointTy() || rightHandValue->getType()->isFloatingPointTy()) {
-			/* float point */
-			switch (op) {
-			case Token::Comma:
-				res = rightHandValue;
-				break;
-			case Token::Or... Token::SHR:
-				LOG_ERROR("Invalid operator for float points!");
-				res = nullptr;
-				break;
-			case Token::Add:
-				res = m_Builder->CreateFAdd(leftHandValue, rightHandValue);
-				break;
-			case Token::Sub:
-				res = m_Builder->CreateFSub(leftHandValue, rightHandValue);
-				break;
-			case Token::Mul:
-				res = m_Builder->CreateFMul(leftHandValue, rightHandValue);
-				break;
-			case Token::Div:
-				res = m_Builder->CreateFDiv(leftHandValue, rightHandValue);
-				break;
-			case Token::Mod:
-				res = m_Builder->CreateFRem(leftHandValue, rightHandValue);
-				break;		 // ?
-			case Token::Exp: // TODO
-				LOG_WARNING("Not implemented!");
-				res = nullptr;
-				break;
-			case Token::Equal:
-				res = m_Builder->CreateFCmpUEQ(leftHandValue, rightHandValue);
-				break;
-			case Token::NotEqual:
-				res = m_Builder->CreateFCmpUNE(leftHandValue, rightHandValue);
-				break;
-			case Token::LessThan:
-				res = m_Builder->CreateFCmpULT(leftHandValue, rightHandValue);
-				break;
-			case Token::LessThanOrEqual:
-				res = m_Builder->CreateFCmpULE(leftHandValue, rightHandValue);
-				break;
-			case Token::GreaterThan:
-				res = m_Builder->CreateFCmpUGT(leftHandValue, rightHandValue);
-				break;
-			case Token::GreaterThanOrEqual:
-				res = m_Builder->CreateFCmpUGE(leftHandValue, rightHandValue);
-				break;
-			default:
-				res = nullptr;
+	} else {
+		/* integer: operands meet at the common type, shift amounts at the type of the shifted value;
+		   an exponent keeps its own */
+		bool isSigned = false;
+		if (leftHandValue->getType()->isIntegerTy() && rightHandValue->getType()->isIntegerTy()) {
+			IntegerType leftType = integerTypeOf(node->GetLeftHand(), leftHandValue);
+			IntegerType rightType = integerTypeOf(node->GetRightHand(), rightHandValue);
+			if (op == Token::Exp) {
+				isSigned = leftType.isSigned;
+			} else if (isShiftOp(op)) {
+				isSigned = leftType.isSigned;
+				rightHandValue = convertInteger(rightHandValue, leftHandValue->getType(), false);
+			} else if (op != Token::Comma && op != Token::Or && op != Token::And) {
+				IntegerType common = commonIntegerType(leftType, rightType);
+				llvm::Type* commonType = m_Builder->getIntNTy(common.bits);
+				isSigned = common.isSigned;
+				leftHandValue = convertInteger(leftHandValue, commonType, leftType.isSigned);
+				rightHandValue = convertInteger(rightHandValue, commonType, rightType.isSigned);
 			}
-		} else {
-			/* integer */
-			switch (op) {
-			case Token::Comma:
-				res = rightHandValue;
-				break;
-			case Token::Or: // 考虑短路
-				res = m_Builder->CreateLogicalOr(leftHandValue, rightHandValue);
-				break;
-			case Token::And:
-				res = m_Builder->CreateLogicalAnd(leftHandValue, rightHandValue);
-				break;
-			case Token::BitOr:
-				res = m_Builder->CreateOr(leftHandValue, rightHandValue);
-				break;
-			case Token::BitXor:
-				res = m_Builder->CreateXor(leftHandValue, rightHandValue);
-				break;
-			case Token::BitAnd:
-				res = m_Builder->CreateAnd(leftHandValue, rightHandValue);
-				break;
-			case Token::SHL:
-				res = m_Builder->CreateShl(leftHandValue, rightHandValue);
-				break;
-			case Token::SAR:
-				res = m_Builder->CreateAShr(leftHandValue, rightHandValue);
-				break;
-			case Token::SHR:
-				res = m_Builder->CreateLShr(leftHandValue, rightHandValue);
-				break;
-			case Token::Add:
-				res = m_Builder->CreateAdd(leftHandValue, rightHandValue);
-				break;
-			case Token::Sub:
-				res = m_Builder->CreateSub(leftHandValue, rightHandValue);
-				break;
-			case Token::Mul:
-				res = m_Builder->CreateMul(leftHandValue, rightHandValue);
-				break;
-			case Token::Div:
-				res = m_Builder->CreateUDiv(leftHandValue, rightHandValue);
-				break;
-			case Token::Mod:
-				res = m_Builder->CreateURem(leftHandValue, rightHandValue);
-				break;
-			case Token::Exp: // TODO
-				LOG_WARNING("Not implemented!");
+		}
+		switch (op) {
+		case Token::Comma:
+			res = rightHandValue;
+			break;
+		case Token::Or: // 考虑短路
+			res = m_Builder->CreateLogicalOr(leftHandValue, rightHandValue);
+			break;
+		case Token::And:
+			res = m_Builder->CreateLogicalAnd(leftHandValue, rightHandValue);
+			break;
+		case Token::BitOr:
+			res = m_Builder->CreateOr(leftHandValue, rightHandValue);
+			break;
+		case Token::BitXor:
+			res = m_Builder->CreateXor(leftHandValue, rightHandValue);
+			break;
+		case Token::BitAnd:
+			res = m_Builder->CreateAnd(leftHandValue, rightHandValue);
+			break;
+		case Token::SHL:
+			res = m_Builder->CreateShl(leftHandValue, rightHandValue);
+			break;
+		case Token::SAR:
+			res = isSigned ? m_Builder->CreateAShr(leftHandValue, rightHandValue)
+						   : m_Builder->CreateLShr(leftHandValue, rightHandValue);
+			break;
+		case Token::SHR:
+			res = m_Builder->CreateLShr(leftHandValue, rightHandValue);
+			break;
+		case Token::Add:
+			res = m_Builder->CreateAdd(leftHandValue, rightHandValue);
+			break;
+		case Token::Sub:
+			res = m_Builder->CreateSub(leftHandValue, rightHandValue);
+			break;
+		case Token::Mul:
+			res = m_Builder->CreateMul(leftHandValue, rightHandValue);
+			break;
+		/* LLVM 14 has no lowering for division wider than 128 bits, so the runtime does it, unless
+		   it is an unsigned one by a power of two. */
+		case Token::Div: {
+			const llvm::APInt* power = isSigned ? nullptr : powerOf2(rightHandValue);
+			if (!leftHandValue->getType()->isIntegerTy(256))
+				res = isSigned ? m_Builder->CreateSDiv(leftHandValue, rightHandValue)
+							   : m_Builder->CreateUDiv(leftHandValue, rightHandValue);
+			else if (power != nullptr)
+				res = m_Builder->CreateLShr(leftHandValue, power->logBase2());
+			else
+				res = callU256Kernel(
+					isSigned ? "minisolc_i256_div" : "minisolc_u256_div", leftHandValue, rightHandValue);
+			break;
+		}
+		case Token::Mod: {
+			const llvm::APInt* power = isSigned ? nullptr : powerOf2(rightHandValue);
+			if (!leftHandValue->getType()->isIntegerTy(256))
+				res = isSigned ? m_Builder->CreateSRem(leftHandValue, rightHandValue)
+							   : m_Builder->CreateURem(leftHandValue, rightHandValue);
+			else if (power != nullptr)
+				res = m_Builder->CreateAnd(leftHandValue, *power - 1);
+			else
+				res = callU256Kernel(
+					isSigned ? "minisolc_i256_mod" : "minisolc_u256_mod", leftHandValue, rightHandValue);
+			break;
+		}
+		case Token::Exp: {
+			if (!leftHandValue->getType()->isIntegerTy() || !rightHandValue->getType()->isIntegerTy()) {
 				res = nullptr;
 				break;
-			case Token::Equal:
-				res = m_Builder->CreateICmpEQ(leftHandValue, rightHandValue);
-				break;
-			case Token::NotEqual:
-				res = m_Builder->CreateICmpNE(leftHandValue, rightHandValue);
-				break;
-			case Token::LessThan:
-				res = m_Builder->CreateICmpULT(leftHandValue, rightHandValue);
-				break;
-			case Token::LessThanOrEqual:
-				res = m_Builder->CreateICmpULE(leftHandValue, rightHandValue);
-				break;
-			case Token::GreaterThan:
-				res = m_Builder->CreateICmpUGT(leftHandValue, rightHandValue);
-				break;
-			case Token::GreaterThanOrEqual:
-				res = m_Builder->CreateICmpUGE(leftHandValue, rightHandValue);
-				break;
-			default:
-				res = nullptr;
 			}
-		} // if
-		if (res == nullptr) {
-			LOG_WARNING("Arithmetic operation fails! Code = %d", static_cast<int>(op));
+			/* A uint256 or int256 base is raised by the runtime, narrower ones by an inline loop. */
+			if (leftHandValue->getType()->isIntegerTy(256))
+				res = callU256Kernel("minisolc_u256_exp", leftHandValue,
+					convertInteger(rightHandValue, leftHandValue->getType(), false));
+			else
+				res = emitPower(leftHandValue, rightHandValue);
+			break;
 		}
-
-		return res;
+		case Token::Equal:
+			res = m_Builder->CreateICmpEQ(leftHandValue, rightHandValue);
+			break;
+		case Token::NotEqual:
+			res = m_Builder->CreateICmpNE(leftHandValue, rightHandValue);
+			break;
+		case Token::LessThan:
+			res = isSigned ? m_Builder->CreateICmpSLT(leftHandValue, rightHandValue)
+						   : m_Builder->CreateICmpULT(leftHandValue, rightHandValue);
+			break;
+		case Token::LessThanOrEqual:
+			res = isSigned ? m_Builder->CreateICmpSLE(leftHandValue, rightHandValue)
+						   : m_Builder->CreateICmpULE(leftHandValue, rightHandValue);
+			break;
+		case Token::GreaterThan:
+			res = isSigned ? m_Builder->CreateICmpSGT(leftHandValue, rightHandValue)
+						   : m_Builder->CreateICmpUGT(leftHandValue, rightHandValue);
+			break;
+		case Token::GreaterThanOrEqual:
+			res = isSigned ? m_Builder->CreateICmpSGE(leftHandValue, rightHandValue)
+						   : m_Builder->CreateICmpUGE(leftHandValue, rightHandValue);
+			break;
+		default:
+			res = nullptr;
+		}
+	} // if
+	if (res == nullptr) {
+		LOG_WARNING("Arithmetic operation fails! Code = %d", static_cast<int>(op));
 	}
-	case ElementASTTypes::UnaryOp: {
-		const UnaryOp* node = dynamic_cast<const UnaryOp*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Token op = node->GetOp();
-		llvm::Value* value = generate(node->GetExpr());
-		bool is_prefix = node->IsPrefix();
-		llvm::Value* res;
 
-		if (value->getType()->isFloatingPointTy()) {
-			switch (op) {
-			case Token::Sub:
-				res = m_Builder->CreateFNeg(value);
-				break;
-			case Token::Not:
-				res = m_Builder->CreateNot(value);
-				break;
-			case Token::BitNot:
-				res = m_Builder->CreateNot(value);
-				break; // ?
-			case Token::Inc: {
-				const Identifier* id = dynamic_cast<const Identifier*>(node->GetExpr().get());
-				ASSERT(id != nullptr, "dynamic cast fails.");
-				llvm::Value* temp = m_Builder->CreateFAdd(value, llvm::ConstantFP::get(m_Builder->getDoubleTy(), 1.0));
-				m_Builder->CreateStore(temp, getSymbolValue(id->GetValue()));
-				res = is_prefix ? temp : value;
-				break;
-			}
-			case Token::Dec: {
-				const Identifier* id = dynamic_cast<const Identifier*>(node->GetExpr().get());
-				ASSERT(id != nullptr, "dynamic cast fails.");
-				llvm::Value* temp = m_Builder->CreateFSub(value, llvm::ConstantFP::get(m_Builder->getDoubleTy(), 1.0));
-				m_Builder->CreateStore(temp, getSymbolValue(id->GetValue()));
-				res = is_prefix ? temp : value;
-				break;
-			}
-			default:
-				res = nullptr;
-			}
+	return res;
+}
 
-		} else {
-			switch (op) {
-			case Token::Sub:
-				res = m_Builder->CreateNeg(value);
-				break;
-			case Token::Not:
-				res = m_Builder->CreateNot(value);
-				break;
-			case Token::BitNot:
-				res = m_Builder->CreateNot(value);
-				break;
-			case Token::Inc: {
-				const Identifier* id = dynamic_cast<const Identifier*>(node->GetExpr().get());
-				ASSERT(id != nullptr, "dynamic cast fails.");
-				llvm::Value* temp = m_Builder->CreateAdd(value, m_Builder->getInt32(1));
-				m_Builder->CreateStore(temp, getSymbolValue(id->GetValue()));
-				res = is_prefix ? temp : value;
-				break;
-			}
-			case Token::Dec: {
-				const Identifier* id = dynamic_cast<const Identifier*>(node->GetExpr().get());
-				ASSERT(id != nullptr, "dynamic cast fails.");
-				llvm::Value* temp = m_Builder->CreateSub(value, m_Builder->getInt32(1));
-				m_Builder->CreateStore(temp, getSymbolValue(id->GetValue()));
-				res = is_prefix ? temp : value;
-				break;
-			}
-			default:
-				res = nullptr;
-			}
-		} // if
-		if (res == nullptr) {
-			LOG_WARNING("Arithmetic operation fails! Code = %d", static_cast<int>(op));
+llvm::Value* CodeGenerator::visitUnaryOp(UnaryOp* node, bool beginBlock, bool isleftval) {
+	Token op = node->GetOp();
+	llvm::Value* value = generate(node->GetExpr());
+	bool is_prefix = node->IsPrefix();
+	llvm::Value* res;
+
+	if (value->getType()->isFloatingPointTy()) {
+		switch (op) {
+		case Token::Sub:
+			res = m_Builder->CreateFNeg(value);
+			break;
+		case Token::Not:
+			res = m_Builder->CreateNot(value);
+			break;
+		case Token::BitNot:
+			res = m_Builder->CreateNot(value);
+			break; // ?
+		case Token::Inc: {
+			const Identifier* id = astCast<Identifier>(node->GetExpr());
+			ASSERT(id != nullptr, "Operand of ++/-- must be an identifier.");
+			llvm::Value* temp = m_Builder->CreateFAdd(value, llvm::ConstantFP::get(m_Builder->getDoubleTy(), 1.0));
+			m_Builder->CreateStore(temp, getSymbolValue(id));
+			res = is_prefix ? temp : value;
+			break;
 		}
-		return res;
-	}
-	case ElementASTTypes::IfStatement: {
-		const IfStatement* node = dynamic_cast<const IfStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Value* condition = generate(node->GetCondition());
-		llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
-		llvm::BasicBlock* thenBlock = llvm::BasicBlock::Create(*m_Context);
-		llvm::BasicBlock* elseBlock = llvm::BasicBlock::Create(*m_Context);
-		llvm::BasicBlock* mergeBlock = llvm::BasicBlock::Create(*m_Context);
-		if (node->GetThenStatement() == nullptr) {
-			thenBlock = mergeBlock;
+		case Token::Dec: {
+			const Identifier* id = astCast<Identifier>(node->GetExpr());
+			ASSERT(id != nullptr, "Operand of ++/-- must be an identifier.");
+			llvm::Value* temp = m_Builder->CreateFSub(value, llvm::ConstantFP::get(m_Builder->getDoubleTy(), 1.0));
+			m_Builder->CreateStore(temp, getSymbolValue(id));
+			res = is_prefix ? temp : value;
+			break;
 		}
-		if (node->GetElseStatement() == nullptr) {
-			elseBlock = mergeBlock;
+		default:
+			res = nullptr;
 		}
-		if (thenBlock == elseBlock) {
-			return nullptr;
+
+	} else {
+		switch (op) {
+		case Token::Sub:
+			res = m_Builder->CreateNeg(value);
+			break;
+		case Token::Not:
+			res = m_Builder->CreateNot(value);
+			break;
+		case Token::BitNot:
+			res = m_Builder->CreateNot(value);
+			break;
+		case Token::Inc: {
+			const Identifier* id = astCast<Identifier>(node->GetExpr());
+			ASSERT(id != nullptr, "Operand of ++/-- must be an identifier.");
+			llvm::Value* temp = m_Builder->CreateAdd(value, llvm::ConstantInt::get(value->getType(), 1));
+			m_Builder->CreateStore(temp, getSymbolValue(id));
+			res = is_prefix ? temp : value;
+			break;
 		}
-		m_Builder->CreateCondBr(condition, thenBlock, elseBlock);
-
-		if (node->GetThenStatement() != nullptr) {
-			function->getBasicBlockList().push_back(thenBlock);
-			m_Builder->SetInsertPoint(thenBlock);
-			llvm::Value* thenValue = generate(node->GetThenStatement());
-			if ((thenBlock = m_Builder->GetInsertBlock())->getTerminator() == nullptr) {
-				m_Builder->CreateBr(mergeBlock);
-			}
+		case Token::Dec: {
+			const Identifier* id = astCast<Identifier>(node->GetExpr());
+			ASSERT(id != nullptr, "Operand of ++/-- must be an identifier.");
+			llvm::Value* temp = m_Builder->CreateSub(value, llvm::ConstantInt::get(value->getType(), 1));
+			m_Builder->CreateStore(temp, getSymbolValue(id));
+			res = is_prefix ? temp : value;
+			break;
 		}
-
-		if (node->GetElseStatement() != nullptr) {
-			function->getBasicBlockList().push_back(elseBlock);
-			m_Builder->SetInsertPoint(elseBlock);
-			llvm::Value* elseValue = generate(node->GetElseStatement());
-			if ((elseBlock = m_Builder->GetInsertBlock())->getTerminator() == nullptr) {
-				m_Builder->CreateBr(mergeBlock);
-			}
+		default:
+			res = nullptr;
 		}
+	} // if
+	if (res == nullptr) {
+		LOG_WARNING("Arithmetic operation fails! Code = %d", static_cast<int>(op));
+	}
+	return res;
+}
 
-		function->getBasicBlockList().push_back(mergeBlock);
-		m_Builder->SetInsertPoint(mergeBlock);
+llvm::Value* CodeGenerator::visitIfStatement(IfStatement* node, bool beginBlock, bool isleftval) {
+	llvm::Value* condition = generate(node->GetCondition());
+	llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* thenBlock = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* elseBlock = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* mergeBlock = llvm::BasicBlock::Create(*m_Context);
+	if (node->GetThenStatement() == nullptr) {
+		thenBlock = mergeBlock;
+	}
+	if (node->GetElseStatement() == nullptr) {
+		elseBlock = mergeBlock;
+	}
+	if (thenBlock == elseBlock) {
 		return nullptr;
 	}
-	case ElementASTTypes::WhileStatement: {
-		const WhileStatement* node = dynamic_cast<const WhileStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
-		llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
-		llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
+	m_Builder->CreateCondBr(condition, thenBlock, elseBlock);
 
-		llvm::Value* condition = generate(node->GetConditionExpr());
+	if (node->GetThenStatement() != nullptr) {
+		function->getBasicBlockList().push_back(thenBlock);
+		m_Builder->SetInsertPoint(thenBlock);
+		llvm::Value* thenValue = generate(node->GetThenStatement());
+		if ((thenBlock = m_Builder->GetInsertBlock())->getTerminator() == nullptr) {
+			m_Builder->CreateBr(mergeBlock);
+		}
+	}
 
-		// according to parser, condition won't be nullptr
-		/*
-			if (condition == nullptr) {
-				LOG_INFO("Maybe an invalid while loop condition.");
-				return nullptr;
-			}
-		*/
-		m_Builder->CreateCondBr(condition, block, after);
-		m_Builder->SetInsertPoint(block);
-		function->getBasicBlockList().push_back(block);
+	if (node->GetElseStatement() != nullptr) {
+		function->getBasicBlockList().push_back(elseBlock);
+		m_Builder->SetInsertPoint(elseBlock);
+		llvm::Value* elseValue = generate(node->GetElseStatement());
+		if ((elseBlock = m_Builder->GetInsertBlock())->getTerminator() == nullptr) {
+			m_Builder->CreateBr(mergeBlock);
+		}
+	}
 
-		pushBlock();
-		generate(node->GetWhileLoopBody());
-		popBlock();
+	function->getBasicBlockList().push_back(mergeBlock);
+	m_Builder->SetInsertPoint(mergeBlock);
+	return nullptr;
+}
 
-		condition = generate(node->GetConditionExpr());
+llvm::Value* CodeGenerator::visitWhileStatement(WhileStatement* node, bool beginBlock, bool isleftval) {
+	llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
 
-		m_Builder->CreateCondBr(condition, block, after);
+	llvm::Value* condition = generate(node->GetConditionExpr());
 
-		m_Builder->SetInsertPoint(after);
-		function->getBasicBlockList().push_back(after);
+	// according to parser, condition won't be nullptr
+	/*
+		if (condition == nullptr) {
+			LOG_INFO("Maybe an invalid while loop condition.");
+			return nullptr;
+		}
+	*/
+	m_Builder->CreateCondBr(condition, block, after);
+	m_Builder->SetInsertPoint(block);
+	function->getBasicBlockList().push_back(block);
 
-		return nullptr;
+	pushBlock();
+	generate(node->GetWhileLoopBody());
+	popBlock();
+
+	condition = generate(node->GetConditionExpr());
+
+	m_Builder->CreateCondBr(condition, block, after);
+
+	m_Builder->SetInsertPoint(after);
+	function->getBasicBlockList().push_back(after);
+
+	return nullptr;
+}
+
+llvm::Value* CodeGenerator::visitForStatement(ForStatement* node, bool beginBlock, bool isleftval) {
+	llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
+
+	if (node->GetInitExpr() != nullptr) {
+		generate(node->GetInitExpr());
 	}
-	case ElementASTTypes::ForStatement: {
-		const ForStatement* node = dynamic_cast<const ForStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
-		llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
-		llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
 
-		if (node->GetInitExpr() != nullptr) {
-			generate(node->GetInitExpr());
+	// We assume no empty condition, such as for (;;)
+	llvm::Value* condition = generate(node->GetConditionExpr());
+
+	// according to parser, condition won't be nullptr
+	/*
+		if (condition == nullptr) {
+			LOG_INFO("Maybe an invalid for loop condition.");
+			return nullptr;
 		}
+	*/
+	m_Builder->CreateCondBr(condition, block, after);
+	m_Builder->SetInsertPoint(block);
+	function->getBasicBlockList().push_back(block);
+	pushBlock();
+	generate(node->GetForLoopBody());
+	popBlock();
 
-		// We assume no empty condition, such as for (;;)
-		llvm::Value* condition = generate(node->GetConditionExpr());
+	if (node->GetUpdateExpr() != nullptr) {
+		generate(node->GetUpdateExpr());
+	}
 
-		// according to parser, condition won't be nullptr
-		/*
-			if (condition == nullptr) {
-				LOG_INFO("Maybe an invalid for loop condition.");
-				return nullptr;
-			}
-		*/
-		m_Builder->CreateCondBr(condition, block, after);
-		m_Builder->SetInsertPoint(block);
-		function->getBasicBlockList().push_back(block);
-		pushBlock();
-		generate(node->GetForLoopBody());
-		popBlock();
+	condition = generate(node->GetConditionExpr());
 
-		if (node->GetUpdateExpr() != nullptr) {
-			generate(node->GetUpdateExpr());
-		}
+	m_Builder->CreateCondBr(condition, block, after);
 
-		condition = generate(node->GetConditionExpr());
+	function->getBasicBlockList().push_back(after);
+	m_Builder->SetInsertPoint(after);
 
-		m_Builder->CreateCondBr(condition, block, after);
+	return nullptr;
+}
 
-		function->getBasicBlockList().push_back(after);
-		m_Builder->SetInsertPoint(after);
+llvm::Value* CodeGenerator::visitDoWhileStatement(DoWhileStatement* node, bool beginBlock, bool isleftval) {
+	llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
+	llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
+	llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
+	m_Builder->CreateBr(block);
+	m_Builder->SetInsertPoint(block);
+	function->getBasicBlockList().push_back(block);
+	pushBlock();
+	generate(node->GetDoWhileLoopBody());
+	popBlock();
+
+	llvm::Value* condition = generate(node->GetConditionExpr());
+	m_Builder->CreateCondBr(condition, block, after);
+	function->getBasicBlockList().push_back(after);
+	m_Builder->SetInsertPoint(after);
+	return nullptr;
+}
 
-		return nullptr;
-	}
-	case ElementASTTypes::DoWhileStatement: {
-		const DoWhileStatement* node = dynamic_cast<const DoWhileStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		llvm::Function* function = m_Builder->GetInsertBlock()->getParent();
-		llvm::BasicBlock* block = llvm::BasicBlock::Create(*m_Context);
-		llvm::BasicBlock* after = llvm::BasicBlock::Create(*m_Context);
-		m_Builder->CreateBr(block);
-		m_Builder->SetInsertPoint(block);
-		function->getBasicBlockList().push_back(block);
-		pushBlock();
-		generate(node->GetDoWhileLoopBody());
-		popBlock();
+llvm::Value* CodeGenerator::visitBreakStatement(BreakStatement* node, bool beginBlock, bool isleftval) {
+	LOG_WARNING("Not implemented");
+	return nullptr;
+}
 
-		llvm::Value* condition = generate(node->GetConditionExpr());
-		m_Builder->CreateCondBr(condition, block, after);
-		function->getBasicBlockList().push_back(after);
-		m_Builder->SetInsertPoint(after);
-		return nullptr;
-	}
-	case ElementASTTypes::BreakStatement: {
-		LOG_WARNING("Not implemented");
+llvm::Value* CodeGenerator::visitContinueStatement(ContinueStatement* node, bool beginBlock, bool isleftval) {
+	LOG_WARNING("Not implemented");
+	return nullptr;
+}
+
+llvm::Value* CodeGenerator::visitExpressionStatement(ExpressionStatement* node, bool beginBlock, bool isleftval) {
+	return generate(node->GetExpr());
+}
+
+llvm::Value* CodeGenerator::visitIndexAccess(IndexAccess* node, bool beginBlock, bool isleftval) {
+	const auto arrIdentifier = astCast<Identifier>(node->GetArrayName());
+	auto varptr = this->getSymbolValue(arrIdentifier);
+	llvm::Type* type = this->getSymbolType(arrIdentifier);
+	// auto arrSize = this->getArraySize(arrName);
+	llvm::Value* arrIdx = generate(node->GetArrayIndex());
+
+	auto ptr = m_Builder->CreateInBoundsGEP(type, varptr, arrIdx);
+
+	auto res = m_Builder->CreateAlignedLoad(type, ptr, llvm::MaybeAlign(4ull));
+	/*
+		When IndexAccess is a left value, for example,
+			a[1] = 10;
+		we return a pointer to a[1], allowing us to write the address.
+		When IndexAccess is a right value, for example,
+			i = a[0];
+		we return the value of a[0].
+
+		This may not be elegant, hope to improve it in the future.
+	*/
+	return isleftval ? ptr : res;
+}
+
+llvm::Value* CodeGenerator::visitFunctionCall(FunctionCall* node, bool beginBlock, bool isleftval) {
+	const std::string funcName(node->GetFunctionName());
+	llvm::Function* func = m_Module->getFunction(funcName);
+	if (func == nullptr) {
+		LOG_ERROR("Function %s not found.", funcName.c_str());
 		return nullptr;
 	}
-	case ElementASTTypes::ContinueStatement: {
-		LOG_WARNING("Not implemented");
+
+	if (func->arg_size() != node->GetArgs().size() && func->isVarArg() == false) {
+		LOG_ERROR("Function %s argument size mismatch.", funcName.c_str());
 		return nullptr;
 	}
-	case ElementASTTypes::ExpressionStatement: {
-		const ExpressionStatement* node = dynamic_cast<const ExpressionStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		return generate(node->GetExpr());
-	}
-	case ElementASTTypes::IndexAccess: {
-		IndexAccess* node = dynamic_cast<IndexAccess*>(AstNode.get());
-		const auto arrIdentifier = std::dynamic_pointer_cast<Identifier>(node->GetArrayName());
-		const std::string& arrName = arrIdentifier->GetValue();
-		auto varptr = this->getSymbolValue(arrName);
-		llvm::Type* type = this->getSymbolType(arrName);
-		// auto arrSize = this->getArraySize(arrName);
-		llvm::Value* arrIdx = generate(node->GetArrayIndex());
-
-		auto ptr = m_Builder->CreateInBoundsGEP(type, varptr, arrIdx);
-
-		auto res = m_Builder->CreateAlignedLoad(type, ptr, llvm::MaybeAlign(4ull));
-		/*
-			When IndexAccess is a left value, for example,
-				a[1] = 10;
-			we return a pointer to a[1], allowing us to write the address.
-			When IndexAccess is a right value, for example,
-				i = a[0];
-			we return the value of a[0].
-
-			This may not be elegant, hope to improve it in the future.
-		*/
-		return isleftval ? ptr : res;
-	}
-	case ElementASTTypes::FunctionCall: {
-		const FunctionCall* node = dynamic_cast<const FunctionCall*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		const std::string& funcName = node->GetFunctionName();
-		llvm::Function* func = m_Module->getFunction(funcName);
-		if (func == nullptr) {
-			LOG_ERROR("Function %s not found.", funcName.c_str());
-			return nullptr;
-		}
 
-		if (func->arg_size() != node->GetArgs().size() && func->isVarArg() == false) {
-			LOG_ERROR("Function %s argument size mismatch.", funcName.c_str());
-			return nullptr;
-		}
-
-		std::vector<llvm::Value*> args;
-		for (const auto& arg: node->GetArgs()) {
-			args.push_back(generate(arg));
-			if (args.back() == nullptr) {
-				LOG_ERROR("Function %s argument generation failed.", funcName.c_str());
-				return nullptr;
-			}
-		}
-		return m_Builder->CreateCall(func, args);
-	}
-	case ElementASTTypes::MemberAccess: {
-		const MemberAccess* node = dynamic_cast<const MemberAccess*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		const std::string& structVarName = std::dynamic_pointer_cast<Identifier>(node->GetStructVarExpr())->GetValue();
-		const std::string& memName = node->GetMember();
-		llvm::Value* val = this->getSymbolValue(structVarName);
-		ASSERT(val != nullptr, "Invalid symbol!");
-		std::shared_ptr<MyStructType> type = this->getStructSymbolType(structVarName);
-		ASSERT(type != nullptr, "Invalid struct type!");
-		unsigned memIdx = type->findIndexofName(memName);
-		if (memIdx == static_cast<unsigned>(-1)) {
-			LOG_WARNING("Cannot find member %s.", memName.c_str());
+	std::vector<llvm::Value*> args;
+	for (const auto& arg: node->GetArgs()) {
+		llvm::Value* value = generate(arg);
+		if (value == nullptr) {
+			LOG_ERROR("Function %s argument generation failed.", funcName.c_str());
 			return nullptr;
 		}
-		llvm::Type* memType = type->GetStructType()->getTypeAtIndex(memIdx);
-		llvm::Value* memIdxVal = m_Builder->getInt32(memIdx);
-		auto ptr = m_Builder->CreateInBoundsGEP(type->GetStructType(), val, {m_Builder->getInt32(0), memIdxVal});
-		// ptr = m_Builder->CreatePointerCast(ptr, memType->getPointerTo());
-		auto res = m_Builder->CreateLoad(memType, ptr);
-		return isleftval ? ptr : res;
+		bool isSigned = arg->GetIntType().isSigned;
+		if (args.size() < func->arg_size())
+			value = convertInteger(value, func->getArg(static_cast<unsigned>(args.size()))->getType(), isSigned);
+		else if (value->getType()->isIntegerTy() && value->getType()->getIntegerBitWidth() < 32)
+			value = convertInteger(value, m_Builder->getInt32Ty(), isSigned); // C promotes variadic arguments
+		args.push_back(value);
 	}
-	default:
-		// Not implemented!
+	return m_Builder->CreateCall(func, args);
+}
+
+llvm::Value* CodeGenerator::visitMemberAccess(MemberAccess* node, bool beginBlock, bool isleftval) {
+	const Identifier* structVar = astCast<Identifier>(node->GetStructVarExpr());
+	std::string_view memName = node->GetMember();
+	llvm::Value* val = this->getSymbolValue(structVar);
+	ASSERT(val != nullptr, "Invalid symbol!");
+	std::shared_ptr<MyStructType> type = this->getStructSymbolType(structVar);
+	ASSERT(type != nullptr, "Invalid struct type!");
+	unsigned memIdx = type->findIndexofName(memName);
+	if (memIdx == static_cast<unsigned>(-1)) {
+		LOG_WARNING("Cannot find member %s.", std::string(memName).c_str());
 		return nullptr;
-	} // switch
+	}
+	llvm::Type* memType = type->GetStructType()->getTypeAtIndex(memIdx);
+	llvm::Value* memIdxVal = m_Builder->getInt32(memIdx);
+	auto ptr = m_Builder->CreateInBoundsGEP(type->GetStructType(), val, {m_Builder->getInt32(0), memIdxVal});
+	// ptr = m_Builder->CreatePointerCast(ptr, memType->getPointerTo());
+	auto res = m_Builder->CreateLoad(memType, ptr);
+	return isleftval ? ptr : res;
 }
 
 void CodeGenerator::createSyscall() {
@@ -0,0 +1,179 @@
+#include "lexer/Scan.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SCAN_X86 0
+#endif
+
+using namespace minisolc;
+
+namespace {
+
+/* Scalar kernels: the fallback, and the tail of the vector kernels. */
+
+bool isSpaceByte(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+bool isIdentByte(unsigned char c) {
+	unsigned char lower = c | 0x20;
+	return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+const char* skipWhitespaceScalar(const char* p, const char* end) {
+	while (p < end && isSpaceByte(static_cast<unsigned char>(*p)))
+		++p;
+	return p;
+}
+
+const char* skipIdentifierScalar(const char* p, const char* end) {
+	while (p < end && isIdentByte(static_cast<unsigned char>(*p)))
+		++p;
+	return p;
+}
+
+const char* findCommentEndScalar(const char* p, const char* end) {
+	for (; end - p >= 2; ++p) {
+		if (p[0] == '*' && p[1] == '/')
+			return p;
+	}
+	return end;
+}
+
+#if SCAN_X86
+
+/* SSE2 is part of x86-64, so these need no runtime check. A byte x is in [lo, hi] iff
+   min(max(x, lo), hi) == x, using unsigned byte min/max. */
+
+__m128i inRange16(__m128i x, char lo, char hi) {
+	return _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(x, _mm_set1_epi8(lo)), _mm_set1_epi8(hi)), x);
+}
+
+__m128i spaceMask16(__m128i x) { return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), inRange16(x, '\t', '\r')); }
+
+__m128i identMask16(__m128i x) {
+	__m128i letters = inRange16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+	__m128i digits = inRange16(x, '0', '9');
+	return _mm_or_si128(_mm_or_si128(letters, digits), _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+}
+
+const char* skipWhitespaceSSE2(const char* p, const char* end) {
+	for (; end - p >= 16; p += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		uint32_t outside = static_cast<uint32_t>(_mm_movemask_epi8(spaceMask16(x))) ^ 0xFFFFu;
+		if (outside != 0)
+			return p + __builtin_ctz(outside);
+	}
+	return skipWhitespaceScalar(p, end);
+}
+
+const char* skipIdentifierSSE2(const char* p, const char* end) {
+	for (; end - p >= 16; p += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		uint32_t outside = static_cast<uint32_t>(_mm_movemask_epi8(identMask16(x))) ^ 0xFFFFu;
+		if (outside != 0)
+			return p + __builtin_ctz(outside);
+	}
+	return skipIdentifierScalar(p, end);
+}
+
+const char* findCommentEndSSE2(const char* p, const char* end) {
+	/* Compare the block with '*' and the block one byte later with '/'. */
+	for (; end - p >= 17; p += 16) {
+		__m128i star = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8('*'));
+		__m128i slash = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)), _mm_set1_epi8('/'));
+		uint32_t found = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(star, slash)));
+		if (found != 0)
+			return p + __builtin_ctz(found);
+	}
+	return findCommentEndScalar(p, end);
+}
+
+/* AVX2 versions of the same kernels, only called when the CPU supports them. */
+
+AVX2_TARGET __m256i inRange32(__m256i x, char lo, char hi) {
+	return _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_max_epu8(x, _mm256_set1_epi8(lo)), _mm256_set1_epi8(hi)), x);
+}
+
+AVX2_TARGET __m256i spaceMask32(__m256i x) {
+	return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), inRange32(x, '\t', '\r'));
+}
+
+AVX2_TARGET __m256i identMask32(__m256i x) {
+	__m256i letters = inRange32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+	__m256i digits = inRange32(x, '0', '9');
+	return _mm256_or_si256(_mm256_or_si256(letters, digits), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+}
+
+AVX2_TARGET const char* skipWhitespaceAVX2(const char* p, const char* end) {
+	for (; end - p >= 32; p += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		uint32_t outside = ~static_cast<uint32_t>(_mm256_movemask_epi8(spaceMask32(x)));
+		if (outside != 0)
+			return p + __builtin_ctz(outside);
+	}
+	return skipWhitespaceSSE2(p, end);
+}
+
+AVX2_TARGET const char* skipIdentifierAVX2(const char* p, const char* end) {
+	for (; end - p >= 32; p += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		uint32_t outside = ~static_cast<uint32_t>(_mm256_movemask_epi8(identMask32(x)));
+		if (outside != 0)
+			return p + __builtin_ctz(outside);
+	}
+	return skipIdentifierSSE2(p, end);
+}
+
+AVX2_TARGET const char* findCommentEndAVX2(const char* p, const char* end) {
+	for (; end - p >= 33; p += 32) {
+		__m256i star
+			= _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), _mm256_set1_epi8('*'));
+		__m256i slash
+			= _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), _mm256_set1_epi8('/'));
+		uint32_t found = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(star, slash)));
+		if (found != 0)
+			return p + __builtin_ctz(found);
+	}
+	return findCommentEndSSE2(p, end);
+}
+
+#endif // SCAN_X86
+
+using Kernel = const char* (*)(const char*, const char*);
+
+struct Kernels {
+	Kernel whitespace;
+	Kernel identifier;
+	Kernel commentEnd;
+};
+
+Kernels selectKernels() {
+#if SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return {skipWhitespaceAVX2, skipIdentifierAVX2, findCommentEndAVX2};
+	return {skipWhitespaceSSE2, skipIdentifierSSE2, findCommentEndSSE2};
+#else
+	return {skipWhitespaceScalar, skipIdentifierScalar, findCommentEndScalar};
+#endif
+}
+
+const Kernels kKernels = selectKernels();
+
+}
+
+const char* minisolc::skipWhitespace(const char* p, const char* end) { return kKernels.whitespace(p, end); }
+
+const char* minisolc::skipIdentifier(const char* p, const char* end) { return kKernels.identifier(p, end); }
+
+const char* minisolc::findByte(const char* p, const char* end, char c) {
+	/* The C library's memchr is already vectorized and dispatched by CPU. */
+	const void* found = std::memchr(p, c, static_cast<size_t>(end - p));
+	return found == nullptr ? end : static_cast<const char*>(found);
+}
+
+const char* minisolc::findCommentEnd(const char* p, const char* end) { return kKernels.commentEnd(p, end); }
@@ -1,27 +1,141 @@
 #include "lexer/Token.h"
-#include <map>
+#include "common/Hash.h"
 #include <string>
+#include <string_view>
 
 using namespace minisolc;
 
-Token minisolc::keywordByName(std::string _name) {
-#define KEYWORD(name, string, precedence) {string, Token::name},
+namespace {
+
+struct Keyword {
+	std::string_view name;
+	Token tok;
+	uint16_t bits; // width of the sized integer types, else 0
+};
+
+constexpr Keyword kKeywords[] = {
+#define KEYWORD(name, string, precedence) {string, Token::name, 0},
 #define TOKEN(name, string, precedence)
-	static std::map<std::string, Token> const keywords({TOKEN_LIST(TOKEN, KEYWORD)});
+	TOKEN_LIST(TOKEN, KEYWORD)
 #undef KEYWORD
 #undef TOKEN
-	// 需要考虑int8 | int16 | int32 | int64 | int128 | int256等特殊情况
-	// uint8 | uint16 | uint32 | uint64 | uint128 | uint256等特殊情况
-	if (_name == "int8" || _name == "int16" || _name == "int32" || _name == "int64" || _name == "int128"
-		|| _name == "int256")
-		return Token::IntM;
-	else if (
-		_name == "uint8" || _name == "uint16" || _name == "uint32" || _name == "uint64" || _name == "uint128"
-		|| _name == "uint256")
-		return Token::UIntM;
-
-	auto it = keywords.find(_name);
-	return it == keywords.end() ? Token::Identifier : it->second;
+	// int8 | int16 | int32 | int64 | int128 | int256
+	// uint8 | uint16 | uint32 | uint64 | uint128 | uint256
+	{"int8", Token::IntM, 8},
+	{"int16", Token::IntM, 16},
+	{"int32", Token::IntM, 32},
+	{"int64", Token::IntM, 64},
+	{"int128", Token::IntM, 128},
+	{"int256", Token::IntM, 256},
+	{"uint8", Token::UIntM, 8},
+	{"uint16", Token::UIntM, 16},
+	{"uint32", Token::UIntM, 32},
+	{"uint64", Token::UIntM, 64},
+	{"uint128", Token::UIntM, 128},
+	{"uint256", Token::UIntM, 256},
+};
+constexpr size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+
+/* Hash-and-displace perfect hash, built at compile time. A keyword's FNV-1a hash h selects a
+   bucket h % kBuckets; the bucket's displacement d then selects the slot mix64(h + d) % kSlots.
+   Displacements are chosen bucket by bucket, largest first, so that no two keywords share a
+   slot. A lookup is therefore one hash of the name and one comparison with the slot's entry. */
+constexpr size_t kBuckets = 64;
+constexpr size_t kSlots = 256; // a power of two
+static_assert(kKeywordCount <= kSlots / 2, "keyword table too full");
+
+struct KeywordTable {
+	uint32_t displacement[kBuckets];
+	Keyword slots[kSlots];
+};
+
+constexpr size_t slotOf(uint64_t hash, uint32_t displacement) { return mix64(hash + displacement) & (kSlots - 1); }
+
+constexpr KeywordTable buildKeywordTable() {
+	KeywordTable table {};
+	for (Keyword& slot: table.slots) {
+		slot = {std::string_view(), Token::Identifier, 0};
+	}
+	uint64_t hashes[kKeywordCount] = {};
+	size_t bucketBegin[kBuckets + 1] = {};
+	for (size_t k = 0; k < kKeywordCount; ++k) {
+		hashes[k] = fnv1a(kKeywords[k].name);
+		++bucketBegin[hashes[k] % kBuckets + 1];
+	}
+	/* Group the keywords by bucket: members[bucketBegin[b], bucketBegin[b + 1]) are bucket b's. */
+	for (size_t b = 0; b < kBuckets; ++b) {
+		bucketBegin[b + 1] += bucketBegin[b];
+	}
+	size_t members[kKeywordCount] = {};
+	size_t filled[kBuckets] = {};
+	for (size_t k = 0; k < kKeywordCount; ++k) {
+		size_t b = hashes[k] % kBuckets;
+		members[bucketBegin[b] + filled[b]++] = k;
+	}
+
+	bool placed[kBuckets] = {};
+	for (size_t round = 0; round < kBuckets; ++round) {
+		size_t bucket = kBuckets;
+		for (size_t b = 0; b < kBuckets; ++b) {
+			if (!placed[b] && (bucket == kBuckets || filled[b] > filled[bucket]))
+				bucket = b;
+		}
+		placed[bucket] = true;
+		if (filled[bucket] == 0)
+			break;
+
+		const size_t begin = bucketBegin[bucket], end = bucketBegin[bucket + 1];
+		for (uint32_t d = 0;; ++d) {
+			/* Claim slots for the bucket's keywords; on a collision release them and retry. */
+			size_t claimed = begin;
+			while (claimed < end) {
+				Keyword& slot = table.slots[slotOf(hashes[members[claimed]], d)];
+				if (!slot.name.empty())
+					break;
+				slot = kKeywords[members[claimed++]];
+			}
+			if (claimed == end) {
+				table.displacement[bucket] = d;
+				break;
+			}
+			for (size_t i = begin; i < claimed; ++i) {
+				table.slots[slotOf(hashes[members[i]], d)] = {std::string_view(), Token::Identifier, 0};
+			}
+		}
+	}
+	return table;
+}
+
+constexpr KeywordTable kKeywordTable = buildKeywordTable();
+
+constexpr const Keyword& lookupSlot(std::string_view name) {
+	uint64_t hash = fnv1a(name);
+	return kKeywordTable.slots[slotOf(hash, kKeywordTable.displacement[hash % kBuckets])];
+}
+
+constexpr Token lookupKeyword(std::string_view name) {
+	const Keyword& slot = lookupSlot(name);
+	return slot.name == name ? slot.tok : Token::Identifier;
+}
+
+constexpr bool everyKeywordFound() {
+	for (const Keyword& keyword: kKeywords) {
+		if (lookupKeyword(keyword.name) != keyword.tok)
+			return false;
+	}
+	return true;
+}
+static_assert(everyKeywordFound(), "keyword perfect hash is not collision-free");
+
+}
+
+Token minisolc::keywordByName(std::string_view _name) { return lookupKeyword(_name); }
+
+uint16_t minisolc::integerTypeBits(std::string_view _name) {
+	const Keyword& slot = lookupSlot(_name);
+	if (slot.name != _name)
+		return 0;
+	return slot.tok == Token::Int || slot.tok == Token::UInt ? 32 : slot.bits;
 }
 
 char const* minisolc::tokenToString(Token tok) {
@@ -56,7 +170,7 @@ char const* minisolc::tokenToString(Token tok) {
 }
 
 /// TODO: 需要加上Error相关的处理
-Visibility minisolc::visibilityByName(std::string _name) {
+Visibility minisolc::visibilityByName(std::string_view _name) {
 	if (_name == "external")
 		return Visibility::External;
 	else if (_name == "public")
@@ -1,6 +1,7 @@
 #include "lexer/TokenStream.h"
 #include "common/Defs.h"
 #include "lexer/Token.h"
+#include "lexer/Scan.h"
 
 
 #include <algorithm>
@@ -9,240 +10,241 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 
 using namespace minisolc;
 
-void TokenStream::tokenize() {
-	while (m_striter != m_source.cend() && !m_error) {
-		switch (*m_striter) {
-		case '=':
-			++m_striter; // advance
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::Equal, "==");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '>') {
-				addToken(Token::DoubleArrow, "=>");
-				++m_striter;
-			} else {
-				addToken(Token::Assign, "=");
-			}
-			break;
-		case '+':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignAdd, "+=");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '+') {
-				addToken(Token::Inc, "++");
-				++m_striter;
-			} else {
-				addToken(Token::Add, "+");
-			}
-			break;
-		case '-':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignSub, "-=");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '>') {
-				addToken(Token::RightArrow, "->");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '-') {
-				addToken(Token::Dec, "--");
-				++m_striter;
-			} else {
-				addToken(Token::Sub, "-");
-			}
-			break;
-		case '*':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignMul, "*=");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '*') {
-				addToken(Token::Exp, "**");
-				++m_striter;
-			} else {
-				addToken(Token::Mul, "*");
-			}
-			break;
-		case '/':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignDiv, "/=");
-				++m_striter;
-			} else if (*m_striter == '*' || *m_striter == '/') {
-				m_error = !skipAnnotation();
-			} else {
-				addToken(Token::Div, "/");
-			}
-			break;
-		case '%':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignMod, "%=");
-				++m_striter;
-			} else {
-				addToken(Token::Mod, "%");
-			}
-			break;
-		case '!':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::NotEqual, "!=");
-				++m_striter;
-			} else {
-				addToken(Token::Not, "!");
-			}
-			break;
-		case '>':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '>') {
-				if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '>') {
-					if (m_striter + 2 != m_source.cend() && *(m_striter + 2) == '=') {
-						addToken(Token::AssignSar, ">>>=");
-						m_striter += 3;
-					} else {
-						addToken(Token::SHR, ">>>");
-						m_striter += 2;
-					}
-				} else if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '=') {
-					addToken(Token::AssignShr, ">>=");
-					m_striter += 2;
-				} else {
-					addToken(Token::SAR, ">>");
-					++m_striter;
-				}
-			} else if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::GreaterThanOrEqual, ">=");
-				++m_striter;
-			} else {
-				addToken(Token::GreaterThan, ">");
-			}
-			break;
-		case '<':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '<') {
-				if (m_striter + 1 != m_source.cend() && *(m_striter + 1) == '=') {
-					addToken(Token::AssignShl, "<<=");
-					m_striter += 2;
-				} else {
-					addToken(Token::SHL, "<<");
-					++m_striter;
-				}
-			} else if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::LessThanOrEqual, "<=");
-				++m_striter;
-			} else {
-				addToken(Token::LessThan, "<");
-			}
-			break;
-		case '&':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '&') {
-				addToken(Token::And, "&&");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignBitAnd, "&=");
-				++m_striter;
-			} else {
-				addToken(Token::BitAnd, "&");
-			}
-			break;
-		case '|':
-			++m_striter;
-			if (m_striter != m_source.cend() && *m_striter == '|') {
-				addToken(Token::Or, "||");
-				++m_striter;
-			} else if (m_striter != m_source.cend() && *m_striter == '=') {
-				addToken(Token::AssignBitOr, "|=");
-				++m_striter;
-			} else {
-				addToken(Token::BitOr, "|");
-			}
-			break;
-		case '~':
-			++m_striter;
-			addToken(Token::BitNot, "~");
-			break;
-		case '?':
-			++m_striter;
-			addToken(Token::Conditional, "?");
-			break;
-		case ':':
-			++m_striter;
-			addToken(Token::Colon, ":");
-			break;
-		case '(':
-			++m_striter;
-			addToken(Token::LParen, "(");
-			break;
-		case ')':
-			++m_striter;
-			addToken(Token::RParen, ")");
-			break;
-		case '[':
-			++m_striter;
-			addToken(Token::LBrack, "[");
-			break;
-		case ']':
-			++m_striter;
-			addToken(Token::RBrack, "]");
-			break;
-		case '{':
-			++m_striter;
-			addToken(Token::LBrace, "{");
-			break;
-		case '}':
+namespace {
+
+/* Operators and punctuators are recognized by a DFA generated at compile time from the
+   TOKEN_LIST entries whose text is made of punctuation only. It is the trie of those texts:
+   state 0 is dead, state 1 is the start, and accept[s] is the token spelled by the path to s.
+   Every byte costs one lookup in next[state][byte]. The source buffer is always followed by a
+   NUL, which has no transition, so the loop needs no end-of-buffer checks. */
+
+struct TokenText {
+	const char* text;
+	Token tok;
+};
+
+constexpr TokenText kTokenTexts[] = {
+#define T(name, string, precedence) {string, Token::name},
+	TOKEN_LIST(T, T)
+#undef T
+};
+
+constexpr bool isPunctuatorChar(char c) {
+	for (char p: "!%&()*+,-./:;<=>?[]^{|}~") {
+		if (c == p && c != '\0')
+			return true;
+	}
+	return false;
+}
+
+constexpr bool isPunctuatorText(const char* text) {
+	if (text == nullptr || *text == '\0')
+		return false;
+	for (; *text != '\0'; ++text) {
+		if (!isPunctuatorChar(*text))
+			return false;
+	}
+	return true;
+}
+
+constexpr size_t kMaxStates = 64;
+constexpr uint8_t kDeadState = 0;
+constexpr uint8_t kStartState = 1;
+
+struct PunctuatorDFA {
+	uint8_t next[kMaxStates][256];
+	Token accept[kMaxStates];
+	size_t states;
+};
+
+constexpr PunctuatorDFA buildPunctuatorDFA() {
+	PunctuatorDFA dfa {};
+	for (Token& tok: dfa.accept) {
+		tok = Token::NUM_TOKENS;
+	}
+	dfa.states = 2;
+	for (const TokenText& entry: kTokenTexts) {
+		if (!isPunctuatorText(entry.text))
+			continue;
+		uint8_t state = kStartState;
+		for (const char* c = entry.text; *c != '\0'; ++c) {
+			uint8_t& next = dfa.next[state][static_cast<unsigned char>(*c)];
+			if (next == kDeadState)
+				next = static_cast<uint8_t>(dfa.states++);
+			state = next;
+		}
+		dfa.accept[state] = entry.tok;
+	}
+	return dfa;
+}
+
+constexpr PunctuatorDFA kPunctuators = buildPunctuatorDFA();
+static_assert(kPunctuators.states <= kMaxStates, "too many punctuator states");
+
+/* What the first byte of a token says about the token. */
+enum class CharClass : uint8_t { Invalid, Nul, Space, IdentStart, Digit, Quote, Slash, Punctuator };
+
+struct CharClassTable {
+	CharClass classes[256];
+};
+
+constexpr CharClassTable buildCharClasses() {
+	CharClassTable table {};
+	for (int c = 0; c < 256; ++c) {
+		CharClass cls = CharClass::Invalid;
+		if (c == '\0')
+			cls = CharClass::Nul;
+		else if (c == ' ' || (c >= '\t' && c <= '\r'))
+			cls = CharClass::Space;
+		else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+			cls = CharClass::IdentStart;
+		else if (c >= '0' && c <= '9')
+			cls = CharClass::Digit;
+		else if (c == '"')
+			cls = CharClass::Quote;
+		else if (c == '/')
+			cls = CharClass::Slash;
+		else if (kPunctuators.next[kStartState][c] != kDeadState)
+			cls = CharClass::Punctuator;
+		table.classes[c] = cls;
+	}
+	return table;
+}
+
+constexpr CharClassTable kCharClasses = buildCharClasses();
+
+}
+
+void TokenStream::scanToken() {
+	size_t count = m_tail;
+	while (m_tail == count) {
+		const char* p = m_striter.ptr;
+		m_tokStart = m_striter;
+		if (m_error || p == sourceEnd()) {
+			if (!m_error)
+				LOG_INFO("Tokenize Succeeds.");
+			addToken(Token::EOS, 0);
+			m_done = true;
+			return;
+		}
+		switch (kCharClasses.classes[static_cast<unsigned char>(*p)]) {
+		case CharClass::Nul:
 			++m_striter;
-			addToken(Token::RBrace, "}");
 			break;
-		case ';':
-			++m_striter;
-			addToken(Token::Semicolon, ";");
+		case CharClass::Space:
+			skipSpace();
 			break;
-		case ',':
-			++m_striter;
-			addToken(Token::Comma, ",");
+		case CharClass::IdentStart:
+			/* keyword or identifier */
+			tokenizeKeywordIdent();
 			break;
-		case '\0':
-			++m_striter;
+		case CharClass::Digit:
+			m_error = !tokenizeNumber();
 			break;
-		case '\"':
+		case CharClass::Quote:
 			m_error = !tokenizeString();
 			break;
-		case '.':
-			++m_striter;
-			addToken(Token::Period, ".");
+		case CharClass::Slash:
+			if (p[1] == '/' || p[1] == '*')
+				m_error = !skipAnnotation();
+			else
+				tokenizePunctuator();
 			break;
-		default: {
-			if (isalus(*m_striter)) {
-				/* keyword or identifier */
-				tokenizeKeywordIdent();
-			} else if (isdigit(*m_striter)) {
-				/* number */
-				m_error = !tokenizeNumber();
-			} else if (isspace(*m_striter)) {
-				/* spaces */
-				skipSpace();
-			} else {
-				LOG_WARNING("Invalid Character.");
-				m_error = true;
-			}
+		case CharClass::Punctuator:
+			tokenizePunctuator();
+			break;
+		default:
+			LOG_WARNING("Invalid Character.");
+			m_error = true;
 			break;
 		}
+	}
+}
+
+void TokenStream::tokenizePunctuator() {
+	const char* begin = m_striter.ptr;
+	const char* p = begin;
+	const char* accepted = begin;
+	Token tok = Token::Illegal;
+	uint8_t state = kStartState;
+	/* Longest match: remember the last accepting state passed through. */
+	while ((state = kPunctuators.next[state][static_cast<unsigned char>(*p)]) != kDeadState) {
+		++p;
+		if (kPunctuators.accept[state] != Token::NUM_TOKENS) {
+			tok = kPunctuators.accept[state];
+			accepted = p;
 		}
-		// LOG_INFO("find token: %s", m_tokens.back().val.c_str());
 	}
-	if (!m_error)
-		LOG_INFO("Tokenize Succeeds.");
+	if (accepted == begin) {
+		LOG_WARNING("Invalid Character.");
+		m_error = true;
+		return;
+	}
+	addToken(tok, static_cast<size_t>(accepted - begin));
+	m_striter += accepted - begin;
+}
+
+TokenStream::TokenStream(const TokenStream& whole, size_t begin, size_t end)
+	: m_source(whole.m_source), m_striter(whole.m_source.cend()), m_lazy(false), m_done(true) {
+	ASSERT(!whole.m_lazy && whole.m_head <= begin && begin <= end && end <= whole.m_tail, "Invalid token window.");
+	m_head = m_tail = m_cursor = begin;
+	while (m_capacity < end - begin)
+		grow();
+	for (size_t i = begin; i < end; ++i)
+		push(whole.at(i));
+}
+
+bool TokenStream::fill(size_t index) {
+	while (!m_done && m_tail <= index) {
+		scanToken();
+	}
+	return index < m_tail;
+}
+
+void TokenStream::grow() {
+	/* Double the capacity, keeping every token at index & mask: the buffered tokens form at
+	   most two contiguous runs of the old ring, and one run of the new. */
+	size_t capacity = m_capacity == 0 ? kInitialCapacity : m_capacity * 2;
+	std::unique_ptr<TokenInfo[]> ring(new TokenInfo[capacity]);
+	size_t mask = capacity - 1;
+	for (size_t i = m_head; i < m_tail;) {
+		size_t run = std::min(m_tail - i, m_capacity - (i & m_mask));
+		std::copy_n(m_ring.get() + (i & m_mask), run, ring.get() + (i & mask));
+		i += run;
+	}
+	m_ring = std::move(ring);
+	m_capacity = capacity;
+	m_mask = mask;
+}
+
+void TokenStream::release() {
+	if (!m_lazy)
+		return;
+	size_t keep = m_cursor;
+	for (size_t pin: m_pins) {
+		keep = std::min(keep, pin);
+	}
+	m_head = std::max(m_head, std::min(keep, m_tail));
+}
+
+void TokenStream::unpin(size_t pos) {
+	auto it = std::find(m_pins.begin(), m_pins.end(), pos);
+	ASSERT(it != m_pins.end(), "Unpinning a position that is not pinned.");
+	if (it != m_pins.end())
+		m_pins.erase(it);
+	release();
 }
 
 void TokenStream::tokenizeKeywordIdent() {
-	auto right_bound = std::find_if_not(m_striter, m_source.cend(), [](const char ch) { return isalnumus(ch); });
-	std::string val = std::string(m_striter, right_bound);
-	addToken(keywordByName(val), val);
-	m_striter = right_bound;
+	const char* begin = m_striter.ptr;
+	const char* right_bound = skipIdentifier(begin, sourceEnd());
+	std::string_view val(begin, static_cast<size_t>(right_bound - begin));
+	addToken(keywordByName(val), val.size());
+	m_striter += right_bound - begin;
 }
 
 bool TokenStream::tokenizeNumber() {
@@ -258,17 +260,22 @@ bool TokenStream::tokenizeNumber() {
 	std::string val = std::string(m_striter, right_bound);
 	if (val.size() > 1) {
 		try {
-			if (val[0] == '0') {
+			/* Integer types go up to 256 bits, so only the digits are checked here; whether the
+			   value fits its type is decided where the type is known. */
+			if (val[0] == '0' && !floatFlag) {
 				if (val[1] == 'x' || val[1] == 'X') {
 					// Hexadecimal
-					std::stoll(val, 0, 16);
+					if (val.size() == 2 || val.find_first_not_of("0123456789abcdefABCDEF", 2) != std::string::npos)
+						throw std::invalid_argument(val);
 				} else {
 					// Octal
-					std::stoll(val, 0, 8);
+					if (val.find_first_not_of("01234567") != std::string::npos)
+						throw std::invalid_argument(val);
 				}
 			} else if (!floatFlag) {
 				// Decimal
-				std::stoll(val);
+				if (val.find_first_not_of("0123456789") != std::string::npos)
+					throw std::invalid_argument(val);
 			} else {
 				// Float
 				std::stod(val);
@@ -283,35 +290,34 @@ bool TokenStream::tokenizeNumber() {
 		}
 	}
 	if (floatFlag)
-		addToken(Token::DoubleNumber, std::move(val));
+		addToken(Token::DoubleNumber, val.size());
 	else
-		addToken(Token::IntNumber, std::move(val));
+		addToken(Token::IntNumber, val.size());
 	m_striter = right_bound;
 	return res;
 }
 
 void TokenStream::skipSpace() {
-	while (m_striter != m_source.cend() && isspace(*m_striter)) {
-		++m_striter;
-	}
+	m_striter += skipWhitespace(m_striter.ptr, sourceEnd()) - m_striter.ptr;
 }
 
 bool TokenStream::skipAnnotation() {
-	CharStream::const_iterator right_pos;
-	--m_striter;
+	const char* right_pos;
+	const char* end = sourceEnd();
 	if (*m_striter == '/' && *(m_striter + 1) == '/') {
 		/* single-line annotations */
-		right_pos = m_source.find('\n', m_striter + 2);
+		right_pos = findByte(m_striter.ptr + 2, end, '\n');
 	} else if (*m_striter == '/' && *(m_striter + 1) == '*') {
 		/* multi-line annotations */
-		right_pos = m_source.find("*/", m_striter + 2);
-		right_pos += 2;
+		right_pos = findCommentEnd(m_striter.ptr + 2, end);
+		if (right_pos != end)
+			right_pos += 2;
 	} else {
 		LOG_WARNING("Parse Annotation Fails.");
 		return false;
 	}
-	if (right_pos != m_source.cend()) {
-		m_striter = right_pos;
+	if (right_pos != end) {
+		m_striter += right_pos - m_striter.ptr;
 		return true;
 	} else {
 		LOG_WARNING("Parse Annotation Fails.");
@@ -320,13 +326,12 @@ bool TokenStream::skipAnnotation() {
 }
 
 bool TokenStream::tokenizeString() {
-	auto right_quot = std::find(m_striter + 1, m_source.cend(), '\"');
-	if (right_quot == m_source.cend()) {
+	const char* right_quot = findByte(m_striter.ptr + 1, sourceEnd(), '\"');
+	if (right_quot == sourceEnd()) {
 		LOG_WARNING("Missing '\"'");
 		return false;
 	}
-	std::string&& val = std::string(m_striter, right_quot + 1);
-	addToken(Token::StringLiteral, std::move(val));
-	m_striter = right_quot + 1;
+	addToken(Token::StringLiteral, static_cast<size_t>(right_quot + 1 - m_striter.ptr));
+	m_striter += right_quot + 1 - m_striter.ptr;
 	return true;
 }
\ No newline at end of file
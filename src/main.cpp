@@ -1,9 +1,16 @@
 #include "codegen/CodeGen.h"
 #include "lexer/TokenStream.h"
+#include "parser/AstSerializer.h"
+#include "parser/FunctionCache.h"
 #include "parser/Parser.h"
 #include "preprocess/Preprocess.h"
+#include "typesystem/ConstantFolder.h"
 #include "typesystem/TypeSystem.h"
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
 
 #ifdef _WIN32
 #include "windows.h"
@@ -16,28 +23,100 @@ int main(int argc, const char* argv[]) {
 #ifdef _WIN32
 	SetConsoleOutputCP(65001);
 #endif
-	auto input = argv[1];
-	Preprocess preprocess(input);
-	preprocess.Dump();
-	cout << '\n';
-	TokenStream tokenStream(preprocess);
-	tokenStream.Dump();
-	cout << "\n\n";
-	Parser parser(tokenStream);
-	parser.parse();
-	parser.Dump();
-	TypeSystem typeSystem(parser);
+	/* The parsed AST is cached next to the .ll; --no-ast-cache always runs the front end.
+	   --incremental instead caches the analyzed AST of every function, and only parses and
+	   analyzes the functions that changed. */
+	const char* input = nullptr;
+	bool useAstCache = true;
+	bool incremental = false;
+	for (int i = 1; i < argc; ++i) {
+		if (std::string_view(argv[i]) == "--no-ast-cache")
+			useAstCache = false;
+		else if (std::string_view(argv[i]) == "--incremental")
+			incremental = true;
+		else
+			input = argv[i];
+	}
+	if (input == nullptr) {
+		cerr << "usage: " << argv[0] << " [--no-ast-cache | --incremental] <file>\n";
+		return 1;
+	}
+	useAstCache = useAstCache && !incremental;
+	std::filesystem::path astFile = std::filesystem::path(input).replace_extension(".ast");
+	std::filesystem::path functionCacheFile = std::filesystem::path(input).replace_extension(".fnc");
+	FunctionCache functionCache;
+	if (incremental)
+		functionCache.load(functionCacheFile);
+
+	AstArena cachedArena;
+	BaseAST* ast = useAstCache ? loadFreshAst(astFile, cachedArena) : nullptr;
+	std::unique_ptr<Preprocess> preprocess;
+	std::unique_ptr<TokenStream> tokenStream;
+	std::unique_ptr<Parser> parser;
+	if (ast != nullptr) {
+		LOG_INFO("Inputs unchanged, AST loaded from %s.", astFile.string().c_str());
+	} else {
+		preprocess = std::make_unique<Preprocess>(input);
+		preprocess->Dump();
+		cout << '\n';
+		tokenStream = std::make_unique<TokenStream>(*preprocess);
+		tokenStream->Dump();
+		cout << "\n\n";
+		parser = std::make_unique<Parser>(*tokenStream);
+		if (incremental) {
+			parser->setFunctionLookup(
+				[&](uint64_t hash, AstArena& arena) { return functionCache.findAst(hash, arena); });
+		}
+		ThreadPool pool;
+		parser->parse(pool);
+		parser->Dump();
+		if (parser->HasErrors())
+			return 1;
+		ast = parser->GetAst();
+		if (useAstCache) {
+			std::vector<AstInput> inputs;
+			for (const std::string& file: preprocess->includedFiles())
+				inputs.push_back({file, hashInput(file)});
+			if (!saveAst(astFile, ast, inputs))
+				LOG_WARNING("Cannot write %s.", astFile.string().c_str());
+		}
+	}
+	std::unordered_set<const FunctionDefinition*> reused;
+	if (incremental) {
+		for (const Parser::TopLevelFunction& function: parser->GetFunctions()) {
+			if (function.reused)
+				reused.insert(function.node);
+		}
+	}
+	TypeSystem typeSystem(ast, &reused);
 	typeSystem.Dump();
 	cout << '\n';
-	CodeGenerator codeGenerator(parser.GetAst());
+	ConstantFolder constantFolder(ast);
+	CodeGenerator codeGenerator(ast);
 	codeGenerator.Dump();
 	codeGenerator.srctollFile(input);
 
+	if (incremental) {
+		FunctionCache next;
+		for (const Parser::TopLevelFunction& function: parser->GetFunctions()) {
+			if (function.reused)
+				next.put(function.hash, *functionCache.find(function.hash));
+			else if (function.node != nullptr)
+				next.put(function.hash, serializeAst(function.node, {}));
+		}
+		if (!next.save(functionCacheFile))
+			LOG_WARNING("Cannot write %s.", functionCacheFile.string().c_str());
+		LOG_INFO("Incremental build: %zu of %zu functions reused.", reused.size(), parser->GetFunctions().size());
+	}
+
 	/* 	After obtaining .ll file,
 		using llvm-as to convert .ll to .bc (llvm bitcode)
 		and use clang to convert .bc to executable file
 		For example:
 			llvm-as ./res/a.ll
 			clang ./res/a.bc -o ./res/a.out
+		Programs that divide, take the remainder of or exponentiate uint256 or int256 values
+		call runtime/u256.c:
+			clang ./res/a.bc runtime/u256.c -O2 -o ./res/a.out
 	*/
 }
\ No newline at end of file
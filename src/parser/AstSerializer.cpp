@@ -0,0 +1,468 @@
+#include "parser/AstSerializer.h"
+#include "common/Hash.h"
+#include "parser/AstVisitor.h"
+#include "preprocess/MappedFile.h"
+#include <fstream>
+#include <tuple>
+#include <type_traits>
+
+using namespace minisolc;
+
+namespace {
+
+constexpr std::string_view kMagic = "MSAST";
+
+class AstWriter: public AstVisitor<AstWriter, void> {
+public:
+	explicit AstWriter(std::string& out): m_out(out) {}
+
+	void varint(uint64_t value) {
+		while (value >= 0x80) {
+			m_out.push_back(static_cast<char>(value | 0x80));
+			value >>= 7;
+		}
+		m_out.push_back(static_cast<char>(value));
+	}
+	void string(std::string_view s) {
+		varint(s.size());
+		m_out.append(s.data(), s.size());
+	}
+	void node(BaseAST* node) {
+		if (node == nullptr)
+			varint(0);
+		else
+			visit(node);
+	}
+	template <typename T> void list(AstList<T> nodes) {
+		varint(nodes.size());
+		for (T* child: nodes)
+			node(child);
+	}
+
+private:
+	friend class AstVisitor<AstWriter, void>;
+
+	void header(BaseAST* node) { varint(static_cast<uint64_t>(node->GetASTType())); }
+	void header(Expression* expr) {
+		varint(static_cast<uint64_t>(expr->GetASTType()));
+		varint(static_cast<uint64_t>(expr->GetType()));
+		varint(static_cast<uint64_t>(expr->GetCastType()));
+		varint(expr->GetIntType().bits);
+		varint(expr->GetIntType().isSigned);
+	}
+
+	void visitSourceUnit(SourceUnit* n) {
+		header(n);
+		list(n->getSubNodes());
+	}
+	void visitPlainVariableDefinition(PlainVariableDefinition* n) {
+		header(n);
+		string(n->GetName());
+		node(n->GetDeclarationType());
+		node(n->getVarDefExpr());
+	}
+	void visitArrayDefinition(ArrayDefinition* n) {
+		header(n);
+		string(n->GetName());
+		node(n->GetDeclarationType());
+		node(n->GetArraySize());
+	}
+	void visitStructDefinition(StructDefinition* n) {
+		header(n);
+		string(n->GetName());
+		list(n->GetStructMemList());
+		varint(n->GetisVariable());
+		string(n->GetStructName());
+		node(n->GetDeclarationType());
+		node(n->GetInitExpr());
+	}
+	void visitParameterList(ParameterList* n) {
+		header(n);
+		list(n->GetArgs());
+	}
+	void visitBlock(Block* n) {
+		header(n);
+		list(n->GetStatements());
+	}
+	void visitFunctionDefinition(FunctionDefinition* n) {
+		header(n);
+		string(n->GetName());
+		node(n->GetParameterList());
+		varint(static_cast<uint64_t>(n->GetVisibility()));
+		node(n->GetDeclarationType());
+		node(n->GetBody());
+	}
+	void visitElementaryTypeName(ElementaryTypeName* n) {
+		header(n);
+		varint(static_cast<uint64_t>(n->GetType()));
+		varint(n->GetBits());
+	}
+	void visitReturnStatement(ReturnStatement* n) {
+		header(n);
+		node(n->GetExpr());
+	}
+	void visitIdentifier(Identifier* n) {
+		header(n);
+		string(n->GetValue());
+	}
+	void visitBooleanLiteral(BooleanLiteral* n) {
+		header(n);
+		string(n->GetValue());
+	}
+	void visitStringLiteral(StringLiteral* n) {
+		header(n);
+		string(n->GetValue());
+	}
+	void visitNumberLiteral(NumberLiteral* n) {
+		header(n);
+		string(n->GetValue());
+	}
+	void visitAssignment(Assignment* n) {
+		header(n);
+		node(n->GetLeftHand());
+		varint(static_cast<uint64_t>(n->GetAssigmentOp()));
+		node(n->GetRightHand());
+	}
+	void visitBinaryOp(BinaryOp* n) {
+		header(n);
+		node(n->GetLeftHand());
+		varint(static_cast<uint64_t>(n->GetOp()));
+		node(n->GetRightHand());
+	}
+	void visitUnaryOp(UnaryOp* n) {
+		header(n);
+		varint(static_cast<uint64_t>(n->GetOp()));
+		node(n->GetExpr());
+		varint(n->IsPrefix());
+	}
+	void visitIfStatement(IfStatement* n) {
+		header(n);
+		node(n->GetCondition());
+		node(n->GetThenStatement());
+		node(n->GetElseStatement());
+	}
+	void visitWhileStatement(WhileStatement* n) {
+		header(n);
+		node(n->GetConditionExpr());
+		node(n->GetWhileLoopBody());
+	}
+	void visitForStatement(ForStatement* n) {
+		header(n);
+		node(n->GetInitExpr());
+		node(n->GetConditionExpr());
+		node(n->GetUpdateExpr());
+		node(n->GetForLoopBody());
+	}
+	void visitDoWhileStatement(DoWhileStatement* n) {
+		header(n);
+		node(n->GetConditionExpr());
+		node(n->GetDoWhileLoopBody());
+	}
+	void visitBreakStatement(BreakStatement* n) { header(n); }
+	void visitContinueStatement(ContinueStatement* n) { header(n); }
+	void visitExpressionStatement(ExpressionStatement* n) {
+		header(n);
+		node(n->GetExpr());
+	}
+	void visitIndexAccess(IndexAccess* n) {
+		header(n);
+		node(n->GetArrayName());
+		node(n->GetArrayIndex());
+	}
+	void visitFunctionCall(FunctionCall* n) {
+		header(n);
+		node(n->GetCallee());
+		list(n->GetArgs());
+	}
+	void visitMemberAccess(MemberAccess* n) {
+		header(n);
+		node(n->GetStructVarExpr());
+		string(n->GetMember());
+	}
+
+	std::string& m_out;
+};
+
+/* Reads what AstWriter wrote. Any malformed input (truncated data, an unknown kind, or a
+   node of the wrong class for its slot) clears m_ok, after which every read yields a
+   zero value, so the caller only checks ok() once at the end. */
+class AstReader {
+public:
+	AstReader(std::string_view data, AstArena& arena): m_cur(data.data()), m_end(data.data() + data.size()), m_arena(arena) {}
+
+	bool ok() const { return m_ok; }
+	bool atEnd() const { return m_cur == m_end; }
+	void fail() {
+		m_ok = false;
+		m_cur = m_end;
+	}
+
+	uint64_t varint() {
+		uint64_t value = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7) {
+			if (m_cur == m_end) {
+				fail();
+				return 0;
+			}
+			uint8_t byte = static_cast<uint8_t>(*m_cur++);
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return value;
+		}
+		fail();
+		return 0;
+	}
+	std::string_view bytes() {
+		uint64_t size = varint();
+		if (size > static_cast<uint64_t>(m_end - m_cur)) {
+			fail();
+			return {};
+		}
+		std::string_view s(m_cur, size);
+		m_cur += size;
+		return s;
+	}
+	/// A string that outlives the input, in the arena.
+	std::string_view string() { return m_arena.copy(bytes()); }
+	/// An enumerator no greater than last.
+	template <typename E> E enumValue(E last) {
+		uint64_t value = varint();
+		if (value > static_cast<uint64_t>(last))
+			fail();
+		return m_ok ? static_cast<E>(value) : E{};
+	}
+
+	/// A node that must be a T, or null.
+	template <typename T> T* node() {
+		uint64_t kind = varint();
+		if (kind == 0 || !m_ok)
+			return nullptr;
+		switch (static_cast<ElementASTTypes>(kind)) {
+#define V(name)                                  \
+	case ElementASTTypes::name:                    \
+		if constexpr (std::is_base_of_v<T, name>) \
+			return read##name();                   \
+		break;
+			AST_NODE_LIST(V)
+#undef V
+		default:
+			break;
+		}
+		fail();
+		return nullptr;
+	}
+	template <typename T> AstList<T> list() {
+		uint64_t size = varint();
+		/* Every node takes at least one byte. */
+		if (size > static_cast<uint64_t>(m_end - m_cur)) {
+			fail();
+			return {};
+		}
+		std::vector<T*> nodes;
+		nodes.reserve(size);
+		for (uint64_t i = 0; i < size && m_ok; ++i)
+			nodes.push_back(node<T>());
+		return m_arena.list(nodes);
+	}
+
+private:
+	template <typename T> T* expression(T* expr, Type type, Type castType, IntegerType intType) {
+		expr->SetType(type);
+		expr->SetCastType(castType);
+		expr->SetIntType(intType);
+		return expr;
+	}
+	std::tuple<Type, Type, IntegerType> types() {
+		Type type = enumValue(Type::BOOLEAN);
+		Type castType = enumValue(Type::BOOLEAN);
+		IntegerType intType;
+		intType.bits = static_cast<uint16_t>(varint());
+		intType.isSigned = varint() != 0;
+		return {type, castType, intType};
+	}
+
+	SourceUnit* readSourceUnit() { return m_arena.make<SourceUnit>(list<BaseAST>()); }
+	PlainVariableDefinition* readPlainVariableDefinition() {
+		std::string_view name = string();
+		TypeName* type = node<TypeName>();
+		Expression* expr = node<Expression>();
+		return m_arena.make<PlainVariableDefinition>(name, type, expr);
+	}
+	ArrayDefinition* readArrayDefinition() {
+		std::string_view name = string();
+		TypeName* type = node<TypeName>();
+		Expression* size = node<Expression>();
+		return m_arena.make<ArrayDefinition>(name, type, size);
+	}
+	StructDefinition* readStructDefinition() {
+		std::string_view name = string();
+		AstList<VariableDefinition> members = list<VariableDefinition>();
+		bool isVariable = varint() != 0;
+		std::string_view structName = string();
+		TypeName* type = node<TypeName>();
+		Expression* expr = node<Expression>();
+		return m_arena.make<StructDefinition>(name, members, isVariable, structName, type, expr);
+	}
+	ParameterList* readParameterList() { return m_arena.make<ParameterList>(list<VariableDefinition>()); }
+	Block* readBlock() { return m_arena.make<Block>(list<Statement>()); }
+	FunctionDefinition* readFunctionDefinition() {
+		std::string_view name = string();
+		ParameterList* params = node<ParameterList>();
+		Visibility visibility = enumValue(Visibility::External);
+		TypeName* returnType = node<TypeName>();
+		Block* body = node<Block>();
+		return m_arena.make<FunctionDefinition>(name, params, visibility, returnType, body);
+	}
+	ElementaryTypeName* readElementaryTypeName() {
+		Token type = enumValue(static_cast<Token>(static_cast<int>(Token::NUM_TOKENS) - 1));
+		return m_arena.make<ElementaryTypeName>(type, static_cast<uint16_t>(varint()));
+	}
+	ReturnStatement* readReturnStatement() { return m_arena.make<ReturnStatement>(node<Expression>()); }
+	Identifier* readIdentifier() {
+		auto [type, castType, intType] = types();
+		return expression(m_arena.make<Identifier>(string()), type, castType, intType);
+	}
+	BooleanLiteral* readBooleanLiteral() {
+		auto [type, castType, intType] = types();
+		return expression(m_arena.make<BooleanLiteral>(string()), type, castType, intType);
+	}
+	StringLiteral* readStringLiteral() {
+		auto [type, castType, intType] = types();
+		return expression(m_arena.make<StringLiteral>(string()), type, castType, intType);
+	}
+	NumberLiteral* readNumberLiteral() {
+		auto [type, castType, intType] = types();
+		return expression(m_arena.make<NumberLiteral>(string(), type), type, castType, intType);
+	}
+	Assignment* readAssignment() {
+		auto [type, castType, intType] = types();
+		Expression* lhs = node<Expression>();
+		Token op = enumValue(static_cast<Token>(static_cast<int>(Token::NUM_TOKENS) - 1));
+		Expression* rhs = node<Expression>();
+		return expression(m_arena.make<Assignment>(lhs, op, rhs), type, castType, intType);
+	}
+	BinaryOp* readBinaryOp() {
+		auto [type, castType, intType] = types();
+		Expression* lhs = node<Expression>();
+		Token op = enumValue(static_cast<Token>(static_cast<int>(Token::NUM_TOKENS) - 1));
+		Expression* rhs = node<Expression>();
+		return expression(m_arena.make<BinaryOp>(lhs, op, rhs), type, castType, intType);
+	}
+	UnaryOp* readUnaryOp() {
+		auto [type, castType, intType] = types();
+		Token op = enumValue(static_cast<Token>(static_cast<int>(Token::NUM_TOKENS) - 1));
+		Expression* expr = node<Expression>();
+		bool isPrefix = varint() != 0;
+		return expression(m_arena.make<UnaryOp>(op, expr, isPrefix), type, castType, intType);
+	}
+	IfStatement* readIfStatement() {
+		Expression* condition = node<Expression>();
+		Statement* thenStatement = node<Statement>();
+		Statement* elseStatement = node<Statement>();
+		return m_arena.make<IfStatement>(condition, thenStatement, elseStatement);
+	}
+	WhileStatement* readWhileStatement() {
+		Expression* condition = node<Expression>();
+		Statement* body = node<Statement>();
+		return m_arena.make<WhileStatement>(condition, body);
+	}
+	ForStatement* readForStatement() {
+		SimpleStatement* init = node<SimpleStatement>();
+		Expression* condition = node<Expression>();
+		Expression* update = node<Expression>();
+		Statement* body = node<Statement>();
+		return m_arena.make<ForStatement>(init, condition, update, body);
+	}
+	DoWhileStatement* readDoWhileStatement() {
+		Expression* condition = node<Expression>();
+		Statement* body = node<Statement>();
+		return m_arena.make<DoWhileStatement>(condition, body);
+	}
+	BreakStatement* readBreakStatement() { return m_arena.make<BreakStatement>(); }
+	ContinueStatement* readContinueStatement() { return m_arena.make<ContinueStatement>(); }
+	ExpressionStatement* readExpressionStatement() { return m_arena.make<ExpressionStatement>(node<Expression>()); }
+	IndexAccess* readIndexAccess() {
+		auto [type, castType, intType] = types();
+		Expression* expr = node<Expression>();
+		Expression* index = node<Expression>();
+		return expression(m_arena.make<IndexAccess>(expr, index), type, castType, intType);
+	}
+	FunctionCall* readFunctionCall() {
+		auto [type, castType, intType] = types();
+		Expression* callee = node<Expression>();
+		AstList<Expression> args = list<Expression>();
+		return expression(m_arena.make<FunctionCall>(callee, args), type, castType, intType);
+	}
+	MemberAccess* readMemberAccess() {
+		auto [type, castType, intType] = types();
+		Expression* expr = node<Expression>();
+		std::string_view member = string();
+		return expression(m_arena.make<MemberAccess>(expr, member), type, castType, intType);
+	}
+
+	const char* m_cur;
+	const char* m_end;
+	AstArena& m_arena;
+	bool m_ok = true;
+};
+
+}
+
+uint64_t minisolc::hashInput(const std::filesystem::path& path) {
+	std::shared_ptr<MappedFile> file = MappedFile::open(path);
+	return file == nullptr ? 0 : fnv1a(file->view());
+}
+
+std::string minisolc::serializeAst(BaseAST* root, const std::vector<AstInput>& inputs) {
+	std::string out(kMagic);
+	AstWriter writer(out);
+	writer.varint(kAstFormatVersion);
+	writer.varint(inputs.size());
+	for (const AstInput& input: inputs) {
+		writer.string(input.path);
+		writer.varint(input.hash);
+	}
+	writer.node(root);
+	return out;
+}
+
+BaseAST* minisolc::deserializeAst(std::string_view data, AstArena& arena, std::vector<AstInput>* inputs) {
+	if (data.substr(0, kMagic.size()) != kMagic)
+		return nullptr;
+	AstReader reader(data.substr(kMagic.size()), arena);
+	if (reader.varint() != kAstFormatVersion)
+		return nullptr;
+	uint64_t count = reader.varint();
+	for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+		std::string_view path = reader.bytes();
+		uint64_t hash = reader.varint();
+		if (inputs != nullptr)
+			inputs->push_back({std::string(path), hash});
+	}
+	BaseAST* root = reader.node<BaseAST>();
+	return reader.ok() && reader.atEnd() ? root : nullptr;
+}
+
+bool minisolc::saveAst(const std::filesystem::path& file, BaseAST* root, const std::vector<AstInput>& inputs) {
+	std::string data = serializeAst(root, inputs);
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(out);
+}
+
+BaseAST* minisolc::loadFreshAst(const std::filesystem::path& file, AstArena& arena) {
+	std::shared_ptr<MappedFile> data = MappedFile::open(file);
+	if (data == nullptr)
+		return nullptr;
+	std::vector<AstInput> inputs;
+	BaseAST* root = deserializeAst(data->view(), arena, &inputs);
+	if (root == nullptr) {
+		LOG_WARNING("Ignoring %s: not an AST file of format version %u.", file.string().c_str(), kAstFormatVersion);
+		return nullptr;
+	}
+	for (const AstInput& input: inputs) {
+		if (hashInput(input.path) != input.hash)
+			return nullptr;
+	}
+	return root;
+}
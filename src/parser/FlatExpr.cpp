@@ -0,0 +1,116 @@
+#include "parser/FlatExpr.h"
+#include "common/Defs.h"
+
+using namespace minisolc;
+
+namespace {
+
+FlatExprStore::Index indexOf(const Expression* expr) {
+	return expr == nullptr ? FlatExprStore::kNone : expr->GetFlatIndex();
+}
+
+}
+
+FlatExprStore::Index FlatExprStore::append(Expression* expr) {
+	ASSERT(expr != nullptr, "Cannot flatten a null expression.");
+	Index index = static_cast<Index>(m_kinds.size());
+	Token op = Token::Illegal;
+	Index lhs = kNone, rhs = kNone;
+	switch (expr->GetASTType()) {
+	case ElementASTTypes::BinaryOp: {
+		const BinaryOp* node = static_cast<const BinaryOp*>(expr);
+		op = node->GetOp();
+		lhs = indexOf(node->GetLeftHand());
+		rhs = indexOf(node->GetRightHand());
+		break;
+	}
+	case ElementASTTypes::Assignment: {
+		const Assignment* node = static_cast<const Assignment*>(expr);
+		op = node->GetAssigmentOp();
+		lhs = indexOf(node->GetLeftHand());
+		rhs = indexOf(node->GetRightHand());
+		break;
+	}
+	case ElementASTTypes::UnaryOp: {
+		const UnaryOp* node = static_cast<const UnaryOp*>(expr);
+		op = node->GetOp();
+		lhs = indexOf(node->GetExpr());
+		break;
+	}
+	case ElementASTTypes::IndexAccess: {
+		const IndexAccess* node = static_cast<const IndexAccess*>(expr);
+		lhs = indexOf(node->GetArrayName());
+		rhs = indexOf(node->GetArrayIndex());
+		break;
+	}
+	case ElementASTTypes::MemberAccess:
+		lhs = indexOf(static_cast<const MemberAccess*>(expr)->GetStructVarExpr());
+		break;
+	case ElementASTTypes::FunctionCall: {
+		const FunctionCall* node = static_cast<const FunctionCall*>(expr);
+		lhs = indexOf(node->GetCallee());
+		rhs = static_cast<Index>(m_args.size());
+		m_args.push_back(static_cast<Index>(node->GetArgs().size()));
+		for (Expression* arg: node->GetArgs())
+			m_args.push_back(indexOf(arg));
+		break;
+	}
+	default:
+		break;
+	}
+	m_kinds.push_back(expr->GetASTType());
+	m_ops.push_back(op);
+	m_lhs.push_back(lhs);
+	m_rhs.push_back(rhs);
+	m_types.push_back(expr->GetType());
+	m_nodes.push_back(expr);
+	expr->SetFlatIndex(index);
+	return index;
+}
+
+void FlatExprStore::truncate(size_t size) {
+	if (size >= m_kinds.size())
+		return;
+	/* Arguments are appended in node order, so the first dropped call's are the first to go. */
+	for (size_t i = size; i < m_kinds.size(); ++i) {
+		if (m_kinds[i] == ElementASTTypes::FunctionCall) {
+			m_args.resize(m_rhs[i]);
+			break;
+		}
+	}
+	m_kinds.resize(size);
+	m_ops.resize(size);
+	m_lhs.resize(size);
+	m_rhs.resize(size);
+	m_types.resize(size);
+	m_nodes.resize(size);
+}
+
+void FlatExprStore::refreshTypes() {
+	for (size_t i = 0; i < m_nodes.size(); ++i)
+		m_types[i] = m_nodes[i]->GetType();
+}
+
+std::vector<bool> FlatExprStore::constantMask() const {
+	std::vector<bool> constant(m_kinds.size(), false);
+	auto isConstant = [&](Index i) { return i != kNone && constant[i]; };
+	for (size_t i = 0; i < m_kinds.size(); ++i) {
+		switch (m_kinds[i]) {
+		case ElementASTTypes::BooleanLiteral:
+		case ElementASTTypes::NumberLiteral:
+		case ElementASTTypes::StringLiteral:
+			constant[i] = true;
+			break;
+		case ElementASTTypes::UnaryOp:
+			/* ++ and -- write their operand. */
+			constant[i] = m_ops[i] != Token::Inc && m_ops[i] != Token::Dec && isConstant(m_lhs[i]);
+			break;
+		case ElementASTTypes::BinaryOp:
+			constant[i] = isConstant(m_lhs[i]) && isConstant(m_rhs[i]);
+			break;
+		default:
+			break;
+		}
+	}
+	return constant;
+}
@@ -0,0 +1,81 @@
+#include "parser/FunctionCache.h"
+#include "parser/AstSerializer.h"
+#include "parser/AstVisitor.h"
+#include "preprocess/MappedFile.h"
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+using namespace minisolc;
+
+namespace {
+
+constexpr std::string_view kMagic = "MSFNC";
+
+/* Integers are 64-bit in host byte order: the file only serves the machine that wrote it. */
+void writeU64(std::ofstream& out, uint64_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+void writeBytes(std::ofstream& out, const std::string& bytes) {
+	writeU64(out, bytes.size());
+	out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+bool readU64(std::string_view& in, uint64_t& value) {
+	if (in.size() < sizeof(value))
+		return false;
+	std::memcpy(&value, in.data(), sizeof(value));
+	in.remove_prefix(sizeof(value));
+	return true;
+}
+
+bool readBytes(std::string_view& in, std::string& bytes) {
+	uint64_t size;
+	if (!readU64(in, size) || size > in.size())
+		return false;
+	bytes.assign(in.data(), size);
+	in.remove_prefix(size);
+	return true;
+}
+
+}
+
+bool FunctionCache::load(const std::filesystem::path& file) {
+	m_asts.clear();
+	std::shared_ptr<MappedFile> data = MappedFile::open(file);
+	if (data == nullptr)
+		return false;
+	std::string_view in = data->view();
+	uint64_t version, count;
+	if (in.substr(0, kMagic.size()) != kMagic)
+		return false;
+	in.remove_prefix(kMagic.size());
+	if (!readU64(in, version) || version != kAstFormatVersion || !readU64(in, count))
+		return false;
+	for (uint64_t i = 0; i < count; ++i) {
+		uint64_t hash;
+		std::string ast;
+		if (!readU64(in, hash) || !readBytes(in, ast)) {
+			m_asts.clear();
+			return false;
+		}
+		m_asts.insert_or_assign(hash, std::move(ast));
+	}
+	return true;
+}
+
+bool FunctionCache::save(const std::filesystem::path& file) const {
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	out.write(kMagic.data(), kMagic.size());
+	writeU64(out, kAstFormatVersion);
+	writeU64(out, m_asts.size());
+	for (const auto& [hash, ast]: m_asts) {
+		writeU64(out, hash);
+		writeBytes(out, ast);
+	}
+	return static_cast<bool>(out);
+}
+
+FunctionDefinition* FunctionCache::findAst(uint64_t hash, AstArena& arena) const {
+	const std::string* ast = find(hash);
+	return ast == nullptr ? nullptr : astCast<FunctionDefinition>(deserializeAst(*ast, arena));
+}
@@ -1,28 +1,207 @@
 #include "parser/Parser.h"
 #include "common/Defs.h"
+#include "common/Hash.h"
 #include "lexer/Token.h" // for precedence()
 #include "parser/Ast.h"
 #include <algorithm>
 #include <iostream>
 #include <iterator>
-#include <memory>
 #include <tuple>
 #include <vector>
 
 using namespace minisolc;
 
 void Parser::parse() {
+	beginParse();
 	m_root = parseSourceUnit();
-	LOG_INFO("Parse Succeeds.");
+	endParse();
 }
 
-std::shared_ptr<SourceUnit> Parser::parseSourceUnit() {
-	std::vector<std::shared_ptr<BaseAST>> subnodes;
-	try {
-		while (!match(Token::EOS)) {
+void Parser::parse(ThreadPool& pool) {
+	std::vector<size_t> bounds;
+	if (!m_source.lazy() && pool.size() > 1 && !m_lookup)
+		bounds = chunkBoundaries(pool.size() * 4);
+	if (bounds.size() <= 2) {
+		parse();
+		return;
+	}
+
+	beginParse();
+	size_t chunks = bounds.size() - 1;
+	std::vector<std::future<std::unique_ptr<Parser>>> results;
+	results.reserve(chunks);
+	for (size_t i = 0; i < chunks; ++i) {
+		results.push_back(pool.submit([this, begin = bounds[i], end = bounds[i + 1]] {
+			/* The window is only read while parsing: names are copied into the chunk's arena. */
+			TokenStream window(m_source, begin, end);
+			auto chunk = std::make_unique<Parser>(window, m_flat.has_value());
+			chunk->beginParse();
+			chunk->m_root = chunk->parseSourceUnit();
+			return chunk;
+		}));
+	}
+
+	std::vector<BaseAST*> subnodes;
+	for (auto& result: results) {
+		std::unique_ptr<Parser> chunk = result.get();
+		SourceUnit* unit = static_cast<SourceUnit*>(chunk->m_root);
+		subnodes.insert(subnodes.end(), unit->getSubNodes().begin(), unit->getSubNodes().end());
+		std::move(chunk->m_diagnostics.begin(), chunk->m_diagnostics.end(), std::back_inserter(m_diagnostics));
+		if (m_flat)
+			m_flat->append(*chunk->m_flat);
+		m_rewinds += chunk->m_rewinds;
+		m_memoHits += chunk->m_memoHits;
+		m_chunks.push_back(std::move(chunk));
+	}
+	m_root = m_arena.make<SourceUnit>(m_arena.list(subnodes));
+	m_source.setPos(bounds.back());
+	endParse();
+}
+
+void Parser::beginParse() {
+	m_memo.clear();
+	m_diagnostics.clear();
+	m_chunks.clear();
+	m_lastErrorPos = SIZE_MAX;
+	m_rewinds = m_memoHits = 0;
+	m_functions.clear();
+	m_nextFunction = 0;
+	if (m_lookup)
+		hashFunctions();
+}
+
+void Parser::endParse() {
+	for (const auto& e: m_diagnostics)
+		e->print();
+	if (m_diagnostics.empty())
+		LOG_INFO("Parse Succeeds. %zu rewinds, %zu memo hits.", m_rewinds, m_memoHits);
+	else
+		LOG_INFO("Parse finished with %zu errors.", m_diagnostics.size());
+}
+
+std::vector<size_t> Parser::chunkBoundaries(size_t maxChunks) {
+	/* Top-level functions start at a 'function' outside any braces. Cutting only there keeps
+	   every definition, and the recovery around it, inside one chunk. */
+	static constexpr size_t kMinChunkTokens = 2048;
+	std::vector<size_t> starts;
+	size_t count = 0;
+	size_t depth = 0;
+	for (Token tok; (tok = m_source.peekTok(count)) != Token::EOS; ++count) {
+		if (tok == Token::LBrace)
+			++depth;
+		else if (tok == Token::RBrace && depth > 0)
+			--depth;
+		else if (tok == Token::Function && depth == 0)
+			starts.push_back(count);
+	}
+
+	size_t begin = m_source.pos();
+	size_t chunkTokens = std::max(kMinChunkTokens, count / std::max<size_t>(maxChunks, 1));
+	std::vector<size_t> bounds{begin};
+	for (size_t start: starts) {
+		if (start - (bounds.back() - begin) >= chunkTokens)
+			bounds.push_back(begin + start);
+	}
+	bounds.push_back(begin + count);
+	return bounds;
+}
+
+void Parser::hashFunctions() {
+	auto hashToken = [](uint64_t h, Token tok, std::string_view val) {
+		return mix64(h ^ fnv1a(val) ^ static_cast<uint64_t>(tok) << 56);
+	};
+	uint64_t context = 0; // every token so far outside function bodies
+	uint64_t function = 0;
+	size_t begin = m_source.pos();
+	size_t depth = 0;
+	bool inFunction = false; // between a top-level 'function' and the end of its body
+	size_t start = 0;
+	Token tok;
+	for (size_t count = 0; (tok = m_source.peekTok(count)) != Token::EOS; ++count) {
+		std::string_view val = m_source.peekVal(count);
+		if (tok == Token::Function && depth == 0) {
+			inFunction = true;
+			start = count;
+			function = context;
+		}
+		if (inFunction) {
+			function = hashToken(function, tok, val);
+			if (depth == 0)
+				context = hashToken(context, tok, val);
+		} else {
+			context = hashToken(context, tok, val);
+		}
+
+		if (tok == Token::LBrace) {
+			++depth;
+		} else if (tok == Token::RBrace && depth > 0) {
+			if (--depth == 0 && inFunction) {
+				m_functions.push_back({begin + start, begin + count + 1, function});
+				inFunction = false;
+			}
+		} else if (tok == Token::Semicolon && depth == 0) {
+			/* A declaration without a body. */
+			inFunction = false;
+		}
+	}
+}
+
+FunctionDefinition* Parser::reuseFunction() {
+	while (m_nextFunction < m_functions.size() && m_functions[m_nextFunction].begin < m_source.pos())
+		++m_nextFunction;
+	if (m_nextFunction == m_functions.size() || m_functions[m_nextFunction].begin != m_source.pos())
+		return nullptr;
+	TopLevelFunction& entry = m_functions[m_nextFunction];
+	entry.node = m_lookup(entry.hash, m_arena);
+	if (entry.node == nullptr)
+		return nullptr;
+	entry.reused = true;
+	m_source.setPos(entry.end);
+	return entry.node;
+}
+
+void Parser::report(const ParseError& e) {
+	/* An error that recovery did not get past is not reported again. */
+	if (m_source.pos() == m_lastErrorPos)
+		return;
+	m_lastErrorPos = m_source.pos();
+	m_diagnostics.push_back(e.clone());
+}
+
+void Parser::synchronize() {
+	size_t depth = 0;
+	while (!eof()) {
+		Token tok = curTok();
+		if (tok == Token::Function || (tok == Token::RBrace && depth == 0))
+			return;
+		advance();
+		if (tok == Token::LBrace)
+			++depth;
+		else if (tok == Token::RBrace && --depth == 0)
+			return;
+		else if (tok == Token::Semicolon && depth == 0)
+			return;
+	}
+}
+
+SourceUnit* Parser::parseSourceUnit() {
+	std::vector<BaseAST*> subnodes;
+	while (!match(Token::EOS)) {
+		size_t start = m_source.pos();
+		size_t mark = m_scratch.size();
+		/* No checkpoint outlives a top-level item, so nothing memoized before it is asked again. */
+		if (!m_memo.empty())
+			m_memo.clear();
+		try {
 			if (peekCur(Token::Function)) {
-				/* Function definition. */
-				subnodes.push_back(parseFunctionDefinition());
+				/* Function definition, unless an unchanged one is cached. */
+				FunctionDefinition* function = m_lookup ? reuseFunction() : nullptr;
+				if (function == nullptr) {
+					function = parseFunctionDefinition();
+					if (m_nextFunction < m_functions.size() && m_functions[m_nextFunction].begin == start)
+						m_functions[m_nextFunction].node = function;
+				}
+				subnodes.push_back(function);
 			} else if (peekCur(isType)) {
 				/* Variable definition. */
 				subnodes.push_back(parseVariableDefinition());
@@ -34,90 +213,109 @@ std::shared_ptr<SourceUnit> Parser::parseSourceUnit() {
 			} else if (peekCur(Token::Semicolon)) {
 				/* Empty statement. */
 				expect(Token::Semicolon);
-			} else {
-				subnodes.push_back(parseStatement());
+			} else if (StructDefinition* var = speculateStructVariable()) {
+				/* Struct variable without the struct keyword. Otherwise the name starts a statement,
+				   which asks the same question at the same token and gets the memoized answer. */
+				subnodes.push_back(var);
+				expect(Token::Semicolon);
+			} else if (Statement* stmt = parseStatement()) {
+				subnodes.push_back(stmt);
 			}
+		} catch (ParseError& e) {
+			m_scratch.resize(mark);
+			report(e);
+			synchronize();
 		}
-		return std::make_shared<SourceUnit>(std::move(subnodes));
-	} catch (ParseError& e) {
-		e.print();
+		/* A stray '}' stops synchronize() without consuming anything. */
+		if (m_source.pos() == start && !eof())
+			advance();
 	}
-	return nullptr;
+	return m_arena.make<SourceUnit>(m_arena.list(subnodes));
 }
 
-std::shared_ptr<VariableDefinition> Parser::parseVariableDefinition() {
-	std::string name;
-	std::shared_ptr<TypeName> type;
-	std::shared_ptr<Expression> expr;
+VariableDefinition* Parser::parseVariableDefinition() {
+	std::string_view name;
+	TypeName* type = nullptr;
+	Expression* expr = nullptr;
 
-	try {
-		type = parseTypeName();
-		expectGet(Token::Identifier, name);
-		if (match(Token::Assign)) {
-			expr = parseExpression();
-		} else if (match(Token::LBrack)) {
-			/* Array */
-			expr = parseLiterial(); // array of size 0 is not allowed.
-			if (expr->GetASTType() != ElementASTTypes::NumberLiteral) {
-				LOG_WARNING("Parse Array Fails!");
-				throw ParseError(curTokInfo());
-			}
-			expect(Token::RBrack);
+	type = parseTypeName();
+	expectGet(Token::Identifier, name);
+	if (match(Token::Assign)) {
+		expr = parseExpression();
+	} else if (match(Token::LBrack)) {
+		/* Array */
+		expr = parseLiterial(); // array of size 0 is not allowed.
+		if (expr->GetASTType() != ElementASTTypes::NumberLiteral) {
+			LOG_WARNING("Parse Array Fails!");
+			throw ParseError(curTokInfo(), curLoc());
+		}
+		expect(Token::RBrack);
 
-			if (match(Token::Assign)) {
-				/* Initialize list. */
-				LOG_WARNING("Not implemented.");
-			}
-			return std::make_shared<ArrayDefinition>(name, std::move(type), std::move(expr));
+		if (match(Token::Assign)) {
+			/* Initialize list. */
+			LOG_WARNING("Not implemented.");
 		}
-		/* Plain variable definition. */
-		return std::make_shared<PlainVariableDefinition>(name, std::move(type), std::move(expr));
-	} catch (ParseError& e) {
-		e.print();
+		return m_arena.make<ArrayDefinition>(m_arena.copy(name), type, expr);
 	}
-	return nullptr;
+	/* Plain variable definition. */
+	return m_arena.make<PlainVariableDefinition>(m_arena.copy(name), type, expr);
 }
 
-std::shared_ptr<StructDefinition> Parser::parseStructDefinition() {
+StructDefinition* Parser::parseStructDefinition() {
 	// Partially completes.
-	using StructMem_t = std::vector<std::shared_ptr<VariableDefinition>>;
-	std::string name;
-	try {
-		expect(Token::Struct);
-		std::shared_ptr<TypeName> type = std::make_shared<ElementaryTypeName>(Token::Struct);
-		expectGet(Token::Identifier, name);
-
-		if (match(Token::LBrace)) {
-			/* Struct type declaration. */
-			StructMem_t struct_members;
-			while (!match(Token::RBrace)) {
-				struct_members.push_back(parseVariableDefinition());
-				match(Token::Semicolon);
-			}
-			return std::make_shared<StructDefinition>(name, std::move(struct_members), false, name);
-		} else {
-			/* A struct variable declaration. */
-			std::string var;
-			std::shared_ptr<minisolc::Expression> expr;
-			expectGet(Token::Identifier, var);
-			if (match(Token::Assign)) {
-				/* Initialize list. */
-				expr = parseExpression();
-			}
-			return std::make_shared<StructDefinition>(var, StructMem_t{}, true, name, expr);
+	std::string_view name;
+	expect(Token::Struct);
+	TypeName* type = m_arena.make<ElementaryTypeName>(Token::Struct);
+	expectGet(Token::Identifier, name);
+
+	if (match(Token::LBrace)) {
+		/* Struct type declaration. */
+		size_t mark = m_scratch.size();
+		while (!match(Token::RBrace)) {
+			m_scratch.push_back(parseVariableDefinition());
+			match(Token::Semicolon);
 		}
-	} catch (ParseError& e) {
-		e.print();
+		std::string_view structName = m_arena.copy(name);
+		return m_arena.make<
+			StructDefinition>(structName, takeList<VariableDefinition>(mark), false, structName, type);
+	} else {
+		/* A struct variable declaration. */
+		return parseStructVariable(name, type);
 	}
-	return nullptr;
 }
 
-std::shared_ptr<FunctionDefinition> Parser::parseFunctionDefinition() {
-	std::string name;
-	std::string vis;
-	std::shared_ptr<ParameterList> paramList = nullptr;
-	std::shared_ptr<TypeName> returnType = nullptr;
-	std::shared_ptr<Block> block = nullptr;
+StructDefinition* Parser::parseStructVariable(std::string_view structName, TypeName* type) {
+	std::string_view var;
+	Expression* expr = nullptr;
+	expectGet(Token::Identifier, var);
+	if (match(Token::Assign)) {
+		/* Initialize list. */
+		expr = parseExpression();
+	}
+	return m_arena.make<
+		StructDefinition>(m_arena.copy(var), AstList<VariableDefinition>{}, true, m_arena.copy(structName), type, expr);
+}
+
+StructDefinition* Parser::speculateStructVariable() {
+	/* "S x" declares a struct variable, as "struct S x" does, while a statement starting with a
+	   name alone is an expression: "S = ...", "S(...)", "S.x". Only the second name tells, so
+	   the common statements are decided by one token of lookahead and never speculate. */
+	if (!peekCur(Token::Identifier) || m_source.peekTok(1) != Token::Identifier)
+		return nullptr;
+	return speculate<StructDefinition>(Rule::StructVariable, [this] {
+		std::string_view structName;
+		TypeName* type = m_arena.make<ElementaryTypeName>(Token::Struct);
+		expectGet(Token::Identifier, structName);
+		return parseStructVariable(structName, type);
+	});
+}
+
+FunctionDefinition* Parser::parseFunctionDefinition() {
+	std::string_view name;
+	std::string_view vis;
+	ParameterList* paramList = nullptr;
+	TypeName* returnType = nullptr;
+	Block* block = nullptr;
 
 	StateMutability stateMutability{StateMutability::Nonpayable};
 	Visibility visibility{Visibility::Default};
@@ -130,100 +328,85 @@ std::shared_ptr<FunctionDefinition> Parser::parseFunctionDefinition() {
 	   block
 	   ;
 	*/
-	try {
-		expect(Token::Function);
-		expectGet(Token::Identifier, name);
-		paramList = parseParameterList();
+	expect(Token::Function);
+	expectGet(Token::Identifier, name);
+	paramList = parseParameterList();
 
-		if (matchGet(isVisibility, vis)) {
-			visibility = visibilityByName(vis);
-		}
+	if (matchGet(isVisibility, vis)) {
+		visibility = visibilityByName(vis);
+	}
 
-		expect(Token::Returns);
-		expect(Token::LParen);
-		if (!match(Token::RParen)) {
-			returnType = parseTypeName();
-			expect(Token::RParen);
-		}
-		if (returnType == nullptr)
-			returnType = std::make_shared<ElementaryTypeName>(Token::Void);
+	expect(Token::Returns);
+	expect(Token::LParen);
+	if (!match(Token::RParen)) {
+		returnType = parseTypeName();
+		expect(Token::RParen);
+	}
+	if (returnType == nullptr)
+		returnType = m_arena.make<ElementaryTypeName>(Token::Void);
 
-		if (peekCur(Token::LBrace))
-			block = parseBlock();
-		else
-			expect(Token::Semicolon);
+	if (peekCur(Token::LBrace))
+		block = parseBlock();
+	else
+		expect(Token::Semicolon);
 
-		return std::make_shared<
-			FunctionDefinition>(name, std::move(paramList), visibility, std::move(returnType), std::move(block));
+	return m_arena.make<FunctionDefinition>(m_arena.copy(name), paramList, visibility, returnType, block);
 
-	} catch (ParseError& e) {
-		e.print();
-	};
-	return nullptr;
 }
 
-std::shared_ptr<ParameterList> Parser::parseParameterList() {
-	std::vector<std::shared_ptr<VariableDefinition>> params;
+ParameterList* Parser::parseParameterList() {
+	size_t mark = m_scratch.size();
 	/* (Type variable, Type variable, ..., Type variable) */
-	try {
-		expect(Token::LParen);
-		if (match(Token::RParen)) {
-			return nullptr;
-		} else {
-			while (true) {
-				/* Here struct parameter is not implemented. */
-				auto para = parseVariableDefinition();
-				if (para->GetDeclarationType()->GetType() == Token::Struct) {
-					LOG_WARNING("Cannot use struct as function parameter.");
-				} else {
-					params.push_back(para);
-				}
-				if (match(Token::Comma)) {
-					continue;
-				} else {
-					expect(Token::RParen);
-					break;
-				}
+	expect(Token::LParen);
+	if (match(Token::RParen)) {
+		return nullptr;
+	} else {
+		while (true) {
+			/* Here struct parameter is not implemented. */
+			auto para = parseVariableDefinition();
+			if (para->GetDeclarationType()->GetType() == Token::Struct) {
+				LOG_WARNING("Cannot use struct as function parameter.");
+			} else {
+				m_scratch.push_back(para);
+			}
+			if (match(Token::Comma)) {
+				continue;
+			} else {
+				expect(Token::RParen);
+				break;
 			}
 		}
-		return std::make_shared<ParameterList>(std::move(params));
-	} catch (ParseError& e) {
-		e.print();
 	}
-	return nullptr;
+	return m_arena.make<ParameterList>(takeList<VariableDefinition>(mark));
 }
 
-std::shared_ptr<TypeName> Parser::parseTypeName() {
-	try {
-		std::string type;
-		expectGet(isType, type);
-		return std::make_shared<ElementaryTypeName>(keywordByName(type));
-	} catch (ParseError& e) {
-		e.print();
-	}
-	return nullptr;
+TypeName* Parser::parseTypeName() {
+	std::string_view type;
+	expectGet(isType, type);
+	return m_arena.make<ElementaryTypeName>(keywordByName(type), integerTypeBits(type));
 }
 
-std::shared_ptr<Block> Parser::parseBlock() {
-	std::vector<std::shared_ptr<Statement>> stmts;
+Block* Parser::parseBlock() {
+	size_t mark = m_scratch.size();
 	/* {...} */
-	try {
-		expect(Token::LBrace);
-		while (!match(Token::RBrace)) {
-			std::shared_ptr<Statement> stmt;
-			stmt = parseStatement();
-			if (stmt != nullptr)
-				stmts.push_back(std::move(stmt));
+	expect(Token::LBrace);
+	while (!match(Token::RBrace)) {
+		if (eof() || peekCur(Token::Function)) {
+			/* Unclosed block: keep what was parsed and let the enclosing rules resume. */
+			report(UnexpectedToken(curTokInfo(), curLoc(), Token::RBrace));
+			break;
 		}
-		return std::make_shared<Block>(std::move(stmts));
-	} catch (ParseError& e) {
-		e.print();
+		Statement* stmt = nullptr;
+		stmt = parseStatement();
+		if (stmt != nullptr)
+			m_scratch.push_back(stmt);
 	}
-	return nullptr;
+	return m_arena.make<Block>(takeList<Statement>(mark));
 }
 
-std::shared_ptr<Statement> Parser::parseStatement() {
-	std::shared_ptr<Statement> stmt;
+Statement* Parser::parseStatement() {
+	Statement* stmt = nullptr;
+	size_t mark = m_scratch.size();
 	try {
 		if (peekCur(Token::Return)) {
 			stmt = parseReturn();
@@ -254,6 +437,8 @@ std::shared_ptr<Statement> Parser::parseStatement() {
 			expect(Token::Semicolon);
 		} else if (peekCur(Token::LBrace))
 			stmt = parseBlock();
+		else if ((stmt = speculateStructVariable()) != nullptr)
+			expect(Token::Semicolon);
 		else {
 			stmt = parseExpressionStatement();
 			expect(Token::Semicolon);
@@ -261,127 +446,141 @@ std::shared_ptr<Statement> Parser::parseStatement() {
 
 		return stmt;
 	} catch (ParseError& e) {
-		e.print();
-	};
+		m_scratch.resize(mark);
+		report(e);
+		synchronize();
+	}
 	return nullptr;
 }
 
-std::shared_ptr<ReturnStatement> Parser::parseReturn() {
-	std::shared_ptr<Expression> expr = nullptr;
+ReturnStatement* Parser::parseReturn() {
+	Expression* expr = nullptr;
 
 	expect(Token::Return);
 	if (!peekCur(Token::Semicolon))
 		expr = parseExpression();
-	return std::make_shared<ReturnStatement>(std::move(expr));
+	return m_arena.make<ReturnStatement>(expr);
 }
 
-std::shared_ptr<Expression> Parser::parseExpression(std::shared_ptr<Expression> const& partiallyParsedExpression) {
-	std::shared_ptr<Expression> expr = parseBinaryExpression(4, partiallyParsedExpression);
-	Token tok = curTok();
-	std::string value;
+namespace {
 
-	if (isAssignmentOp(tok)) {
-		// Assignment.
-		advance(); // eat assignment operator
-		std::shared_ptr<Expression> rhs = parseExpression();
-		return std::make_shared<Assignment>(expr, tok, rhs);
-	}
-	return expr;
+/* Prefix operators bind tighter than every binary operator in the table. */
+constexpr int kPrefixPrecedence = precedence(Token::Exp) + 1;
+
+constexpr bool isInfixOp(Token tok) {
+	return (isBinaryOp(tok) || isCompareOp(tok)) && precedence(tok) >= precedence(Token::Or);
 }
 
-std::shared_ptr<Expression> Parser::parsePrimaryExpression() {
-	Token tok = curTok();
-	std::string value;
-	if (isLiteral(tok)) {
-		// literals
-		return parseLiterial();
-	} else if (tok == Token::Identifier) {
-		// identifier
-		value = curVal();
-		advance(); // eat;
-		return std::make_shared<Identifier>(value);
-	} else if (tok == Token::LParen) {
-		// handle parentheses in expressions
-		// e.g. a = (b + c) * d
-		match(Token::LParen);
-		try {
-			std::shared_ptr<Expression> expr = parseExpression();
-			expect(Token::RParen);
-			return expr;
-		} catch (ParseError& e) {
-			LOG_WARNING("Parse fails.");
-			e.print();
-		}
-	} else {
-		LOG_WARNING("Invalid character %s in parse primary expression.", curVal().c_str());
-	}
-	return nullptr;
 }
 
-std::shared_ptr<Expression>
-Parser::parseBinaryExpression(int minPrecedence, std::shared_ptr<Expression> const& partiallyParsedExpression) {
-	std::shared_ptr<Expression> expr = parseUnaryExpression(partiallyParsedExpression);
-	Token tok;
-	std::string value;
-	for (int curPrecedence = precedence(curTok()); curPrecedence >= minPrecedence; --curPrecedence) {
-		while (precedence(curTok()) == curPrecedence) {
+Expression* Parser::parseExpression() {
+	/* Operator-precedence parsing in one loop over explicit stacks, so neither long operator
+	   chains nor nested parentheses recurse. An operator waits on m_pendingOps until one of
+	   lower precedence arrives (or, for the right-associative assignments, lower or equal),
+	   then takes its operands from m_operands. */
+	const size_t opBase = m_pendingOps.size();
+	const size_t operandBase = m_operands.size();
+	size_t openGroups = 0;
+	auto reduce = [&] {
+		PendingOp op = m_pendingOps.back();
+		m_pendingOps.pop_back();
+		Expression* rhs = m_operands.back();
+		m_operands.pop_back();
+		if (op.precedence == kPrefixPrecedence) {
+			m_operands.push_back(makeExpr<UnaryOp>(op.tok, rhs, true));
+		} else if (isAssignmentOp(op.tok)) {
+			m_operands.back() = makeExpr<Assignment>(m_operands.back(), op.tok, rhs);
+		} else {
+			m_operands.back() = makeExpr<BinaryOp>(m_operands.back(), op.tok, rhs);
+		}
+	};
+	auto reduceAbove = [&](int precedence, bool leftAssociative) {
+		while (m_pendingOps.size() > opBase) {
+			int top = m_pendingOps.back().precedence;
+			if (top == 0 || top < precedence || (top == precedence && !leftAssociative))
+				break;
+			reduce();
+		}
+	};
+
+	try {
+		for (;;) {
+			/* Operand: any prefix operators and open parentheses, then a primary expression. */
+			Token tok = curTok();
+			if (isUnaryOp(tok)) {
+				advance();
+				m_pendingOps.push_back({tok, kPrefixPrecedence});
+				continue;
+			}
+			if (tok == Token::LParen) {
+				advance();
+				m_pendingOps.push_back({tok, 0});
+				++openGroups;
+				continue;
+			}
+			m_operands.push_back(parsePostfixExpression(parsePrimaryExpression()));
+			/* A ')' closes the innermost '(' of this expression, and the group is an operand. */
+			while (openGroups > 0 && curTok() == Token::RParen) {
+				reduceAbove(1, true);
+				m_pendingOps.pop_back();
+				--openGroups;
+				advance();
+				m_operands.back() = parsePostfixExpression(m_operands.back());
+			}
+
+			/* Operator, or the end of the expression. */
 			tok = curTok();
-			try {
-				// parse binary operation
-				expectGet([](Token tok) { return isBinaryOp(tok) || isCompareOp(tok); }, value);
-				std::shared_ptr<Expression> rhs = parseBinaryExpression(curPrecedence + 1);
-				expr = std::make_shared<BinaryOp>(expr, tok, rhs);
-			} catch (ParseError& e) {
-				LOG_WARNING("Parse fails.");
-				e.print();
+			if (isInfixOp(tok) || isAssignmentOp(tok)) {
+				reduceAbove(precedence(tok), !isAssignmentOp(tok));
+				advance();
+				m_pendingOps.push_back({tok, precedence(tok)});
+				continue;
 			}
+			if (openGroups > 0)
+				throw UnexpectedToken(curTokInfo(), curLoc(), Token::RParen);
+			reduceAbove(1, true);
+			break;
 		}
+	} catch (ParseError&) {
+		m_pendingOps.resize(opBase);
+		m_operands.resize(operandBase);
+		throw;
 	}
+	ASSERT(m_operands.size() == operandBase + 1, "Unbalanced expression stacks.");
+	Expression* expr = m_operands.back();
+	m_operands.pop_back();
 	return expr;
 }
 
-std::shared_ptr<Expression> Parser::parseUnaryExpression(std::shared_ptr<Expression> const& partiallyParsedExpression) {
+Expression* Parser::parsePrimaryExpression() {
 	Token tok = curTok();
-	std::string value;
-	if (partiallyParsedExpression == nullptr && isUnaryOp(tok)) {
-		// prefix expression
-		matchGet(isUnaryOp, value);
-		std::shared_ptr<Expression> subexpr = parseUnaryExpression();
-		return std::make_shared<UnaryOp>(tok, subexpr, true);
-	} else {
-		std::shared_ptr<Expression> subexpr = parseLeftHandSideExpression(partiallyParsedExpression);
-		tok = curTok();
-		auto isCount = [](Token tok) -> bool { return tok == Token::Inc || tok == Token::Dec; };
-		if (!isCount(tok)) {
-			// not postfix expression
-			return subexpr;
-		}
-		// postfix expression
-		matchGet(isCount, value);
-		return std::make_shared<UnaryOp>(tok, subexpr, false);
+	std::string_view value;
+	if (isLiteral(tok)) {
+		// literals
+		return parseLiterial();
+	} else if (tok == Token::Identifier) {
+		// identifier
+		value = curVal();
+		advance(); // eat;
+		return makeExpr<Identifier>(m_arena.copy(value));
 	}
+	/* '(' and prefix operators are taken by parseExpression(). */
+	throw UnexpectedToken(curTokInfo(), curLoc(), [](Token tok) {
+		return isLiteral(tok) || tok == Token::Identifier || tok == Token::LParen;
+	});
 }
 
-std::shared_ptr<Expression>
-Parser::parseLeftHandSideExpression(std::shared_ptr<Expression> const& partiallyParsedExpression) {
-	std::shared_ptr<Expression> expr;
-	if (partiallyParsedExpression == nullptr) {
-		expr = parsePrimaryExpression();
-	} else {
-		expr = partiallyParsedExpression;
-	}
-
-	Token tok;
-	std::string value;
+Expression* Parser::parsePostfixExpression(Expression* expr) {
+	std::string_view value;
 	for (;;) {
-		tok = curTok();
+		Token tok = curTok();
 		switch (tok) {
 		case Token::LBrack: {
 			/* Index range. */
 			advance();
-			std::shared_ptr<Expression> index = parseExpression();
+			Expression* index = parseExpression();
 			expect(Token::RBrack);
-			expr = std::make_shared<IndexAccess>(expr, index);
+			expr = makeExpr<IndexAccess>(expr, index);
 			break;
 		}
 		case Token::Period: /* . */
@@ -389,173 +588,138 @@ Parser::parseLeftHandSideExpression(std::shared_ptr<Expression> const& partially
 			/* Access structure members. */
 			advance();
 			matchGet(Token::Identifier, value);
-			expr = std::make_shared<MemberAccess>(expr, value);
+			expr = makeExpr<MemberAccess>(expr, m_arena.copy(value));
 			break;
 		}
 		case Token::LParen: {
 			/* Function call. */
 			advance();
-			std::vector<std::shared_ptr<Expression>> args;
+			size_t mark = m_scratch.size();
 			if (curTok() != Token::RParen) {
-				args.push_back(parseExpression());
+				m_scratch.push_back(parseExpression());
 				while (curTok() == Token::Comma) {
 					advance();
-					args.push_back(parseExpression());
+					m_scratch.push_back(parseExpression());
 				}
 			}
 			expect(Token::RParen);
-			expr = std::make_shared<FunctionCall>(expr, args);
+			expr = makeExpr<FunctionCall>(expr, takeList<Expression>(mark));
 			break;
 		}
 		// case Token::LBrace: {
 		// 	LOG_WARNING("Not implemented.");
 		// }
+		case Token::Inc:
+			[[fallthrough]];
+		case Token::Dec:
+			/* Postfix expression, which ends the chain. */
+			advance();
+			return makeExpr<UnaryOp>(tok, expr, false);
 		default:
 			return expr;
 		}
 	}
 }
 
-std::shared_ptr<Expression> Parser::parseLiterial() {
+Expression* Parser::parseLiterial() {
 	Token tok = curTok();
-	std::string value;
-	std::string unit;
-
-	try {
-		expectGet(isLiteral, value);
-		switch (tok) {
-		case Token::TrueLiteral:
-			[[fallthrough]];
-		case Token::FalseLiteral:
-			/* Boolean literal. */
-			return std::make_shared<BooleanLiteral>(value);
-		case Token::IntNumber:
-			/* Number literal. */
-			return std::make_shared<NumberLiteral>(value, Type::INTEGER);
-		case Token::DoubleNumber:
-			/* Number literal. */
-			return std::make_shared<NumberLiteral>(value, Type::DOUBLE);
-		case Token::StringLiteral:
-			/* String literal. */
-			return std::make_shared<StringLiteral>(value);
-		default:
-			LOG_ERROR("Expect literal!");
-			break;
-		}
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
+	std::string_view value;
+
+	expectGet(isLiteral, value);
+	switch (tok) {
+	case Token::TrueLiteral:
+		[[fallthrough]];
+	case Token::FalseLiteral:
+		/* Boolean literal. */
+		return makeExpr<BooleanLiteral>(m_arena.copy(value));
+	case Token::IntNumber:
+		/* Number literal. */
+		return makeExpr<NumberLiteral>(m_arena.copy(value), Type::INTEGER);
+	case Token::DoubleNumber:
+		/* Number literal. */
+		return makeExpr<NumberLiteral>(m_arena.copy(value), Type::DOUBLE);
+	case Token::StringLiteral:
+		/* String literal. */
+		return makeExpr<StringLiteral>(m_arena.copy(value));
+	default:
+		LOG_ERROR("Expect literal!");
+		break;
 	}
 	return nullptr;
 }
 
-std::shared_ptr<IfStatement> Parser::parseIf() {
-	std::shared_ptr<Expression> condition;
-	std::shared_ptr<Statement> thenStatement;
-	std::shared_ptr<Statement> elseStatement;
-
-	try {
-		expect(Token::If);
-		expect(Token::LParen);
-		condition = parseExpression();
-		expect(Token::RParen);
-		thenStatement = parseStatement();
-		if (curTok() == Token::Else) {
-			advance();
-			elseStatement = parseStatement();
-		}
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
+IfStatement* Parser::parseIf() {
+	Expression* condition = nullptr;
+	Statement* thenStatement = nullptr;
+	Statement* elseStatement = nullptr;
+
+	expect(Token::If);
+	expect(Token::LParen);
+	condition = parseExpression();
+	expect(Token::RParen);
+	thenStatement = parseStatement();
+	if (curTok() == Token::Else) {
+		advance();
+		elseStatement = parseStatement();
 	}
-	return std::make_shared<IfStatement>(condition, thenStatement, elseStatement);
+	return m_arena.make<IfStatement>(condition, thenStatement, elseStatement);
 }
 
-std::shared_ptr<WhileStatement> Parser::parseWhile() {
-	std::shared_ptr<Expression> condition;
-	std::shared_ptr<Statement> body;
+WhileStatement* Parser::parseWhile() {
+	Expression* condition = nullptr;
+	Statement* body = nullptr;
 
-	try {
-		expect(Token::While);
-		expect(Token::LParen);
-		condition = parseExpression();
-		expect(Token::RParen);
-		body = parseStatement();
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<WhileStatement>(condition, body);
+	expect(Token::While);
+	expect(Token::LParen);
+	condition = parseExpression();
+	expect(Token::RParen);
+	body = parseStatement();
+	return m_arena.make<WhileStatement>(condition, body);
 }
 
-std::shared_ptr<ForStatement> Parser::parseFor() {
-	std::shared_ptr<SimpleStatement> init;
-	std::shared_ptr<Expression> condition;
-	std::shared_ptr<Expression> step;
-	std::shared_ptr<Statement> body;
-
-	try {
-		expect(Token::For);
-		expect(Token::LParen);
-		if (peekCur(isType) || peekCur(Token::Struct))
-			init = parseVariableDefinition();
-		else
-			init = parseExpressionStatement();
-		expect(Token::Semicolon);
-		condition = parseExpression();
-		expect(Token::Semicolon);
-		step = parseExpression();
-		expect(Token::RParen);
-		body = parseStatement();
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<ForStatement>(init, condition, step, body);
+ForStatement* Parser::parseFor() {
+	SimpleStatement* init = nullptr;
+	Expression* condition = nullptr;
+	Expression* step = nullptr;
+	Statement* body = nullptr;
+
+	expect(Token::For);
+	expect(Token::LParen);
+	if (peekCur(isType) || peekCur(Token::Struct))
+		init = parseVariableDefinition();
+	else
+		init = parseExpressionStatement();
+	expect(Token::Semicolon);
+	condition = parseExpression();
+	expect(Token::Semicolon);
+	step = parseExpression();
+	expect(Token::RParen);
+	body = parseStatement();
+	return m_arena.make<ForStatement>(init, condition, step, body);
 }
-std::shared_ptr<DoWhileStatement> Parser::parseDoWhile() {
-	std::shared_ptr<Expression> condition;
-	std::shared_ptr<Statement> body;
-
-	try {
-		expect(Token::Do);
-		body = parseStatement();
-		expect(Token::While);
-		expect(Token::LParen);
-		condition = parseExpression();
-		expect(Token::RParen);
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<DoWhileStatement>(condition, body);
+DoWhileStatement* Parser::parseDoWhile() {
+	Expression* condition = nullptr;
+	Statement* body = nullptr;
+
+	expect(Token::Do);
+	body = parseStatement();
+	expect(Token::While);
+	expect(Token::LParen);
+	condition = parseExpression();
+	expect(Token::RParen);
+	return m_arena.make<DoWhileStatement>(condition, body);
 }
-std::shared_ptr<ContinueStatement> Parser::parseContinue() {
-	try {
-		expect(Token::Continue);
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<ContinueStatement>();
+ContinueStatement* Parser::parseContinue() {
+	expect(Token::Continue);
+	return m_arena.make<ContinueStatement>();
 }
-std::shared_ptr<BreakStatement> Parser::parseBreak() {
-	try {
-		expect(Token::Break);
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<BreakStatement>();
+BreakStatement* Parser::parseBreak() {
+	expect(Token::Break);
+	return m_arena.make<BreakStatement>();
 }
 
-std::shared_ptr<ExpressionStatement> Parser::parseExpressionStatement() {
-	std::shared_ptr<Expression> expr;
-	try {
-		expr = parseExpression();
-	} catch (ParseError& e) {
-		LOG_WARNING("Parse fails.");
-		e.print();
-	}
-	return std::make_shared<ExpressionStatement>(expr);
+ExpressionStatement* Parser::parseExpressionStatement() {
+	Expression* expr = nullptr;
+	expr = parseExpression();
+	return m_arena.make<ExpressionStatement>(expr);
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "preprocess/IncludeCache.h"
+#include <system_error>
+
+using namespace minisolc;
+
+std::string IncludeCache::canonicalName(const std::filesystem::path& path) {
+	std::error_code ec;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+	return ec ? path.lexically_normal().string() : canonical.string();
+}
+
+std::shared_ptr<const SourceFile> IncludeCache::load(const std::filesystem::path& path, bool* hit) {
+	if (hit != nullptr) {
+		*hit = false;
+	}
+	std::error_code ec;
+	std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, ec);
+	if (ec) {
+		return nullptr;
+	}
+	std::string key = canonicalName(path);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_files.find(key);
+		if (it != m_files.end() && it->second->mtime == mtime) {
+			++m_hits;
+			if (hit != nullptr) {
+				*hit = true;
+			}
+			return it->second;
+		}
+	}
+	/* Read outside the lock so that different files load concurrently. */
+	std::shared_ptr<const SourceFile> source = read(path, mtime);
+	if (source != nullptr) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_files[key] = source;
+	}
+	return source;
+}
+
+std::shared_ptr<const SourceFile> IncludeCache::read(
+	const std::filesystem::path& path, std::filesystem::file_time_type mtime) {
+	std::shared_ptr<MappedFile> file = MappedFile::open(path);
+	if (file == nullptr) {
+		return nullptr;
+	}
+	auto source = std::make_shared<SourceFile>();
+	source->file = file;
+	source->mtime = mtime;
+	std::string_view content = file->view();
+	source->terminated = content.empty() || content.back() == '\n';
+	for (size_t pos = 0; pos < content.size();) {
+		size_t eol = content.find('\n', pos);
+		std::string_view line = content.substr(pos, eol == std::string_view::npos ? std::string_view::npos : eol - pos);
+		pos = (eol == std::string_view::npos) ? content.size() : eol + 1;
+		if (!line.empty() && line.front() == '#') {
+			source->hasDirective = true;
+		}
+		source->lines.push_back(line);
+	}
+	return source;
+}
@@ -0,0 +1,293 @@
+#include "preprocess/MacroExpander.h"
+#include "common/Defs.h"
+#include <cctype>
+
+using namespace minisolc;
+
+static bool isIdentStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+static bool isIdentChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+static size_t skipSpaces(std::string_view text, size_t i) {
+	while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+		++i;
+	}
+	return i;
+}
+
+static std::string_view trim(std::string_view text) {
+	size_t begin = skipSpaces(text, 0);
+	size_t end = text.size();
+	while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+		--end;
+	}
+	return text.substr(begin, end - begin);
+}
+
+/* Index just past the string literal starting at text[i]. Like the lexer, the first
+   following '"' closes the literal. */
+static size_t skipString(std::string_view text, size_t i) {
+	size_t end = text.find('"', i + 1);
+	return end == std::string_view::npos ? text.size() : end + 1;
+}
+
+/* Index just past the number starting at text[i], so that e.g. the "xFF" of "0xFF"
+   is never mistaken for an identifier. */
+static size_t skipNumber(std::string_view text, size_t i) {
+	while (i < text.size() && (isIdentChar(text[i]) || text[i] == '.')) {
+		++i;
+	}
+	return i;
+}
+
+static size_t skipIdentifier(std::string_view text, size_t i) {
+	while (i < text.size() && isIdentChar(text[i])) {
+		++i;
+	}
+	return i;
+}
+
+/* Whether text mentions any identifier, i.e. whether an expansion of it must be rescanned. */
+static bool containsIdentifier(std::string_view text) {
+	for (size_t i = 0; i < text.size();) {
+		if (text[i] == '"') {
+			i = skipString(text, i);
+		} else if (std::isdigit(static_cast<unsigned char>(text[i]))) {
+			i = skipNumber(text, i);
+		} else if (isIdentStart(text[i])) {
+			return true;
+		} else {
+			++i;
+		}
+	}
+	return false;
+}
+
+/* Split the parenthesized argument list starting at or after text[i]. On success i is
+   moved past the closing ')'. */
+static bool parseArguments(std::string_view text, size_t& i, std::vector<std::string_view>& args) {
+	size_t pos = skipSpaces(text, i);
+	if (pos >= text.size() || text[pos] != '(') {
+		return false;
+	}
+	int depth = 1;
+	size_t start = ++pos;
+	while (pos < text.size()) {
+		char c = text[pos];
+		if (c == '"') {
+			pos = skipString(text, pos);
+			continue;
+		}
+		if (c == '(') {
+			++depth;
+		} else if (c == ')' && --depth == 0) {
+			args.push_back(trim(text.substr(start, pos - start)));
+			i = pos + 1;
+			return true;
+		} else if (c == ',' && depth == 1) {
+			args.push_back(trim(text.substr(start, pos - start)));
+			start = pos + 1;
+		}
+		++pos;
+	}
+	return false;
+}
+
+bool MacroExpander::define(std::string_view directive) {
+	size_t i = skipSpaces(directive, 0);
+	if (directive.compare(i, 7, "#define") != 0) {
+		return false;
+	}
+	i += 7;
+	if (i < directive.size() && !std::isspace(static_cast<unsigned char>(directive[i]))) {
+		return false;
+	}
+	i = skipSpaces(directive, i);
+	if (i >= directive.size() || !isIdentStart(directive[i])) {
+		return false;
+	}
+	size_t nameEnd = skipIdentifier(directive, i);
+
+	auto macro = std::make_unique<Macro>();
+	macro->name = std::string(directive.substr(i, nameEnd - i));
+	i = nameEnd;
+	if (i < directive.size() && directive[i] == '(') {
+		/* Function-like macro: the parameter list must follow the name immediately. */
+		macro->functionLike = true;
+		i = skipSpaces(directive, i + 1);
+		if (i < directive.size() && directive[i] == ')') {
+			++i;
+		} else {
+			for (;;) {
+				if (i >= directive.size() || !isIdentStart(directive[i])) {
+					return false;
+				}
+				size_t paramEnd = skipIdentifier(directive, i);
+				macro->params.emplace_back(directive.substr(i, paramEnd - i));
+				i = skipSpaces(directive, paramEnd);
+				if (i < directive.size() && directive[i] == ',') {
+					i = skipSpaces(directive, i + 1);
+				} else if (i < directive.size() && directive[i] == ')') {
+					++i;
+					break;
+				} else {
+					return false;
+				}
+			}
+		}
+	}
+	macro->body = std::string(trim(directive.substr(i)));
+	macro->rescan = macro->functionLike || containsIdentifier(macro->body);
+
+	std::string_view key = macro->name;
+	m_macros.erase(key);
+	m_macros.emplace(key, std::move(macro));
+	return true;
+}
+
+bool MacroExpander::expand(std::string_view line, std::string& out) {
+	out.clear();
+	return expandText(line, out, true);
+}
+
+const Macro* MacroExpander::find(std::string_view name) const {
+	auto it = m_macros.find(name);
+	return it == m_macros.end() ? nullptr : it->second.get();
+}
+
+bool MacroExpander::isActive(const Macro* macro) const {
+	for (const Macro* active: m_active) {
+		if (active == macro) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Copies text to out with every macro use expanded. Nothing is written until the first
+   macro is found, so unchanged text costs a single scan. */
+bool MacroExpander::expandText(std::string_view text, std::string& out, bool trackComments) {
+	bool changed = false;
+	size_t flushed = 0;
+	size_t i = 0;
+	std::vector<std::string_view> args;
+	while (i < text.size()) {
+		if (trackComments && m_inBlockComment) {
+			size_t end = text.find("*/", i);
+			if (end == std::string_view::npos) {
+				break;
+			}
+			m_inBlockComment = false;
+			i = end + 2;
+			continue;
+		}
+
+		char c = text[i];
+		if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+			break;
+		} else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+			i += 2;
+			if (trackComments) {
+				m_inBlockComment = true;
+			} else {
+				size_t end = text.find("*/", i);
+				i = (end == std::string_view::npos) ? text.size() : end + 2;
+			}
+			continue;
+		} else if (c == '"') {
+			i = skipString(text, i);
+			continue;
+		} else if (std::isdigit(static_cast<unsigned char>(c))) {
+			i = skipNumber(text, i);
+			continue;
+		} else if (!isIdentStart(c)) {
+			++i;
+			continue;
+		}
+
+		size_t start = i;
+		i = skipIdentifier(text, i);
+		const Macro* macro = find(text.substr(start, i - start));
+		if (macro == nullptr || isActive(macro)) {
+			continue;
+		}
+		size_t end = i;
+		args.clear();
+		if (macro->functionLike) {
+			if (!parseArguments(text, end, args)) {
+				/* The name alone is not an invocation. */
+				continue;
+			}
+			if (args.size() == 1 && args[0].empty() && macro->params.empty()) {
+				args.clear();
+			}
+			if (args.size() != macro->params.size()) {
+				LOG_WARNING("Macro %s expects %zu arguments, got %zu.", macro->name.c_str(), macro->params.size(), args.size());
+				continue;
+			}
+		}
+
+		out.append(text.data() + flushed, start - flushed);
+		substitute(*macro, args, out);
+		flushed = end;
+		i = end;
+		changed = true;
+	}
+	if (changed) {
+		out.append(text.data() + flushed, text.size() - flushed);
+	}
+	return changed;
+}
+
+void MacroExpander::substitute(const Macro& macro, const std::vector<std::string_view>& args, std::string& out) {
+	if (!macro.rescan) {
+		out += macro.body;
+		return;
+	}
+
+	std::string replaced;
+	std::string_view body = macro.body;
+	if (!args.empty()) {
+		/* Arguments are fully expanded before they replace the parameters. */
+		std::vector<std::string> expandedArgs(args.size());
+		for (size_t k = 0; k < args.size(); ++k) {
+			if (!expandText(args[k], expandedArgs[k], false)) {
+				expandedArgs[k] = std::string(args[k]);
+			}
+		}
+		for (size_t i = 0; i < body.size();) {
+			size_t next;
+			if (body[i] == '"') {
+				next = skipString(body, i);
+			} else if (std::isdigit(static_cast<unsigned char>(body[i]))) {
+				next = skipNumber(body, i);
+			} else if (isIdentStart(body[i])) {
+				next = skipIdentifier(body, i);
+				std::string_view ident = body.substr(i, next - i);
+				size_t k = 0;
+				while (k < macro.params.size() && macro.params[k] != ident) {
+					++k;
+				}
+				if (k < macro.params.size()) {
+					replaced += expandedArgs[k];
+					i = next;
+					continue;
+				}
+			} else {
+				next = i + 1;
+			}
+			replaced.append(body.data() + i, next - i);
+			i = next;
+		}
+		body = replaced;
+	}
+
+	/* Rescan the result with this macro disabled, so recursive definitions stop. */
+	m_active.push_back(&macro);
+	std::string rescanned;
+	if (expandText(body, rescanned, false)) {
+		out += rescanned;
+	} else {
+		out.append(body.data(), body.size());
+	}
+	m_active.pop_back();
+}
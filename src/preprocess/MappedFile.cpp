@@ -0,0 +1,68 @@
+#include "preprocess/MappedFile.h"
+#include "common/Defs.h"
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace minisolc;
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+	std::shared_ptr<MappedFile> file(new MappedFile());
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		::close(fd);
+		return nullptr;
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	if (size != 0 && size % pageSize != 0) {
+		/* The tail of the last page is zero-filled, so data()[size()] is a NUL. */
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			madvise(mapping, size, MADV_SEQUENTIAL);
+			file->m_mapping = mapping;
+			file->m_mappingSize = size;
+			file->m_data = static_cast<const char*>(mapping);
+			file->m_size = size;
+		}
+	}
+	::close(fd);
+	if (file->m_mapping != nullptr) {
+		return file;
+	}
+#endif
+	if (!file->readFallback(path)) {
+		return nullptr;
+	}
+	return file;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+	if (m_mapping != nullptr) {
+		munmap(m_mapping, m_mappingSize);
+	}
+#endif
+}
+
+bool MappedFile::readFallback(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	m_fallback = std::string((std::istreambuf_iterator<char>(file)), (std::istreambuf_iterator<char>()));
+	m_data = m_fallback.c_str();
+	m_size = m_fallback.size();
+	return true;
+}
@@ -1,52 +1,144 @@
 #include "preprocess/Preprocess.h"
 #include "common/Defs.h"
+#include "common/ThreadPool.h"
 #include <cstdio>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <memory>
-#include <sstream>
+#include <string_view>
 
 
 using namespace minisolc;
 
+/* The quoted file name of an #include directive. */
+static bool includeTarget(std::string_view line, std::string_view& name) {
+	size_t pos = line.find_first_of('"');
+	size_t rightpos = line.find_last_of('"');
+	if (pos == std::string_view::npos || rightpos == pos) {
+		return false;
+	}
+	name = line.substr(pos + 1, rightpos - pos - 1);
+	return true;
+}
+
 void Preprocess::preprocess(std::filesystem::path filePath, std::shared_ptr<Line> includeLine) {
+	/* Every file is included at most once per translation unit; one that fails to open is not
+	   marked, so each further #include of it warns again. */
+	std::string canonicalName = IncludeCache::canonicalName(filePath);
+	if (m_included.count(canonicalName) != 0) {
+		++m_skippedIncludes;
+		return;
+	}
 	std::filesystem::path dirPath = filePath.parent_path();
-	std::ifstream file(filePath);
-	std::string content;
-
-	if (file.is_open()) {
-		/* load input file stream into string */
-		content = std::string((std::istreambuf_iterator<char>(file)), (std::istreambuf_iterator<char>()));
-		file.close();
-	} else {
+	std::shared_ptr<const SourceFile> source = m_cache->load(filePath);
+	if (source == nullptr) {
 		LOG_WARNING("Program does not open file %s", filePath.string().c_str());
 		return;
 	}
+	m_included.insert(std::move(canonicalName));
+	if (includeLine == nullptr && source->hasDirective) {
+		prefetchIncludes(filePath, *source);
+	}
+
+	std::string fileName = getRelativePath(filePath).string();
 
+	if (includeLine == nullptr && m_stream.empty() && m_macros.empty() && !source->hasDirective && source->terminated) {
+		/* Nothing to rewrite: lex straight out of the mapped file. */
+		m_stream.adopt(source->file, fileName);
+		logSuccess();
+		return;
+	}
+
+	m_stream.reserve(m_stream.size() + source->file->size() + 1);
+	bool inSegment = false;
 	size_t lineNumber = 0;
-	std::string line;
-	std::stringstream ss(content);
-	while (getline(ss, line, '\n')) {
-		std::shared_ptr<Line> linePtr
-			= std::make_shared<Line>(line + "\n", ++lineNumber, getRelativePath(filePath).string(), includeLine);
-		if (line.find("#include") == 0) {
-			processInclude(line, dirPath, linePtr);
-		} else if (line.find("#define") == 0) {
-			processDefine(line);
+	bool inBlockComment = m_macros.inBlockComment();
+	m_macros.setInBlockComment(false);
+	std::string rewritten;
+	for (std::string_view line: source->lines) {
+		++lineNumber;
+
+		if (line.compare(0, 8, "#include") == 0) {
+			std::shared_ptr<Line> linePtr
+				= std::make_shared<Line>(std::string(line) + "\n", lineNumber, fileName, includeLine);
+			processInclude(std::string(line), dirPath, linePtr);
+			inSegment = false;
+			continue;
+		} else if (line.compare(0, 7, "#define") == 0) {
+			processDefine(std::string(line));
+			inSegment = false;
+			continue;
+		}
+
+		if (!inSegment) {
+			m_stream.beginSegment(fileName, lineNumber, includeLine);
+			inSegment = true;
+		}
+		/* Only lines that actually use a macro are materialized. */
+		if (!m_macros.empty() && m_macros.expand(line, rewritten)) {
+			m_stream.appendLine(rewritten);
 		} else {
-			for (const auto& define: m_defines) {
-				size_t pos = linePtr->source.find(define.first);
-				while (pos != std::string::npos) {
-					linePtr->source.replace(pos, define.first.length(), define.second);
-					pos = linePtr->source.find(define.first, pos + define.second.length());
+			m_stream.appendLine(line);
+		}
+	}
+	m_macros.setInBlockComment(inBlockComment);
+
+	if (includeLine == nullptr) {
+		logSuccess();
+	}
+}
+
+/* Macro expansion depends on the order of the #defines, so files are spliced one after
+   another. Reading and splitting them does not: the include graph is walked breadth-first
+   and each level is loaded into the cache concurrently, leaving the splice to cache hits. */
+void Preprocess::prefetchIncludes(const std::filesystem::path& root, const SourceFile& rootSource) {
+	std::unordered_set<std::string> seen {IncludeCache::canonicalName(root)};
+	std::vector<std::filesystem::path> level;
+	auto discover = [&](const std::filesystem::path& path, const SourceFile& source) {
+		for (std::string_view line: source.lines) {
+			std::string_view name;
+			if (line.compare(0, 8, "#include") == 0 && includeTarget(line, name)) {
+				std::filesystem::path target = path.parent_path() / name;
+				if (seen.insert(IncludeCache::canonicalName(target)).second) {
+					level.push_back(target);
 				}
 			}
-			m_stream.push_back(linePtr);
 		}
+	};
+	discover(root, rootSource);
+	if (level.empty()) {
+		return;
 	}
 
-	LOG_INFO("Preprocess Succeeds.");
+	ThreadPool pool;
+	while (!level.empty()) {
+		std::vector<std::filesystem::path> current;
+		current.swap(level);
+		std::vector<std::future<std::pair<std::shared_ptr<const SourceFile>, bool>>> loads;
+		loads.reserve(current.size());
+		for (const std::filesystem::path& path: current) {
+			loads.push_back(pool.submit([this, path] {
+				bool hit = false;
+				std::shared_ptr<const SourceFile> source = m_cache->load(path, &hit);
+				return std::make_pair(source, hit);
+			}));
+		}
+		for (size_t i = 0; i < current.size(); ++i) {
+			auto [source, hit] = loads[i].get();
+			if (source == nullptr) {
+				continue;
+			}
+			if (hit) {
+				++m_cachedIncludes;
+			}
+			discover(current[i], *source);
+		}
+	}
+}
+
+void Preprocess::logSuccess() const {
+	size_t served = m_skippedIncludes + m_cachedIncludes;
+	LOG_INFO("Preprocess Succeeds. %zu of %zu includes served from cache.", served, m_includes);
 }
 
 std::filesystem::path Preprocess::getRelativePath(std::filesystem::path path) const {
@@ -61,26 +153,18 @@ std::filesystem::path Preprocess::getRelativePath(std::filesystem::path path) co
 
 void Preprocess::processInclude(
 	const std::string& line, std::filesystem::path parentPath, std::shared_ptr<Line> includeLine) {
-	size_t pos = line.find_first_of('"');
-	size_t rightpos = line.find_last_of('"');
-	if (pos == std::string::npos || rightpos == std::string::npos) {
+	std::string_view filename;
+	if (!includeTarget(line, filename)) {
 		LOG_WARNING("Invalid include directive %s", line.c_str());
 		return;
 	}
-	std::string filename = line.substr(pos + 1, rightpos - pos - 1);
 	std::filesystem::path filePath = parentPath / filename;
+	++m_includes;
 	preprocess(filePath, includeLine);
 }
 
 void Preprocess::processDefine(const std::string& line) {
-	std::stringstream ss(line);
-	std::string keyword, key, value;
-
-	ss >> keyword >> key >> value;
-
-	if (keyword == "#define" && !key.empty() && !value.empty()) {
-		m_defines[key] = value;
-	} else {
+	if (!m_macros.define(line)) {
 		LOG_WARNING("Invalid #define format %s.", line.c_str());
 	}
 }
@@ -0,0 +1,325 @@
+#include "typesystem/ConstantFolder.h"
+#include "common/Defs.h"
+#include "lexer/Token.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+
+using namespace minisolc;
+
+namespace {
+
+/* The width CodeGenerator gives the literal's value: iN for an N-bit integer, i1 for bool. */
+bool isBool(const llvm::APInt& value) { return value.getBitWidth() == 1; }
+
+/* The integer type of a folded operand: its width, signed as the type system says. Bools are unsigned. */
+IntegerType integerTypeOf(const Expression* expr, const llvm::APInt& value) {
+	return {static_cast<uint16_t>(value.getBitWidth()), !isBool(value) && expr->GetIntType().isSigned};
+}
+
+/* What CodeGenerator::convertInteger makes of value. */
+llvm::APInt convert(const llvm::APInt& value, uint16_t bits, bool isSigned) {
+	return isSigned ? value.sextOrTrunc(bits) : value.zextOrTrunc(bits);
+}
+
+}
+
+std::optional<llvm::APInt> minisolc::parseIntegerLiteral(std::string_view text, uint16_t bits) {
+	bool negative = !text.empty() && text.front() == '-';
+	if (negative)
+		text.remove_prefix(1);
+	unsigned radix = 10;
+	if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+		radix = 16;
+		text.remove_prefix(2);
+	} else if (text.size() > 1 && text[0] == '0') {
+		radix = 8;
+	}
+	llvm::APInt value;
+	if (text.empty() || llvm::StringRef(text.data(), text.size()).getAsInteger(radix, value)
+		|| value.getActiveBits() > bits)
+		return std::nullopt;
+	value = value.zextOrTrunc(bits);
+	return negative ? -value : value;
+}
+
+ConstantFolder::ConstantFolder(BaseAST* root) {
+	foldStatement(root);
+	LOG_INFO("Constant folding replaced %zu expressions.", m_folded);
+}
+
+std::optional<llvm::APInt> ConstantFolder::constantValue(const Expression* expr) {
+	if (const BooleanLiteral* literal = astCast<BooleanLiteral>(expr))
+		return llvm::APInt(1, literal->GetValue() == "true");
+	const NumberLiteral* literal = astCast<NumberLiteral>(expr);
+	if (literal == nullptr || literal->GetType() != Type::INTEGER)
+		return std::nullopt;
+	/* One that does not fit is reported by code generation. */
+	return parseIntegerLiteral(literal->GetValue(), literal->GetIntType().bits);
+}
+
+Expression* ConstantFolder::makeLiteral(const llvm::APInt& value, const Expression* replaced) {
+	Expression* literal;
+	bool isSigned = replaced->GetIntType().isSigned;
+	if (isBool(value))
+		literal = m_arena.make<BooleanLiteral>(value.isOne() ? "true" : "false");
+	else
+		literal = m_arena.make<NumberLiteral>(m_arena.copy(llvm::toString(value, 10, isSigned)), Type::INTEGER);
+	literal->SetType(replaced->GetType());
+	literal->SetCastType(replaced->GetCastType());
+	literal->SetIntType({static_cast<uint16_t>(value.getBitWidth()), isSigned});
+	++m_folded;
+	return literal;
+}
+
+Expression* ConstantFolder::visitSourceUnit(SourceUnit* node) {
+	for (BaseAST* child: node->getSubNodes())
+		foldStatement(child);
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitPlainVariableDefinition(PlainVariableDefinition* node) {
+	if (node->getVarDefExpr() == nullptr)
+		return nullptr;
+	node->setVarDefExpr(fold(node->getVarDefExpr()));
+	if (node->IsAssigned())
+		return nullptr;
+	/* Only a value of the declared kind: anything else is stored with a conversion, or not at all. */
+	std::optional<llvm::APInt> value = constantValue(node->getVarDefExpr());
+	TypeName* type = node->GetDeclarationType();
+	if (value
+		&& ((isIntegerType(type->GetType()) && value->getBitWidth() == type->GetBits() && !isBool(*value))
+			|| (type->GetType() == Token::Bool && isBool(*value)))) {
+		if (node->GetSlot() >= m_constants.size())
+			m_constants.resize(node->GetSlot() + 1);
+		m_constants[node->GetSlot()] = value;
+	}
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitArrayDefinition(ArrayDefinition* node) {
+	node->SetArraySize(fold(node->GetArraySize()));
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitStructDefinition(StructDefinition* node) {
+	if (node->GetInitExpr() != nullptr)
+		node->SetInitExpr(fold(node->GetInitExpr()));
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitBlock(Block* node) {
+	for (Statement* statement: node->GetStatements())
+		foldStatement(statement);
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitFunctionDefinition(FunctionDefinition* node) {
+	foldStatement(node->GetBody());
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitReturnStatement(ReturnStatement* node) {
+	if (node->GetExpr() != nullptr)
+		node->SetExpr(fold(node->GetExpr()));
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitIdentifier(Identifier* node) {
+	if (node->GetSlot() < m_constants.size() && m_constants[node->GetSlot()])
+		return makeLiteral(*m_constants[node->GetSlot()], node);
+	return node;
+}
+
+Expression* ConstantFolder::visitAssignment(Assignment* node) {
+	/* The target stays as it is; only the subscript of an indexed target is a value. */
+	if (IndexAccess* target = astCast<IndexAccess>(node->GetLeftHand()))
+		visitIndexAccess(target);
+	node->SetRightHand(fold(node->GetRightHand()));
+	return node;
+}
+
+Expression* ConstantFolder::visitBinaryOp(BinaryOp* node) {
+	node->SetLeftHand(fold(node->GetLeftHand()));
+	node->SetRightHand(fold(node->GetRightHand()));
+	std::optional<llvm::APInt> lhs = constantValue(node->GetLeftHand());
+	std::optional<llvm::APInt> rhs = constantValue(node->GetRightHand());
+	if (!lhs || !rhs)
+		return node;
+	/* Operands are converted as CodeGenerator::visitBinaryOp does. */
+	Token op = node->GetOp();
+	IntegerType leftType = integerTypeOf(node->GetLeftHand(), *lhs);
+	IntegerType rightType = integerTypeOf(node->GetRightHand(), *rhs);
+	bool isSigned = false;
+	if (op == Token::Exp) {
+		isSigned = leftType.isSigned;
+	} else if (isShiftOp(op)) {
+		if (rhs->uge(leftType.bits))
+			return node;
+		isSigned = leftType.isSigned;
+		*rhs = convert(*rhs, leftType.bits, false);
+	} else if (op != Token::Comma && op != Token::Or && op != Token::And) {
+		IntegerType common = commonIntegerType(leftType, rightType);
+		isSigned = common.isSigned;
+		*lhs = convert(*lhs, common.bits, leftType.isSigned);
+		*rhs = convert(*rhs, common.bits, rightType.isSigned);
+	}
+	llvm::APInt result;
+	switch (op) {
+	case Token::Comma:
+		result = *rhs;
+		break;
+	case Token::Or:
+	case Token::And:
+		if (!isBool(*lhs) || !isBool(*rhs))
+			return node;
+		result = node->GetOp() == Token::Or ? (*lhs | *rhs) : (*lhs & *rhs);
+		break;
+	case Token::BitOr:
+		result = *lhs | *rhs;
+		break;
+	case Token::BitXor:
+		result = *lhs ^ *rhs;
+		break;
+	case Token::BitAnd:
+		result = *lhs & *rhs;
+		break;
+	case Token::SHL:
+		result = lhs->shl(*rhs);
+		break;
+	case Token::SAR:
+		result = isSigned ? lhs->ashr(*rhs) : lhs->lshr(*rhs);
+		break;
+	case Token::SHR:
+		result = lhs->lshr(*rhs);
+		break;
+	case Token::Add:
+		result = *lhs + *rhs;
+		break;
+	case Token::Sub:
+		result = *lhs - *rhs;
+		break;
+	case Token::Mul:
+		result = *lhs * *rhs;
+		break;
+	case Token::Div:
+	case Token::Mod:
+		if (rhs->isZero())
+			return node;
+		if (op == Token::Div)
+			result = isSigned ? lhs->sdiv(*rhs) : lhs->udiv(*rhs);
+		else
+			result = isSigned ? lhs->srem(*rhs) : lhs->urem(*rhs);
+		break;
+	case Token::Exp: {
+		/* Square and multiply, wrapping at the base's width; the exponent is unsigned. */
+		llvm::APInt power = *lhs;
+		result = llvm::APInt(lhs->getBitWidth(), 1);
+		for (unsigned bit = 0, bits = rhs->getActiveBits(); bit < bits; ++bit) {
+			if ((*rhs)[bit])
+				result *= power;
+			power *= power;
+		}
+		break;
+	}
+	case Token::Equal:
+		result = llvm::APInt(1, lhs->eq(*rhs));
+		break;
+	case Token::NotEqual:
+		result = llvm::APInt(1, lhs->ne(*rhs));
+		break;
+	case Token::LessThan:
+		result = llvm::APInt(1, isSigned ? lhs->slt(*rhs) : lhs->ult(*rhs));
+		break;
+	case Token::LessThanOrEqual:
+		result = llvm::APInt(1, isSigned ? lhs->sle(*rhs) : lhs->ule(*rhs));
+		break;
+	case Token::GreaterThan:
+		result = llvm::APInt(1, isSigned ? lhs->sgt(*rhs) : lhs->ugt(*rhs));
+		break;
+	case Token::GreaterThanOrEqual:
+		result = llvm::APInt(1, isSigned ? lhs->sge(*rhs) : lhs->uge(*rhs));
+		break;
+	default:
+		return node;
+	}
+	return makeLiteral(result, node);
+}
+
+Expression* ConstantFolder::visitUnaryOp(UnaryOp* node) {
+	/* ++ and -- need their operand as a variable. */
+	if (node->GetOp() == Token::Inc || node->GetOp() == Token::Dec)
+		return node;
+	node->SetExpr(fold(node->GetExpr()));
+	std::optional<llvm::APInt> value = constantValue(node->GetExpr());
+	if (!value)
+		return node;
+	switch (node->GetOp()) {
+	case Token::Sub:
+		return makeLiteral(-*value, node);
+	case Token::Not:
+	case Token::BitNot:
+		return makeLiteral(~*value, node);
+	default:
+		return node;
+	}
+}
+
+Expression* ConstantFolder::visitIfStatement(IfStatement* node) {
+	node->SetCondition(fold(node->GetCondition()));
+	std::optional<llvm::APInt> condition = constantValue(node->GetCondition());
+	/* A dead branch goes only if it is a block: a bare declaration would still be in scope after the if. */
+	if (condition && isBool(*condition)) {
+		if (condition->isOne() && astCast<Block>(node->GetElseStatement()) != nullptr)
+			node->SetElseStatement(nullptr);
+		else if (condition->isZero() && astCast<Block>(node->GetThenStatement()) != nullptr)
+			node->SetThenStatement(nullptr);
+	}
+	foldStatement(node->GetThenStatement());
+	foldStatement(node->GetElseStatement());
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitWhileStatement(WhileStatement* node) {
+	node->SetConditionExpr(fold(node->GetConditionExpr()));
+	foldStatement(node->GetWhileLoopBody());
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitForStatement(ForStatement* node) {
+	foldStatement(node->GetInitExpr());
+	node->SetConditionExpr(fold(node->GetConditionExpr()));
+	if (node->GetUpdateExpr() != nullptr)
+		node->SetUpdateExpr(fold(node->GetUpdateExpr()));
+	foldStatement(node->GetForLoopBody());
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitDoWhileStatement(DoWhileStatement* node) {
+	foldStatement(node->GetDoWhileLoopBody());
+	node->SetConditionExpr(fold(node->GetConditionExpr()));
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitExpressionStatement(ExpressionStatement* node) {
+	node->SetExpr(fold(node->GetExpr()));
+	return nullptr;
+}
+
+Expression* ConstantFolder::visitIndexAccess(IndexAccess* node) {
+	node->SetArrayIndex(fold(node->GetArrayIndex()));
+	return node;
+}
+
+Expression* ConstantFolder::visitFunctionCall(FunctionCall* node) {
+	std::vector<Expression*> args(node->GetArgs().begin(), node->GetArgs().end());
+	bool changed = false;
+	for (Expression*& arg: args) {
+		Expression* folded = fold(arg);
+		changed |= folded != arg;
+		arg = folded;
+	}
+	if (changed)
+		node->SetArgs(m_arena.list(args));
+	return node;
+}
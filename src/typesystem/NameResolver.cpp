@@ -0,0 +1,133 @@
+#include "typesystem/NameResolver.h"
+#include "common/Defs.h"
+
+using namespace minisolc;
+
+void NameResolver::declare(Declaration* declaration) {
+	declaration->SetSlot(static_cast<uint32_t>(m_declarations.size()));
+	declaration->SetAssigned(false);
+	m_declarations.push_back(declaration);
+	/* A redeclaration still takes over the name, as the later definition did in codegen. */
+	if (!m_scopes.declare(declaration->GetName(), declaration->GetSlot())) {
+		LOG_ERROR("Redefinition!");
+		m_scopes.assign(declaration->GetName(), declaration->GetSlot());
+	}
+}
+
+void NameResolver::markAssigned(Expression* target) {
+	const Identifier* id = astCast<Identifier>(target);
+	if (id != nullptr && id->GetSlot() < m_declarations.size())
+		m_declarations[id->GetSlot()]->SetAssigned(true);
+}
+
+void NameResolver::visitSourceUnit(SourceUnit* node) {
+	for (BaseAST* child: node->getSubNodes())
+		resolve(child);
+}
+
+void NameResolver::visitPlainVariableDefinition(PlainVariableDefinition* node) {
+	declare(node);
+	resolve(node->getVarDefExpr());
+}
+
+void NameResolver::visitArrayDefinition(ArrayDefinition* node) {
+	resolve(node->GetArraySize());
+	declare(node);
+}
+
+void NameResolver::visitStructDefinition(StructDefinition* node) {
+	/* Members of a struct type are not variables; only a struct variable is declared. */
+	if (!node->GetisVariable())
+		return;
+	declare(node);
+	resolve(node->GetInitExpr());
+}
+
+void NameResolver::visitBlock(Block* node) {
+	m_scopes.pushScope();
+	for (BaseAST* statement: node->GetStatements())
+		resolve(statement);
+	m_scopes.popScope();
+}
+
+void NameResolver::visitFunctionDefinition(FunctionDefinition* node) {
+	m_scopes.pushScope();
+	if (node->GetParameterList() != nullptr) {
+		for (VariableDefinition* parameter: node->GetParameterList()->GetArgs())
+			resolve(parameter);
+	}
+	if (node->GetBody() != nullptr) {
+		for (BaseAST* statement: node->GetBody()->GetStatements())
+			resolve(statement);
+	}
+	m_scopes.popScope();
+	declare(node);
+}
+
+void NameResolver::visitReturnStatement(ReturnStatement* node) { resolve(node->GetExpr()); }
+
+void NameResolver::visitIdentifier(Identifier* node) {
+	if (const uint32_t* slot = m_scopes.find(node->GetValue()))
+		node->SetSlot(*slot);
+}
+
+void NameResolver::visitAssignment(Assignment* node) {
+	resolve(node->GetLeftHand());
+	resolve(node->GetRightHand());
+	markAssigned(node->GetLeftHand());
+}
+
+void NameResolver::visitBinaryOp(BinaryOp* node) {
+	resolve(node->GetLeftHand());
+	resolve(node->GetRightHand());
+}
+
+void NameResolver::visitUnaryOp(UnaryOp* node) {
+	resolve(node->GetExpr());
+	if (node->GetOp() == Token::Inc || node->GetOp() == Token::Dec)
+		markAssigned(node->GetExpr());
+}
+
+void NameResolver::visitIfStatement(IfStatement* node) {
+	resolve(node->GetCondition());
+	resolve(node->GetThenStatement());
+	resolve(node->GetElseStatement());
+}
+
+void NameResolver::visitWhileStatement(WhileStatement* node) {
+	resolve(node->GetConditionExpr());
+	m_scopes.pushScope();
+	resolve(node->GetWhileLoopBody());
+	m_scopes.popScope();
+}
+
+void NameResolver::visitForStatement(ForStatement* node) {
+	resolve(node->GetInitExpr());
+	resolve(node->GetConditionExpr());
+	m_scopes.pushScope();
+	resolve(node->GetForLoopBody());
+	m_scopes.popScope();
+	resolve(node->GetUpdateExpr());
+}
+
+void NameResolver::visitDoWhileStatement(DoWhileStatement* node) {
+	m_scopes.pushScope();
+	resolve(node->GetDoWhileLoopBody());
+	m_scopes.popScope();
+	resolve(node->GetConditionExpr());
+}
+
+void NameResolver::visitExpressionStatement(ExpressionStatement* node) { resolve(node->GetExpr()); }
+
+void NameResolver::visitIndexAccess(IndexAccess* node) {
+	resolve(node->GetArrayName());
+	resolve(node->GetArrayIndex());
+}
+
+void NameResolver::visitFunctionCall(FunctionCall* node) {
+	resolve(node->GetCallee());
+	for (Expression* arg: node->GetArgs())
+		resolve(arg);
+}
+
+void NameResolver::visitMemberAccess(MemberAccess* node) { resolve(node->GetStructVarExpr()); }
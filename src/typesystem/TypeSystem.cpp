@@ -6,442 +6,507 @@
 #include <string>
 using namespace minisolc;
 
-void TypeSystem::setType(std::string identifier, Type type) {
-	auto& map = m_maps.back();
-	if (map.find(identifier) == map.end()) {
-		// Don't find
-		map.insert({identifier, type});
-	} else {
-		LOG_ERROR("Redefinition!");
-	}
+void TypeSystem::setType(uint32_t slot, Type type, IntegerType intType) {
+	if (slot >= m_types.size())
+		m_types.resize(slot + 1);
+	m_types[slot] = SlotType{type, intType};
 }
 
-Type TypeSystem::getType(std::string identifier) {
-	for (auto it = m_maps.rbegin(); it != m_maps.rend(); ++it) {
-		auto& map = *it;
-		if (map.find(identifier) != map.end()) {
-			// Find
-			return map.at(identifier);
-		}
-	}
-
-	// Don't find
+Type TypeSystem::getType(uint32_t slot) {
+	if (slot < m_types.size() && m_types[slot].has_value())
+		return m_types[slot]->type;
 	LOG_ERROR("Don't Find!");
 	return Type::UNKNOWN;
 }
-Type TypeSystem::analyze(const std::shared_ptr<BaseAST>& AstNode) {
-	switch (AstNode->GetASTType()) {
-	case ElementASTTypes::SourceUnit: {
-		SourceUnit* node = dynamic_cast<SourceUnit*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		for (auto& child: node->getSubNodes()) {
-			analyze(child);
-		}
-		return Type::UNKNOWN;
+
+IntegerType TypeSystem::getIntType(uint32_t slot) {
+	if (slot < m_types.size() && m_types[slot].has_value())
+		return m_types[slot]->intType;
+	return {};
+}
+
+/* Integer literals and arithmetic on them only, e.g. `-1` or `1 << 8`. */
+static bool isIntLiteral(const Expression* expr) {
+	if (expr == nullptr || expr->GetType() != Type::INTEGER || expr->GetCastType() != Type::INTEGER)
+		return false;
+	switch (expr->GetASTType()) {
+	case ElementASTTypes::NumberLiteral:
+		return true;
+	case ElementASTTypes::UnaryOp: {
+		const UnaryOp* unary = static_cast<const UnaryOp*>(expr);
+		return (unary->GetOp() == Token::Sub || unary->GetOp() == Token::BitNot) && isIntLiteral(unary->GetExpr());
 	}
-	case ElementASTTypes::PlainVariableDefinition: {
-		PlainVariableDefinition* node = dynamic_cast<PlainVariableDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Token type = node->GetDeclarationType()->GetType();
-		const std::string& name = node->GetName();
-		if (type == Token::Int) {
-			TypeSystem::setType(name, Type::INTEGER);
-		} else if (type == Token::Bool) {
-			TypeSystem::setType(name, Type::BOOLEAN);
-		} else if (type == Token::String) {
-			TypeSystem::setType(name, Type::STRING);
-		} else if (type == Token::Float) {
-			TypeSystem::setType(name, Type::FLOAT);
-		} else if (type == Token::Double) {
-			TypeSystem::setType(name, Type::DOUBLE);
-		} else {
-			LOG_ERROR("Type Error: PlainVariableDefinition.");
-			TypeSystem::setType(name, Type::UNKNOWN);
+	case ElementASTTypes::BinaryOp: {
+		const BinaryOp* binary = static_cast<const BinaryOp*>(expr);
+		switch (binary->GetOp()) {
+		case Token::BitOr ... Token::Exp:
+			return isIntLiteral(binary->GetLeftHand()) && isIntLiteral(binary->GetRightHand());
+		default:
+			return false;
 		}
-		analyze(node->getVarDefExpr());
-		return Type::UNKNOWN;
 	}
-	case ElementASTTypes::ArrayDefinition: {
-		LOG_WARNING("Not Implemented!");
-		return Type::UNKNOWN;
+	default:
+		return false;
 	}
-	case ElementASTTypes::StructDefinition: {
-		LOG_WARNING("Not Implemented!");
-		return Type::UNKNOWN;
+}
+
+void TypeSystem::adoptIntType(Expression* expr, IntegerType type) {
+	if (!isIntLiteral(expr))
+		return;
+	expr->SetIntType(type);
+	if (expr->GetASTType() == ElementASTTypes::UnaryOp) {
+		adoptIntType(astCast<UnaryOp>(expr)->GetExpr(), type);
+	} else if (expr->GetASTType() == ElementASTTypes::BinaryOp) {
+		adoptIntType(astCast<BinaryOp>(expr)->GetLeftHand(), type);
+		adoptIntType(astCast<BinaryOp>(expr)->GetRightHand(), type);
 	}
-	case ElementASTTypes::Block: {
-		pushMap();
-		Block* node = dynamic_cast<Block*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		for (auto& child: node->GetStatements()) {
-			analyze(child);
-		}
-		popMap();
-		return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitSourceUnit(SourceUnit* node) {
+	for (auto& child: node->getSubNodes()) {
+		analyze(child);
 	}
-	case ElementASTTypes::FunctionDefinition: {
-		FunctionDefinition* node = dynamic_cast<FunctionDefinition*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		analyze(node->GetBody());
-		std::string name = node->GetName();
-		Token type = node->GetDeclarationType()->GetType();
-		if (type == Token::Int) {
-			TypeSystem::setType(name, Type::INTEGER);
-		} else if (type == Token::Bool) {
-			TypeSystem::setType(name, Type::BOOLEAN);
-		} else if (type == Token::String) {
-			TypeSystem::setType(name, Type::STRING);
-		} else if (type == Token::Float) {
-			TypeSystem::setType(name, Type::FLOAT);
-		} else if (type == Token::Double) {
-			TypeSystem::setType(name, Type::DOUBLE);
-		} else {
-			// LOG_ERROR("Type Error: FunctionDefinition.");
-			TypeSystem::setType(name, Type::UNKNOWN);
-		}
-		return Type::UNKNOWN;
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitPlainVariableDefinition(PlainVariableDefinition* node) {
+	Token type = node->GetDeclarationType()->GetType();
+	uint32_t slot = node->GetSlot();
+	if (isIntegerType(type)) {
+		TypeSystem::setType(slot, Type::INTEGER, node->GetDeclarationType()->GetIntType());
+	} else if (type == Token::Bool) {
+		TypeSystem::setType(slot, Type::BOOLEAN);
+	} else if (type == Token::String) {
+		TypeSystem::setType(slot, Type::STRING);
+	} else if (type == Token::Float) {
+		TypeSystem::setType(slot, Type::FLOAT);
+	} else if (type == Token::Double) {
+		TypeSystem::setType(slot, Type::DOUBLE);
+	} else {
+		LOG_ERROR("Type Error: PlainVariableDefinition.");
+		TypeSystem::setType(slot, Type::UNKNOWN);
 	}
-	case ElementASTTypes::ReturnStatement: {
-		ReturnStatement* node = dynamic_cast<ReturnStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		analyze(node->GetExpr());
-		return Type::UNKNOWN;
+	analyze(node->getVarDefExpr());
+	if (isIntegerType(type))
+		adoptIntType(node->getVarDefExpr(), node->GetDeclarationType()->GetIntType());
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitArrayDefinition(ArrayDefinition* node) {
+	LOG_WARNING("Not Implemented!");
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitStructDefinition(StructDefinition* node) {
+	LOG_WARNING("Not Implemented!");
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitBlock(Block* node) {
+	for (auto& child: node->GetStatements()) {
+		analyze(child);
 	}
-	case ElementASTTypes::Identifier: {
-		Identifier* node = dynamic_cast<Identifier*>(AstNode.get());
-		std::string name = node->GetValue();
-		Type type = getType(name);
-		if (type == Type::UNKNOWN) {
-			LOG_ERROR("Type Error: Identifier.");
-		}
-		node->SetTwoType(type);
-		return type;
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitFunctionDefinition(FunctionDefinition* node) {
+	if (m_reused == nullptr || m_reused->count(node) == 0) {
+		if (node->GetParameterList())
+			for (auto& param: node->GetParameterList()->GetArgs())
+				analyze(param);
+		TypeName* returnType = node->GetDeclarationType();
+		m_returnIntType = isIntegerType(returnType->GetType()) ? std::optional(returnType->GetIntType()) : std::nullopt;
+		analyze(node->GetBody());
+		m_returnIntType.reset();
 	}
-	case ElementASTTypes::BooleanLiteral: {
-		BooleanLiteral* node = dynamic_cast<BooleanLiteral*>(AstNode.get());
-		node->SetTwoType(Type::BOOLEAN);
-		return Type::BOOLEAN;
+	declareFunction(node);
+	return Type::UNKNOWN;
+}
+
+void TypeSystem::declareFunction(FunctionDefinition* node) {
+	uint32_t slot = node->GetSlot();
+	Token type = node->GetDeclarationType()->GetType();
+	if (slot >= m_functions.size())
+		m_functions.resize(slot + 1);
+	m_functions[slot] = node;
+	if (isIntegerType(type)) {
+		TypeSystem::setType(slot, Type::INTEGER, node->GetDeclarationType()->GetIntType());
+	} else if (type == Token::Bool) {
+		TypeSystem::setType(slot, Type::BOOLEAN);
+	} else if (type == Token::String) {
+		TypeSystem::setType(slot, Type::STRING);
+	} else if (type == Token::Float) {
+		TypeSystem::setType(slot, Type::FLOAT);
+	} else if (type == Token::Double) {
+		TypeSystem::setType(slot, Type::DOUBLE);
+	} else {
+		// LOG_ERROR("Type Error: FunctionDefinition.");
+		TypeSystem::setType(slot, Type::UNKNOWN);
 	}
-	case ElementASTTypes::StringLiteral: {
-		StringLiteral* node = dynamic_cast<StringLiteral*>(AstNode.get());
-		node->SetTwoType(Type::STRING);
-		return Type::STRING;
+}
+
+Type TypeSystem::visitReturnStatement(ReturnStatement* node) {
+	analyze(node->GetExpr());
+	if (m_returnIntType)
+		adoptIntType(node->GetExpr(), *m_returnIntType);
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitIdentifier(Identifier* node) {
+	Type type = getType(node->GetSlot());
+	if (type == Type::UNKNOWN) {
+		LOG_ERROR("Type Error: Identifier.");
 	}
-	case ElementASTTypes::NumberLiteral: {
-		NumberLiteral* node = dynamic_cast<NumberLiteral*>(AstNode.get());
-		std::string valueString = node->GetValue();
-		try {
-			if (valueString.find('.') != std::string::npos) {
-				node->SetTwoType(Type::DOUBLE);
-				return Type::DOUBLE;
-			} else {
-				node->SetTwoType(Type::INTEGER);
-				return Type::INTEGER;
-			}
-		} catch (std::exception& e) {
-			LOG_ERROR("Type Error: Number Literal Error.");
+	node->SetTwoType(type);
+	node->SetIntType(getIntType(node->GetSlot()));
+	return type;
+}
+
+Type TypeSystem::visitBooleanLiteral(BooleanLiteral* node) {
+	node->SetTwoType(Type::BOOLEAN);
+	return Type::BOOLEAN;
+}
+
+Type TypeSystem::visitStringLiteral(StringLiteral* node) {
+	node->SetTwoType(Type::STRING);
+	return Type::STRING;
+}
+
+Type TypeSystem::visitNumberLiteral(NumberLiteral* node) {
+	std::string_view valueString = node->GetValue();
+	try {
+		if (valueString.find('.') != std::string::npos) {
+			node->SetTwoType(Type::DOUBLE);
+			return Type::DOUBLE;
+		} else {
+			node->SetTwoType(Type::INTEGER);
+			return Type::INTEGER;
 		}
+	} catch (std::exception& e) {
+		LOG_ERROR("Type Error: Number Literal Error.");
 	}
-	case ElementASTTypes::Assignment: {
-		Assignment* node = dynamic_cast<Assignment*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type typeLeft = analyze(node->GetLeftHand());
-		Type typeRight = analyze(node->GetRightHand());
-		if (node->GetLeftHand()->GetASTType() == ElementASTTypes::Identifier) {
-			Identifier* leftHand = dynamic_cast<Identifier*>(node->GetLeftHand().get());
-			if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitAssignment(Assignment* node) {
+	Type typeLeft = analyze(node->GetLeftHand());
+	Type typeRight = analyze(node->GetRightHand());
+	if (node->GetLeftHand()->GetASTType() == ElementASTTypes::Identifier) {
+		Identifier* leftHand = astCast<Identifier>(node->GetLeftHand());
+		if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
+			LOG_ERROR("Type Error: Assignment.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else if (typeLeft == typeRight) {
+			if (typeLeft == Type::INTEGER)
+				adoptIntType(node->GetRightHand(), leftHand->GetIntType());
+			node->SetTwoType(typeLeft);
+		} else {
+			if (typeLeft == Type::BOOLEAN) {
 				LOG_ERROR("Type Error: Assignment.");
 				node->SetTwoType(Type::UNKNOWN);
-			} else if (typeLeft == typeRight) {
-				node->SetTwoType(typeLeft);
-			} else {
-				if (typeLeft == Type::BOOLEAN) {
-					LOG_ERROR("Type Error: Assignment.");
-					node->SetTwoType(Type::UNKNOWN);
-				} else if (typeLeft == Type::STRING) {
-					LOG_ERROR("Type Error: Assignment.");
-					node->SetTwoType(Type::UNKNOWN);
-				} else if (typeLeft == Type::INTEGER) {
-					node->GetRightHand()->SetCastType(Type::INTEGER);
-					node->SetTwoType(Type::INTEGER);
-				} else if (typeLeft == Type::FLOAT) {
-					if (typeRight == Type::INTEGER) {
-						node->GetRightHand()->SetCastType(Type::FLOAT);
-						node->SetTwoType(Type::FLOAT);
-					} else {
-						node->GetRightHand()->SetCastType(Type::FLOAT);
-						node->SetTwoType(Type::FLOAT);
-					}
-				} else if (typeLeft == Type::DOUBLE) {
-					node->GetRightHand()->SetCastType(Type::DOUBLE);
-					node->SetTwoType(Type::DOUBLE);
+			} else if (typeLeft == Type::STRING) {
+				LOG_ERROR("Type Error: Assignment.");
+				node->SetTwoType(Type::UNKNOWN);
+			} else if (typeLeft == Type::INTEGER) {
+				node->GetRightHand()->SetCastType(Type::INTEGER);
+				node->SetTwoType(Type::INTEGER);
+			} else if (typeLeft == Type::FLOAT) {
+				if (typeRight == Type::INTEGER) {
+					node->GetRightHand()->SetCastType(Type::FLOAT);
+					node->SetTwoType(Type::FLOAT);
+				} else {
+					node->GetRightHand()->SetCastType(Type::FLOAT);
+					node->SetTwoType(Type::FLOAT);
 				}
+			} else if (typeLeft == Type::DOUBLE) {
+				node->GetRightHand()->SetCastType(Type::DOUBLE);
+				node->SetTwoType(Type::DOUBLE);
 			}
-			return node->GetCastType();
-		} else {
-			LOG_WARNING("Not Implemented Yet.");
-			return Type::UNKNOWN;
-			// a[3],a.i……
 		}
+		node->SetIntType(leftHand->GetIntType());
+		return node->GetCastType();
+	} else {
+		LOG_WARNING("Not Implemented Yet.");
+		return Type::UNKNOWN;
+		// a[3],a.i……
 	}
-	case ElementASTTypes::BinaryOp: {
-		BinaryOp* node = dynamic_cast<BinaryOp*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type typeLeft = analyze(node->GetLeftHand());
-		Type typeRight = analyze(node->GetRightHand());
-		Token op = node->GetOp();
-		switch (op) {
-		case Token::Comma:
-			node->SetTwoType(typeRight);
-			break;
-		case Token::Or:
-			[[fallthrough]];
-		case Token::And:
-			if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
-				LOG_ERROR("Type Error: BinaryOp Or.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else if (typeLeft == Type::STRING || typeRight == Type::STRING) {
-				LOG_ERROR("Type Error: BinaryOp Or.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else {
-				if (typeLeft != Type::BOOLEAN)
-					node->GetLeftHand()->SetCastType(Type::BOOLEAN);
-				if (typeRight != Type::BOOLEAN)
-					node->GetRightHand()->SetCastType(Type::BOOLEAN);
-				node->SetTwoType(Type::BOOLEAN);
-			}
-			break;
-		case Token::BitOr:
-			[[fallthrough]];
-		case Token::BitXor:
-			[[fallthrough]];
-		case Token::BitAnd:
-			if (typeLeft == Type::STRING || typeLeft == Type::UNKNOWN || typeRight == Type::STRING
-				|| typeRight == Type::UNKNOWN) {
-				LOG_ERROR("Type Error: BinaryOp BitOr/BitXor/BitAnd.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else {
-				if (typeLeft != Type::INTEGER)
-					node->GetLeftHand()->SetCastType(Type::INTEGER);
-				if (typeRight != Type::INTEGER)
-					node->GetRightHand()->SetCastType(Type::INTEGER);
-				node->SetTwoType(Type::INTEGER);
-			}
-			break;
-		case Token::SHL:
-			[[fallthrough]];
-		case Token::SAR:
-			[[fallthrough]];
-		case Token::SHR:
+}
+
+Type TypeSystem::visitBinaryOp(BinaryOp* node) {
+	Type typeLeft = analyze(node->GetLeftHand());
+	Type typeRight = analyze(node->GetRightHand());
+	Token op = node->GetOp();
+	Expression* lhs = node->GetLeftHand();
+	Expression* rhs = node->GetRightHand();
+	// A literal operand takes the type of the other one; a shift amount or exponent keeps its own
+	if (op != Token::Comma && !isShiftOp(op) && op != Token::Exp && typeLeft == Type::INTEGER
+		&& typeRight == Type::INTEGER) {
+		if (isIntLiteral(rhs) && !isIntLiteral(lhs))
+			adoptIntType(rhs, lhs->GetIntType());
+		else if (isIntLiteral(lhs) && !isIntLiteral(rhs))
+			adoptIntType(lhs, rhs->GetIntType());
+	}
+	switch (op) {
+	case Token::Comma:
+		node->SetTwoType(typeRight);
+		node->SetIntType(rhs->GetIntType());
+		break;
+	case Token::Or:
+		[[fallthrough]];
+	case Token::And:
+		if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
+			LOG_ERROR("Type Error: BinaryOp Or.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else if (typeLeft == Type::STRING || typeRight == Type::STRING) {
+			LOG_ERROR("Type Error: BinaryOp Or.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else {
+			if (typeLeft != Type::BOOLEAN)
+				node->GetLeftHand()->SetCastType(Type::BOOLEAN);
+			if (typeRight != Type::BOOLEAN)
+				node->GetRightHand()->SetCastType(Type::BOOLEAN);
+			node->SetTwoType(Type::BOOLEAN);
+		}
+		break;
+	case Token::BitOr:
+		[[fallthrough]];
+	case Token::BitXor:
+		[[fallthrough]];
+	case Token::BitAnd:
+		if (typeLeft == Type::STRING || typeLeft == Type::UNKNOWN || typeRight == Type::STRING
+			|| typeRight == Type::UNKNOWN) {
+			LOG_ERROR("Type Error: BinaryOp BitOr/BitXor/BitAnd.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else {
+			if (typeLeft != Type::INTEGER)
+				node->GetLeftHand()->SetCastType(Type::INTEGER);
+			if (typeRight != Type::INTEGER)
+				node->GetRightHand()->SetCastType(Type::INTEGER);
+			node->SetTwoType(Type::INTEGER);
+			node->SetIntType(commonIntegerType(lhs->GetIntType(), rhs->GetIntType()));
+		}
+		break;
+	case Token::SHL:
+		[[fallthrough]];
+	case Token::SAR:
+		[[fallthrough]];
+	case Token::SHR:
+		if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
+			node->SetTwoType(Type::INTEGER);
+			node->SetIntType(lhs->GetIntType());
+		} else {
+			LOG_ERROR("Type Error: BinaryOp SHL/SAR/SHR.");
+			node->SetTwoType(Type::UNKNOWN);
+		}
+		break;
+	case Token::Add:
+		[[fallthrough]];
+	case Token::Sub:
+		[[fallthrough]];
+	case Token::Mul:
+		[[fallthrough]];
+	case Token::Div:
+		if (typeLeft == Type::BOOLEAN || typeLeft == Type::STRING || typeLeft == Type::UNKNOWN
+			|| typeRight == Type::BOOLEAN || typeRight == Type::STRING || typeRight == Type::UNKNOWN) {
+			LOG_ERROR("Type Error: BinaryOp Add/Sub/Mul/Div.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else {
 			if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
 				node->SetTwoType(Type::INTEGER);
-			} else {
-				LOG_ERROR("Type Error: BinaryOp SHL/SAR/SHR.");
-				node->SetTwoType(Type::UNKNOWN);
+				node->SetIntType(commonIntegerType(lhs->GetIntType(), rhs->GetIntType()));
 			}
-			break;
-		case Token::Add:
-			[[fallthrough]];
-		case Token::Sub:
-			[[fallthrough]];
-		case Token::Mul:
-			[[fallthrough]];
-		case Token::Div:
-			if (typeLeft == Type::BOOLEAN || typeLeft == Type::STRING || typeLeft == Type::UNKNOWN
-				|| typeRight == Type::BOOLEAN || typeRight == Type::STRING || typeRight == Type::UNKNOWN) {
-				LOG_ERROR("Type Error: BinaryOp Add/Sub/Mul/Div.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else {
-				if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
-					node->SetTwoType(Type::INTEGER);
-				}
-				if (typeLeft == Type::INTEGER && (typeRight == Type::FLOAT || typeRight == Type::DOUBLE)) {
-					node->GetLeftHand()->SetCastType(typeRight);
-					node->SetTwoType(typeRight);
-				}
-				if ((typeLeft == Type::FLOAT || typeLeft == Type::DOUBLE) && typeRight == Type::INTEGER) {
-					node->GetRightHand()->SetCastType(typeLeft);
-					node->SetTwoType(typeLeft);
-				}
-				if (typeLeft == Type::FLOAT && typeRight == Type::DOUBLE) {
-					node->GetLeftHand()->SetCastType(Type::DOUBLE);
-					node->SetTwoType(Type::DOUBLE);
-				}
-				if (typeLeft == Type::DOUBLE && typeRight == Type::FLOAT) {
-					node->GetRightHand()->SetCastType(Type::DOUBLE);
-					node->SetTwoType(Type::DOUBLE);
-				}
-				if (typeLeft == Type::FLOAT && typeRight == Type::FLOAT)
-					node->SetTwoType(Type::FLOAT);
-				if (typeLeft == Type::DOUBLE && typeRight == Type::DOUBLE)
-					node->SetTwoType(Type::DOUBLE);
+			if (typeLeft == Type::INTEGER && (typeRight == Type::FLOAT || typeRight == Type::DOUBLE)) {
+				node->GetLeftHand()->SetCastType(typeRight);
+				node->SetTwoType(typeRight);
 			}
-			break;
-		case Token::Mod:
-			if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
-				node->SetTwoType(Type::INTEGER);
-			} else {
-				LOG_ERROR("Type Error: BinaryOp Mod.");
-				node->SetTwoType(Type::UNKNOWN);
+			if ((typeLeft == Type::FLOAT || typeLeft == Type::DOUBLE) && typeRight == Type::INTEGER) {
+				node->GetRightHand()->SetCastType(typeLeft);
+				node->SetTwoType(typeLeft);
 			}
-			break;
-		case Token::Exp: // TODO
-			LOG_WARNING("Not implemented!");
-			break;
-		case Token::Equal ... Token::GreaterThanOrEqual:
-			if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
-				LOG_ERROR(
-					"Type Error: BinaryOp Equal/NotEqual/LessThan/LessThanOrEqual/GreaterThan/GreaterThanOrEqual.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else if (typeLeft == Type::STRING && typeRight == Type::STRING) {
-				node->SetTwoType(Type::STRING);
-			} else if (typeLeft == Type::STRING || typeRight == Type::STRING) {
-				LOG_ERROR(
-					"Type Error: BinaryOp Equal/NotEqual/LessThan/LessThanOrEqual/GreaterThan/GreaterThanOrEqual.");
-				node->SetTwoType(Type::UNKNOWN);
-			} else {
-				node->SetTwoType(Type::BOOLEAN);
+			if (typeLeft == Type::FLOAT && typeRight == Type::DOUBLE) {
+				node->GetLeftHand()->SetCastType(Type::DOUBLE);
+				node->SetTwoType(Type::DOUBLE);
 			}
-			break;
-		default:
-			LOG_ERROR("Type Error: BinaryOp.");
+			if (typeLeft == Type::DOUBLE && typeRight == Type::FLOAT) {
+				node->GetRightHand()->SetCastType(Type::DOUBLE);
+				node->SetTwoType(Type::DOUBLE);
+			}
+			if (typeLeft == Type::FLOAT && typeRight == Type::FLOAT)
+				node->SetTwoType(Type::FLOAT);
+			if (typeLeft == Type::DOUBLE && typeRight == Type::DOUBLE)
+				node->SetTwoType(Type::DOUBLE);
+		}
+		break;
+	case Token::Mod:
+		if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
+			node->SetTwoType(Type::INTEGER);
+			node->SetIntType(commonIntegerType(lhs->GetIntType(), rhs->GetIntType()));
+		} else {
+			LOG_ERROR("Type Error: BinaryOp Mod.");
 			node->SetTwoType(Type::UNKNOWN);
-			break;
 		}
-		return node->GetCastType();
-	}
-	case ElementASTTypes::UnaryOp: {
-		UnaryOp* node = dynamic_cast<UnaryOp*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type type = analyze(node->GetExpr());
-		Token op = node->GetOp();
-		switch (op) {
-		case Token::Sub:
-			[[fallthrough]];
-		case Token::Inc:
-			[[fallthrough]];
-		case Token::Dec:
-			if (type == Type::DOUBLE || type == Type::FLOAT || type == Type::INTEGER) {
-				node->SetTwoType(type);
-			} else {
-				LOG_ERROR("Type Error: UnaryOp Sub/Inc/Dec.");
-				node->SetTwoType(Type::UNKNOWN);
-			}
-			break;
-		case Token::Not:
-			if (type != Type::STRING && type != Type::UNKNOWN) {
-				node->SetType(type);
-				node->SetCastType(Type::BOOLEAN);
-			} else {
-				LOG_ERROR("Type Error: UnaryOp Not.");
-				node->SetTwoType(Type::UNKNOWN);
-			}
-		case Token::BitNot:
-			if (type == Type::INTEGER) {
-				node->SetTwoType(type);
-			} else {
-				LOG_ERROR("Type Error: UnaryOp BitNot.");
-				node->SetTwoType(Type::UNKNOWN);
-			}
-			break;
-		default:
-			LOG_ERROR("Unknown UnaryOp");
+		break;
+	case Token::Exp:
+		if (typeLeft == Type::INTEGER && typeRight == Type::INTEGER) {
+			node->SetTwoType(Type::INTEGER);
+			node->SetIntType(lhs->GetIntType());
+		} else {
+			LOG_ERROR("Type Error: BinaryOp Exp.");
 			node->SetTwoType(Type::UNKNOWN);
 		}
-		return node->GetCastType();
-	}
-	case ElementASTTypes::IfStatement: {
-		IfStatement* node = dynamic_cast<IfStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type type = analyze(node->GetCondition());
-		if (type != Type::BOOLEAN) {
-			LOG_ERROR("Type Error: IfStatement.");
+		break;
+	case Token::Equal ... Token::GreaterThanOrEqual:
+		if (typeLeft == Type::UNKNOWN || typeRight == Type::UNKNOWN) {
+			LOG_ERROR(
+				"Type Error: BinaryOp Equal/NotEqual/LessThan/LessThanOrEqual/GreaterThan/GreaterThanOrEqual.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else if (typeLeft == Type::STRING && typeRight == Type::STRING) {
+			node->SetTwoType(Type::STRING);
+		} else if (typeLeft == Type::STRING || typeRight == Type::STRING) {
+			LOG_ERROR(
+				"Type Error: BinaryOp Equal/NotEqual/LessThan/LessThanOrEqual/GreaterThan/GreaterThanOrEqual.");
+			node->SetTwoType(Type::UNKNOWN);
+		} else {
+			node->SetTwoType(Type::BOOLEAN);
 		}
-		// for(auto& stmt : node->GetThenStatement()) {
-		// 	analyze(stmt);
-		// }
-		analyze(node->GetThenStatement());
-		analyze(node->GetElseStatement());
-		return Type::UNKNOWN;
+		break;
+	default:
+		LOG_ERROR("Type Error: BinaryOp.");
+		node->SetTwoType(Type::UNKNOWN);
+		break;
 	}
-	case ElementASTTypes::WhileStatement: {
-		WhileStatement* node = dynamic_cast<WhileStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type type = analyze(node->GetConditionExpr());
-		if (type != Type::BOOLEAN) {
-			LOG_ERROR("Type Error: WhileStatement.");
+	return node->GetCastType();
+}
+
+Type TypeSystem::visitUnaryOp(UnaryOp* node) {
+	Type type = analyze(node->GetExpr());
+	Token op = node->GetOp();
+	node->SetIntType(node->GetExpr()->GetIntType());
+	switch (op) {
+	case Token::Sub:
+		[[fallthrough]];
+	case Token::Inc:
+		[[fallthrough]];
+	case Token::Dec:
+		if (type == Type::DOUBLE || type == Type::FLOAT || type == Type::INTEGER) {
+			node->SetTwoType(type);
+		} else {
+			LOG_ERROR("Type Error: UnaryOp Sub/Inc/Dec.");
+			node->SetTwoType(Type::UNKNOWN);
 		}
-		analyze(node->GetWhileLoopBody());
-		return Type::UNKNOWN;
-	}
-	case ElementASTTypes::ForStatement: {
-		ForStatement* node = dynamic_cast<ForStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		analyze(node->GetInitExpr());
-		Type type = analyze(node->GetConditionExpr());
-		if (type != Type::BOOLEAN) {
-			LOG_ERROR("Type Error: ForStatement.");
+		break;
+	case Token::Not:
+		if (type != Type::STRING && type != Type::UNKNOWN) {
+			node->SetType(type);
+			node->SetCastType(Type::BOOLEAN);
+		} else {
+			LOG_ERROR("Type Error: UnaryOp Not.");
+			node->SetTwoType(Type::UNKNOWN);
 		}
-		analyze(node->GetUpdateExpr());
-		analyze(node->GetForLoopBody());
-		return Type::UNKNOWN;
-	}
-	case ElementASTTypes::DoWhileStatement: {
-		DoWhileStatement* node = dynamic_cast<DoWhileStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		analyze(node->GetDoWhileLoopBody());
-		Type type = analyze(node->GetConditionExpr());
-		if (type != Type::BOOLEAN) {
-			LOG_ERROR("Type Error: DoWhileStatement.");
+	case Token::BitNot:
+		if (type == Type::INTEGER) {
+			node->SetTwoType(type);
+		} else {
+			LOG_ERROR("Type Error: UnaryOp BitNot.");
+			node->SetTwoType(Type::UNKNOWN);
 		}
-
-		return Type::UNKNOWN;
-	}
-	case ElementASTTypes::BreakStatement: {
-		LOG_WARNING("Not Implemented");
-		return Type::UNKNOWN;
+		break;
+	default:
+		LOG_ERROR("Unknown UnaryOp");
+		node->SetTwoType(Type::UNKNOWN);
 	}
-	case ElementASTTypes::ContinueStatement: {
-		LOG_WARNING("Not Implemented");
-		return Type::UNKNOWN;
+	return node->GetCastType();
+}
+
+Type TypeSystem::visitIfStatement(IfStatement* node) {
+	Type type = analyze(node->GetCondition());
+	if (type != Type::BOOLEAN) {
+		LOG_ERROR("Type Error: IfStatement.");
 	}
-	case ElementASTTypes::ExpressionStatement: {
-		ExpressionStatement* node = dynamic_cast<ExpressionStatement*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		Type type = analyze(node->GetExpr());
-		return Type::UNKNOWN;
+	// for(auto& stmt : node->GetThenStatement()) {
+	// 	analyze(stmt);
+	// }
+	analyze(node->GetThenStatement());
+	analyze(node->GetElseStatement());
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitWhileStatement(WhileStatement* node) {
+	Type type = analyze(node->GetConditionExpr());
+	if (type != Type::BOOLEAN) {
+		LOG_ERROR("Type Error: WhileStatement.");
 	}
-	case ElementASTTypes::IndexAccess: {
-		IndexAccess* node = dynamic_cast<IndexAccess*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		// Type type = analyze(node->GetExpr());
-		// if (type != Type::ARRAY) {
-		// 	LOG_ERROR("Type Error: IndexAccess.");
-		// }
-		Type indexType = analyze(node->GetArrayIndex());
-		if (indexType != Type::INTEGER) {
-			LOG_ERROR("Type Error: IndexAccess.");
-		}
-		return Type::UNKNOWN;
+	analyze(node->GetWhileLoopBody());
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitForStatement(ForStatement* node) {
+	analyze(node->GetInitExpr());
+	Type type = analyze(node->GetConditionExpr());
+	if (type != Type::BOOLEAN) {
+		LOG_ERROR("Type Error: ForStatement.");
 	}
-	case ElementASTTypes::FunctionCall: {
-		FunctionCall* node = dynamic_cast<FunctionCall*>(AstNode.get());
-		ASSERT(node != nullptr, "dynamic cast fails.");
-		std::string name = node->GetFunctionName();
-		Type type = getType(name);
-		node->SetTwoType(type);
-		// TODO: check args
+	analyze(node->GetUpdateExpr());
+	analyze(node->GetForLoopBody());
+	return Type::UNKNOWN;
+}
 
-		// for (auto& arg: node->GetArgs()) {
-		// 	analyze(arg);
-		// }
-		return Type::UNKNOWN;
+Type TypeSystem::visitDoWhileStatement(DoWhileStatement* node) {
+	analyze(node->GetDoWhileLoopBody());
+	Type type = analyze(node->GetConditionExpr());
+	if (type != Type::BOOLEAN) {
+		LOG_ERROR("Type Error: DoWhileStatement.");
 	}
-	case ElementASTTypes::MemberAccess: {
-		LOG_WARNING("Not Implemented");
-		return Type::UNKNOWN;
+
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitBreakStatement(BreakStatement* node) {
+	LOG_WARNING("Not Implemented");
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitContinueStatement(ContinueStatement* node) {
+	LOG_WARNING("Not Implemented");
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitExpressionStatement(ExpressionStatement* node) {
+	Type type = analyze(node->GetExpr());
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitIndexAccess(IndexAccess* node) {
+	// Type type = analyze(node->GetExpr());
+	// if (type != Type::ARRAY) {
+	// 	LOG_ERROR("Type Error: IndexAccess.");
+	// }
+	Type indexType = analyze(node->GetArrayIndex());
+	if (indexType != Type::INTEGER) {
+		LOG_ERROR("Type Error: IndexAccess.");
 	}
-	default:
-		return Type::UNKNOWN;
+	return Type::UNKNOWN;
+}
+
+Type TypeSystem::visitFunctionCall(FunctionCall* node) {
+	uint32_t slot = static_cast<Identifier*>(node->GetCallee())->GetSlot();
+	Type type = getType(slot);
+	node->SetTwoType(type);
+	node->SetIntType(getIntType(slot));
+	// TODO: check args
+	FunctionDefinition* callee = slot < m_functions.size() ? m_functions[slot] : nullptr;
+	const auto& params = callee && callee->GetParameterList() ? callee->GetParameterList()->GetArgs()
+															  : AstList<VariableDefinition>{};
+	for (size_t i = 0; i < node->GetArgs().size(); ++i) {
+		Expression* arg = node->GetArgs()[i];
+		analyze(arg);
+		if (i < params.size() && isIntegerType(params[i]->GetDeclarationType()->GetType()))
+			adoptIntType(arg, params[i]->GetDeclarationType()->GetIntType());
 	}
+	return type;
+}
+
+Type TypeSystem::visitMemberAccess(MemberAccess* node) {
+	LOG_WARNING("Not Implemented");
+	return Type::UNKNOWN;
 }
@@ -0,0 +1,214 @@
+#include "common/ThreadPool.h"
+#include "lexer/TokenStream.h"
+#include "parser/AstVisitor.h"
+#include "parser/FlatExpr.h"
+#include "parser/Parser.h"
+#include "preprocess/Preprocess.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+
+/* Parser checks for speculative parsing: a struct variable declared without the struct keyword,
+   "S x", is told from an expression statement only at the second name. Statements with one name
+   are decided by lookahead; two names are tried as a declaration, rewound if they are not one,
+   and at the top level the statement that follows asks again and gets the memoized failure.
+   Also checks the flat expression store the parser can fill: post-order, trimmed on rewinds,
+   joined after a parallel parse.
+
+   Usage: parser_test; exits non-zero if a check fails. */
+
+using namespace minisolc;
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool condition, const char* what) {
+	if (!condition) {
+		std::fprintf(stderr, "FAILED: %s\n", what);
+		++g_failures;
+	}
+}
+
+struct Parsed {
+	std::vector<BaseAST*> nodes; // top-level nodes
+	size_t rewinds;
+	size_t memoHits;
+	size_t errors;
+};
+
+std::filesystem::path writeSource(const std::string& source) {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "minisolc_parser_test.sol";
+	std::ofstream(path, std::ios::binary) << source;
+	return path;
+}
+
+/* Parses source, also in lazy mode, where rewinding relies on the checkpoint's pin. */
+Parsed parse(const std::string& source, bool lazy) {
+	std::filesystem::path path = writeSource(source);
+	Preprocess preprocess(path);
+	TokenStream stream(preprocess, lazy);
+	Parser parser(stream);
+	parser.parse();
+	std::filesystem::remove(path);
+	SourceUnit* unit = static_cast<SourceUnit*>(parser.GetAst());
+	std::vector<BaseAST*> nodes(unit->getSubNodes().begin(), unit->getSubNodes().end());
+	return {nodes, parser.GetRewinds(), parser.GetMemoHits(), parser.GetDiagnostics().size()};
+}
+
+bool isStructVariable(const BaseAST* node, std::string_view name, std::string_view structName) {
+	if (node == nullptr || node->GetASTType() != ElementASTTypes::StructDefinition)
+		return false;
+	const StructDefinition* var = static_cast<const StructDefinition*>(node);
+	return var->GetisVariable() && var->GetName() == name && var->GetStructName() == structName;
+}
+
+void testDeclarations(bool lazy) {
+	/* Both spellings give the same node; "p.x = 1;" is an expression without speculating. */
+	Parsed parsed = parse("struct Point { int x; int y; };\n"
+						  "function f() returns (int) {\n"
+						  "    Point p;\n"
+						  "    struct Point q;\n"
+						  "    p.x = 1;\n"
+						  "    return p.x;\n"
+						  "}\n",
+		lazy);
+	check(parsed.errors == 0, "declarations parse without errors");
+	check(parsed.nodes.size() == 2, "two top-level definitions");
+	if (parsed.nodes.size() == 2) {
+		const FunctionDefinition* f = static_cast<const FunctionDefinition*>(parsed.nodes[1]);
+		const AstList<Statement>& body = f->GetBody()->GetStatements();
+		check(body.size() == 4, "four statements");
+		check(body.size() > 1 && isStructVariable(body[0], "p", "Point"), "\"Point p\" declares a struct variable");
+		check(body.size() > 1 && isStructVariable(body[1], "q", "Point"), "\"struct Point q\" still does");
+		check(body.size() > 2 && body[2]->GetASTType() == ElementASTTypes::ExpressionStatement,
+			"\"p.x = 1\" is an expression");
+	}
+	check(parsed.rewinds == 0, "no rewinds for well-formed statements");
+	check(parsed.memoHits == 0, "no memo hits for well-formed statements");
+}
+
+void testTopLevel(bool lazy) {
+	/* Global struct variables; expression statements at the top level do not speculate. */
+	Parsed parsed = parse("struct Point { int x; int y; };\n"
+						  "Point origin = 0;\n"
+						  "int total = 0;\n"
+						  "total = 1;\n"
+						  "origin.x = total;\n",
+		lazy);
+	check(parsed.errors == 0, "top level parses without errors");
+	check(parsed.nodes.size() == 5, "five top-level items");
+	check(parsed.nodes.size() > 1 && isStructVariable(parsed.nodes[1], "origin", "Point"),
+		"\"Point origin\" declares a global struct variable");
+	check(parsed.rewinds == 0 && parsed.memoHits == 0, "no speculation at the top level");
+	std::unordered_set<BaseAST*> unique(parsed.nodes.begin(), parsed.nodes.end());
+	check(unique.size() == parsed.nodes.size(), "no node is in the tree twice");
+}
+
+void testFailedDeclaration(bool lazy) {
+	/* Two names that do not make a declaration are rewound, once per attempt: inside a function
+	   the statement tries it, at the top level the item and then the statement, which gets the
+	   memoized failure. */
+	Parsed parsed = parse("struct Point { int x; int y; };\n"
+						  "Point bad = ;\n"
+						  "function f() returns (int) {\n"
+						  "    Point worse = ;\n"
+						  "    return 0;\n"
+						  "}\n",
+		lazy);
+	check(parsed.errors == 2, "each failed declaration still reports one error after the rewind");
+	check(parsed.rewinds == 2, "one rewind per failed declaration");
+	check(parsed.memoHits == 1, "one memo hit, at the top level");
+}
+
+
+/* Every node is at the index it records, after its operands. */
+bool isPostOrder(const FlatExprStore& store) {
+	for (size_t i = 0; i < store.size(); ++i) {
+		auto before = [&](FlatExprStore::Index operand) { return operand == FlatExprStore::kNone || operand < i; };
+		if (store.nodes()[i]->GetFlatIndex() != i || !before(store.lhs()[i]))
+			return false;
+		if (store.kinds()[i] != ElementASTTypes::FunctionCall) {
+			if (!before(store.rhs()[i]))
+				return false;
+			continue;
+		}
+		FlatExprStore::Index args = store.rhs()[i];
+		for (FlatExprStore::Index k = 0; k < store.args()[args]; ++k) {
+			if (!before(store.args()[args + 1 + k]))
+				return false;
+		}
+	}
+	return true;
+}
+
+void testFlatStore(bool lazy) {
+	/* The failed declaration built "3 + ..." before it was rewound; the store must not keep it. */
+	std::filesystem::path path = writeSource("int v = 1 + 2 * x;\n"
+											 "Point bad = 3 + ;\n"
+											 "int w = f(4, -5);\n");
+	Preprocess preprocess(path);
+	TokenStream stream(preprocess, lazy);
+	Parser parser(stream, true);
+	parser.parse();
+	std::filesystem::remove(path);
+	const FlatExprStore* store = parser.GetFlatExprs();
+	check(store != nullptr, "the store is on");
+	if (store == nullptr)
+		return;
+	check(isPostOrder(*store), "the store is in post-order");
+	bool rewound = true;
+	for (Expression* expr: store->nodes()) {
+		if (const NumberLiteral* literal = astCast<NumberLiteral>(expr))
+			rewound = rewound && literal->GetValue() != "3";
+	}
+	check(rewound, "a rewind drops the expressions built since the checkpoint");
+	/* 1, 2, 4, 5 and -5; "2 * x", the sum and the call are not constant. */
+	std::vector<bool> mask = store->constantMask();
+	check(std::count(mask.begin(), mask.end(), true) == 5, "constantMask() finds the literal expressions");
+}
+
+void testFlatStoreParallel() {
+	/* Chunks fill stores of their own, joined in source order and renumbered. */
+	std::string source;
+	for (int i = 0; i < 64; ++i)
+		source += "function f" + std::to_string(i) + "(int a) returns (int) { return a * " + std::to_string(i)
+			+ " + g(a, -1); }\n";
+	std::filesystem::path path = writeSource(source);
+	Preprocess preprocess(path);
+	TokenStream serialStream(preprocess);
+	Parser serial(serialStream, true);
+	serial.parse();
+	TokenStream parallelStream(preprocess);
+	Parser parallel(parallelStream, true);
+	ThreadPool pool(4);
+	parallel.parse(pool);
+	std::filesystem::remove(path);
+	const FlatExprStore& a = *serial.GetFlatExprs();
+	const FlatExprStore& b = *parallel.GetFlatExprs();
+	check(a.size() == b.size() && a.kinds() == b.kinds() && a.lhs() == b.lhs() && a.rhs() == b.rhs()
+			  && a.args() == b.args(),
+		"a parallel parse joins the same store as a serial one");
+	check(isPostOrder(b), "the joined store is in post-order");
+}
+
+}
+
+int main() {
+	for (bool lazy: {false, true}) {
+		testDeclarations(lazy);
+		testTopLevel(lazy);
+		testFailedDeclaration(lazy);
+		testFlatStore(lazy);
+	}
+	testFlatStoreParallel();
+	if (g_failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", g_failures);
+		return 1;
+	}
+	std::printf("parser_test: all checks passed\n");
+	return 0;
+}
@@ -16,12 +16,96 @@ target("compiler")
     set_toolset("ld", "/usr/bin/clang++")
     add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
     set_languages("c++17")
+    add_syslinks("pthread")
 
     before_link(function (target)
         local llvmconfig, errordata = os.iorun("llvm-config --cxxflags --ldflags --system-libs --libs core")
         target:add("ldflags", llvmconfig, {force = true})
     end)
     
+-- Benchmarks are not built by default: xmake build lexer_bench && xmake run lexer_bench
+target("lexer_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/LexerBench.cpp", "src/preprocess/*.cpp", "src/lexer/*.cpp")
+    add_includedirs("include")
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    set_optimize("fastest")
+    add_syslinks("pthread")
+
+-- xmake build ast_bench && xmake run ast_bench
+target("ast_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/AstWalkBench.cpp", "src/lexer/Token.cpp")
+    add_includedirs("include")
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    set_optimize("fastest")
+
+-- xmake build parser_bench && xmake run parser_bench
+target("parser_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/ParserBench.cpp", "src/preprocess/*.cpp", "src/lexer/*.cpp", "src/parser/*.cpp")
+    add_includedirs("include")
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    set_optimize("fastest")
+    add_syslinks("pthread")
+
+-- xmake build flat_bench && xmake run flat_bench
+target("flat_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/FlatExprBench.cpp", "src/preprocess/*.cpp", "src/lexer/*.cpp", "src/parser/*.cpp")
+    add_includedirs("include")
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    set_optimize("fastest")
+    add_syslinks("pthread")
+
+-- Tests are not built by default either: xmake build parser_test && xmake run parser_test
+target("parser_test")
+    set_kind("binary")
+    set_default(false)
+    add_files("test/ParserTest.cpp", "src/preprocess/*.cpp", "src/lexer/*.cpp", "src/parser/*.cpp")
+    add_includedirs("include")
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    add_syslinks("pthread")
+
+-- Kernels for 256-bit division, remainder and exponentiation that compiled programs call, see runtime/u256.h
+target("u256")
+    set_kind("static")
+    add_files("runtime/u256.c")
+    add_cflags("-Wall", "-Wextra", "-Werror")
+    set_languages("c11")
+    set_optimize("fastest")
+
+-- xmake build u256_bench && xmake run u256_bench
+target("u256_bench")
+    set_kind("binary")
+    set_default(false)
+    add_deps("u256")
+    add_files("bench/U256Bench.cpp")
+    add_includedirs("runtime")
+    if is_plat("macosx") then
+        add_sysincludedirs("/opt/homebrew/Cellar/llvm@14/14.0.6/include")
+    else
+        add_sysincludedirs("/usr/lib/llvm-14/include")
+    end
+    add_cxxflags("-Wall", "-Wextra", "-Werror", "-Wno-unused", "-Wno-unused-parameter")
+    set_languages("c++17")
+    set_optimize("fastest")
+    add_syslinks("pthread")
+
+    before_link(function (target)
+        local llvmconfig, errordata = os.iorun("llvm-config --ldflags --system-libs --libs orcjit native")
+        target:add("ldflags", llvmconfig, {force = true})
+    end)
+
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
 --